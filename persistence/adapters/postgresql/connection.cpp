@@ -7,6 +7,7 @@
 #include <wayward/support/logger.hpp>
 #include <wayward/support/data_franca/spectator.hpp>
 #include <sstream>
+#include <cstdlib>
 #include <iostream>
 
 namespace persistence {
@@ -37,6 +38,11 @@ namespace persistence {
       size_t width() const final { return PQnfields(result); }
       size_t height() const final { return PQntuples(result); }
 
+      size_t affected_rows() const final {
+        const char* tuples = PQcmdTuples(result);
+        return tuples ? std::strtoull(tuples, nullptr, 10) : 0;
+      }
+
       bool is_null_at(size_t row, const std::string& col) const final {
         auto idx = PQfnumber(result, col.c_str());
         return PQgetisnull(result, row, idx);
@@ -52,6 +58,22 @@ namespace persistence {
         }
       }
 
+      Maybe<size_t> column_index(const std::string& col) const final {
+        int idx = PQfnumber(result, col.c_str());
+        if (idx < 0) {
+          return wayward::Nothing;
+        }
+        return size_t(idx);
+      }
+
+      const char* get_raw(size_t row, size_t col, size_t& length) const final {
+        if (PQgetisnull(result, row, col)) {
+          return nullptr;
+        }
+        length = PQgetlength(result, row, col);
+        return PQgetvalue(result, row, col);
+      }
+
       std::vector<std::string> columns() const final {
         std::vector<std::string> r;
         size_t n = PQnfields(result);
@@ -104,7 +126,7 @@ namespace persistence {
   std::unique_ptr<IResultSet>
   PostgreSQLConnection::execute(std::string sql) {
     PGresult* results = PQexec(priv->conn, sql.c_str());
-    priv->logger->log(wayward::Severity::Debug, "p", sql);
+    WAYWARD_LOG(priv->logger, wayward::Severity::Debug, "p", sql);
     switch (PQresultStatus(results)) {
       case PGRES_EMPTY_QUERY:
       case PGRES_COMMAND_OK:
@@ -142,6 +164,155 @@ namespace persistence {
     return execute(std::move(sql));
   }
 
+  std::vector<std::unique_ptr<IResultSet>>
+  PostgreSQLConnection::execute_batch(const std::vector<std::string>& sql) {
+    std::vector<std::unique_ptr<IResultSet>> results;
+    results.reserve(sql.size());
+    if (sql.size() < 2) {
+      for (auto& s: sql) {
+        results.push_back(execute(s));
+      }
+      return results;
+    }
+
+    std::string error;
+    auto collect = [&](PGresult* result) {
+      switch (PQresultStatus(result)) {
+        case PGRES_BAD_RESPONSE:
+        case PGRES_FATAL_ERROR:
+          if (error.empty()) error = PQresultErrorMessage(result);
+          PQclear(result);
+          break;
+        case PGRES_NONFATAL_ERROR:
+          WAYWARD_LOG(priv->logger, wayward::Severity::Warning, "p", PQresultErrorMessage(result));
+          results.push_back(make_results(result));
+          break;
+        #if defined(LIBPQ_HAS_PIPELINING)
+        case PGRES_PIPELINE_ABORTED: // An earlier statement failed.
+          PQclear(result);
+          break;
+        #endif
+        default:
+          results.push_back(make_results(result));
+          break;
+      }
+    };
+
+    #if defined(LIBPQ_HAS_PIPELINING)
+    if (PQenterPipelineMode(priv->conn) != 1) {
+      throw PostgreSQLError{PQerrorMessage(priv->conn)};
+    }
+    size_t sent = 0;
+    for (auto& s: sql) {
+      WAYWARD_LOG(priv->logger, wayward::Severity::Debug, "p", s);
+      // PQsendQuery isn't allowed in pipeline mode, but the parameterless extended protocol is.
+      if (PQsendQueryParams(priv->conn, s.c_str(), 0, nullptr, nullptr, nullptr, nullptr, 0) != 1) {
+        error = PQerrorMessage(priv->conn);
+        break;
+      }
+      ++sent;
+    }
+    PQpipelineSync(priv->conn);
+    // Each statement's results are followed by a nullptr, and the batch by the sync result.
+    for (size_t i = 0; i < sent; ++i) {
+      while (PGresult* result = PQgetResult(priv->conn)) {
+        collect(result);
+      }
+    }
+    if (PGresult* sync = PQgetResult(priv->conn)) {
+      PQclear(sync);
+    }
+    PQexitPipelineMode(priv->conn);
+    #else
+    // Without pipelining, fall back to one multi-statement query, which also answers with a result per statement.
+    std::stringstream ss;
+    for (auto& s: sql) {
+      WAYWARD_LOG(priv->logger, wayward::Severity::Debug, "p", s);
+      ss << s << ";\n";
+    }
+    if (PQsendQuery(priv->conn, ss.str().c_str()) != 1) {
+      throw PostgreSQLError{PQerrorMessage(priv->conn)};
+    }
+    while (PGresult* result = PQgetResult(priv->conn)) {
+      collect(result);
+    }
+    #endif
+
+    if (error.size()) {
+      throw PostgreSQLError{error};
+    }
+    return results;
+  }
+
+  size_t
+  PostgreSQLConnection::copy_in(const std::string& relation, const std::vector<std::string>& columns, const std::string& data) {
+    std::stringstream ss;
+    ss << "COPY " << relation << " (";
+    for (size_t i = 0; i < columns.size(); ++i) {
+      ss << "\"" << columns[i] << "\"";
+      if (i+1 != columns.size())
+        ss << ", ";
+    }
+    ss << ") FROM STDIN";
+    std::string sql = ss.str();
+    WAYWARD_LOG(priv->logger, wayward::Severity::Debug, "p", sql);
+
+    PGresult* begin = PQexec(priv->conn, sql.c_str());
+    auto begin_status = PQresultStatus(begin);
+    std::string begin_error = PQresultErrorMessage(begin);
+    PQclear(begin);
+    if (begin_status != PGRES_COPY_IN) {
+      throw PostgreSQLError{begin_error};
+    }
+
+    const char* error = nullptr;
+    if (PQputCopyData(priv->conn, data.data(), (int)data.size()) != 1) {
+      error = "Could not send COPY data.";
+    }
+    if (PQputCopyEnd(priv->conn, error) != 1) {
+      throw PostgreSQLError{PQerrorMessage(priv->conn)};
+    }
+
+    size_t rows = 0;
+    std::string copy_error;
+    while (PGresult* result = PQgetResult(priv->conn)) {
+      if (PQresultStatus(result) == PGRES_COMMAND_OK) {
+        std::stringstream tuples { PQcmdTuples(result) };
+        tuples >> rows;
+      } else {
+        copy_error = PQresultErrorMessage(result);
+      }
+      PQclear(result);
+    }
+    if (copy_error.size()) {
+      throw PostgreSQLError{copy_error};
+    }
+    return rows;
+  }
+
+  bool
+  PostgreSQLConnection::ping() {
+    if (PQstatus(priv->conn) != CONNECTION_OK) {
+      return false;
+    }
+    // An empty query is the cheapest possible round trip.
+    PGresult* result = PQexec(priv->conn, "");
+    bool ok = PQresultStatus(result) == PGRES_EMPTY_QUERY;
+    PQclear(result);
+    return ok;
+  }
+
+  bool
+  PostgreSQLConnection::reconnect() {
+    PQreset(priv->conn);
+    return PQstatus(priv->conn) == CONNECTION_OK;
+  }
+
+  bool
+  PostgreSQLConnection::in_transaction() {
+    return PQtransactionStatus(priv->conn) != PQTRANS_IDLE;
+  }
+
   std::string
   PostgreSQLConnection::to_sql(const ast::IQuery& query, const relational_algebra::IResolveSymbolicRelation& rel) {
     PostgreSQLQueryRenderer renderer(*this, rel);
@@ -35,6 +35,13 @@ namespace persistence {
     std::unique_ptr<IResultSet> execute(const ast::IQuery& query) final;
     std::unique_ptr<IResultSet> execute(std::string sql) final;
     std::unique_ptr<IResultSet> execute(const ast::IQuery& query, const relational_algebra::IResolveSymbolicRelation&) final;
+    std::vector<std::unique_ptr<IResultSet>> execute_batch(const std::vector<std::string>& sql) final;
+    size_t copy_in(const std::string& relation, const std::vector<std::string>& columns, const std::string& data) final;
+
+    // Health
+    bool ping() final;
+    bool reconnect() final;
+    bool in_transaction() final;
 
     static std::unique_ptr<PostgreSQLConnection>
     connect(std::string connection_string, std::string* out_error = nullptr);
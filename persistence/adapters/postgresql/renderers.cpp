@@ -1,79 +1,125 @@
 #include "persistence/adapters/postgresql/renderers.hpp"
-#include <wayward/support/format.hpp>
 #include <sstream>
+#include <cstdio>
 
 namespace persistence {
-    std::string PostgreSQLQueryRenderer::render(const SelectQuery& x) {
-      PostgreSQLValueRenderer renderer{conn, symbolic_relation_resolver};
-      std::stringstream ss;
-      ss << "SELECT ";
-      if (x.select.size()) {
-        for (size_t i = 0; i < x.select.size(); ++i) {
-          auto& alias = x.select[i];
-          ss << alias.value->to_sql(renderer);
-          if (alias.alias) {
-            ss << wayward::format(" AS \"{0}\"", *alias.alias);
+    namespace {
+      void render_select_head(std::string& out, const SelectQuery& x, PostgreSQLValueRenderer& renderer) {
+        out += "SELECT ";
+        if (x.select.size()) {
+          for (size_t i = 0; i < x.select.size(); ++i) {
+            auto& alias = x.select[i];
+            out += alias.value->to_sql(renderer);
+            if (alias.alias) {
+              out += " AS \"";
+              out += *alias.alias;
+              out += '"';
+            }
+            if (i+1 != x.select.size())
+              out += ", ";
           }
-          if (i+1 != x.select.size())
-            ss << ", ";
+        } else {
+          out += "*";
+        }
+        out += " FROM ";
+        out += x.relation;
+        if (x.relation_alias) {
+          out += " AS ";
+          out += *x.relation_alias;
+        }
+
+        for (auto& join: x.joins) {
+          switch (join->type) {
+            case ast::Join::Cross:      out += " CROSS JOIN "; break;
+            case ast::Join::Inner:      out += " INNER JOIN "; break;
+            case ast::Join::LeftOuter:  out += " LEFT OUTER JOIN "; break;
+            case ast::Join::RightOuter: out += " RIGHT OUTER JOIN "; break;
+            case ast::Join::FullOuter:  out += " FULL OUTER JOIN "; break;
+          }
+          out += join->relation;
+          out += " AS ";
+          out += join->alias;
+          out += " ON ";
+          out += join->on->to_sql(renderer);
         }
-      } else {
-        ss << "*";
-      }
-      ss << " FROM " << x.relation;
-      if (x.relation_alias) {
-        ss << " AS " << *x.relation_alias;
       }
+    }
 
-      for (auto& join: x.joins) {
-        switch (join->type) {
-          case ast::Join::Cross:      ss << " CROSS JOIN "; break;
-          case ast::Join::Inner:      ss << " INNER JOIN "; break;
-          case ast::Join::LeftOuter:  ss << " LEFT OUTER JOIN "; break;
-          case ast::Join::RightOuter: ss << " RIGHT OUTER JOIN "; break;
-          case ast::Join::FullOuter:  ss << " FULL OUTER JOIN "; break;
+    std::string PostgreSQLQueryRenderer::render(const SelectQuery& x) {
+      PostgreSQLValueRenderer renderer{conn, symbolic_relation_resolver};
+      std::string out;
+      out.reserve(256);
+
+      // Everything up to WHERE only depends on the shape of the query, so reuse it when we can.
+      const std::string* head = x.head ? x.head->get() : nullptr;
+      if (head) {
+        out += *head;
+      } else {
+        render_select_head(out, x, renderer);
+        if (x.head) {
+          x.head->put(out);
         }
-        ss << join->relation << " AS " << join->alias << " ON ";
-        ss << join->on->to_sql(renderer);
       }
 
       if (x.where) {
-        ss << " WHERE " << x.where->to_sql(renderer);
+        out += " WHERE ";
+        out += x.where->to_sql(renderer);
       }
       if (x.group.size()) {
-        ss << " GROUP BY ";
+        out += " GROUP BY ";
         for (size_t i = 0; i < x.group.size(); ++i) {
-          ss << x.group[i]->to_sql(renderer);
+          out += x.group[i]->to_sql(renderer);
           if (i+1 != x.group.size())
-            ss << ", ";
+            out += ", ";
         }
       }
       if (x.order.size()) {
-        ss << " ORDER BY ";
+        out += " ORDER BY ";
         for (size_t i = 0; i < x.order.size(); ++i) {
-          ss << x.order[i].value->to_sql(renderer);
+          out += x.order[i].value->to_sql(renderer);
           if (x.order[i].ordering == ast::Ordering::Descending) {
-            ss << " DESC";
+            out += " DESC";
           }
           if (i+1 != x.order.size())
-            ss << ", ";
+            out += ", ";
         }
       }
       if (x.limit) {
-        ss << " LIMIT " << *x.limit;
+        out += " LIMIT ";
+        out += std::to_string(*x.limit);
         if (x.offset) {
-          ss << " OFFSET " << *x.offset;
+          out += " OFFSET ";
+          out += std::to_string(*x.offset);
         }
       }
-      return ss.str();
+      return out;
     }
 
     std::string PostgreSQLQueryRenderer::render(const UpdateQuery& x) {
-      return "NIY";
+      PostgreSQLValueRenderer vr { conn, symbolic_relation_resolver };
+      std::stringstream ss;
+      ss << "UPDATE " << x.relation << " SET ";
+      for (size_t i = 0; i < x.columns.size(); ++i) {
+        ss << "\"" << x.columns[i] << "\" = " << x.values.at(i)->to_sql(vr);
+        if (i+1 != x.columns.size())
+          ss << ", ";
+      }
+      if (x.where) {
+        ss << " WHERE " << x.where->to_sql(vr);
+      }
+      // PostgreSQL has no UPDATE ... LIMIT, so x.limit is ignored.
+      return ss.str();
     }
 
     std::string PostgreSQLQueryRenderer::render(const DeleteQuery& x) {
-      return "NIY";
+      PostgreSQLValueRenderer vr { conn, symbolic_relation_resolver };
+      std::stringstream ss;
+      ss << "DELETE FROM " << x.relation;
+      if (x.where) {
+        ss << " WHERE " << x.where->to_sql(vr);
+      }
+      // PostgreSQL has no DELETE ... LIMIT, so x.limit is ignored.
+      return ss.str();
     }
 
     std::string PostgreSQLQueryRenderer::render(const InsertQuery& x) {
@@ -88,12 +134,17 @@ namespace persistence {
       }
       ss << ") VALUES (";
       PostgreSQLValueRenderer vr { conn, symbolic_relation_resolver };
-      for (auto it = x.values.begin(); it != x.values.end();) {
-        ss << (*it)->to_sql(vr);
-        ++it;
-        if (it != x.values.end()) {
-          ss << ", ";
+      // Values are stored row-major, so anything beyond the first columns.size() values is another row.
+      const size_t row_width = x.columns.size();
+      for (size_t i = 0; i < x.values.size(); ++i) {
+        if (i != 0) {
+          if (row_width != 0 && i % row_width == 0) {
+            ss << "), (";
+          } else {
+            ss << ", ";
+          }
         }
+        ss << x.values[i]->to_sql(vr);
       }
       ss << ")";
 
@@ -112,52 +163,70 @@ namespace persistence {
     }
 
     std::string PostgreSQLValueRenderer::render(const StarFrom& x) {
-      return wayward::format("{0}.*", x.relation);
+      return x.relation + ".*";
     }
 
     std::string PostgreSQLValueRenderer::render(const StringLiteral& x) {
-      return wayward::format("'{0}'", conn.sanitize(x.literal));
+      std::string out = "'";
+      out += conn.sanitize(x.literal);
+      out += '\'';
+      return out;
     }
 
     std::string PostgreSQLValueRenderer::render(const NumericLiteral& x) {
       // TODO: Something cleverer once NumericLiteral becomes more aware of number types
-      return wayward::format("{0}", x.literal);
+      // %g matches what operator<< produces for a double.
+      char buffer[32];
+      int n = std::snprintf(buffer, sizeof(buffer), "%g", x.literal);
+      return std::string(buffer, n);
     }
 
     std::string PostgreSQLValueRenderer::render(const BooleanLiteral& x) {
       return x.value ? "'t'" : "'f'";
     }
 
+    namespace {
+      std::string quoted_column(const std::string& relation, const std::string& column) {
+        std::string out;
+        out.reserve(relation.size() + column.size() + 5);
+        out += '"';
+        out += relation;
+        out += "\".\"";
+        out += column;
+        out += '"';
+        return out;
+      }
+    }
+
     std::string PostgreSQLValueRenderer::render(const ColumnReference& x) {
-      return wayward::format("\"{0}\".\"{1}\"", x.relation, x.column);
+      return quoted_column(x.relation, x.column);
     }
 
     std::string PostgreSQLValueRenderer::render(const ColumnReferenceWithSymbolicRelation& x) {
-      return wayward::format("\"{0}\".\"{1}\"", symbolic_relation_resolver.relation_for_symbol(x.relation), x.column);
+      return quoted_column(symbolic_relation_resolver.relation_for_symbol(x.relation), x.column);
     }
 
     std::string PostgreSQLValueRenderer::render(const Aggregate& x) {
-      std::stringstream ss;
-      ss << x.function << '(';
+      std::string out = x.function;
+      out += '(';
       for (size_t i = 0; i < x.arguments.size(); ++i) {
-        ss << x.arguments[i]->to_sql(*this);
+        out += x.arguments[i]->to_sql(*this);
         if (i+1 != x.arguments.size())
-          ss << ", ";
+          out += ", ";
       }
-      ss << ')';
-      return ss.str();
+      out += ')';
+      return out;
     }
 
     std::string PostgreSQLValueRenderer::render(const List& x) {
-      std::stringstream ss;
-      ss << '(';
+      std::string out = "(";
       for (size_t i = 0; i < x.elements.size(); ++i) {
-        ss << x.elements[i]->to_sql(*this);
+        out += x.elements[i]->to_sql(*this);
         if (i+1 != x.elements.size())
-          ss << ", ";
+          out += ", ";
       }
-      ss << ')';
-      return ss.str();
+      out += ')';
+      return out;
     }
 
     std::string PostgreSQLValueRenderer::render(const CaseSimple& x) {
@@ -169,11 +238,14 @@ namespace persistence {
     }
 
     std::string PostgreSQLValueRenderer::render(const NotCondition& x) {
-      return wayward::format("NOT ({0})", x.subcondition->to_sql(*this));
+      std::string out = "NOT (";
+      out += x.subcondition->to_sql(*this);
+      out += ')';
+      return out;
     }
 
     std::string PostgreSQLValueRenderer::render(const UnaryCondition& x) {
-      std::string op;
+      const char* op = "";
       switch (x.op) {
         case UnaryCondition::IsNull:       op = "IS NULL"; break;
         case UnaryCondition::IsNotNull:    op = "IS NOT NULL"; break;
@@ -184,11 +256,15 @@ namespace persistence {
         case UnaryCondition::IsUnknown:    op = "IS UNKNOWN"; break;
         case UnaryCondition::IsNotUnknown: op = "IS NOT UNKNOWN"; break;
       }
-      return wayward::format("({0}) {1}", x.value->to_sql(*this));
+      std::string out = "(";
+      out += x.value->to_sql(*this);
+      out += ") ";
+      out += op;
+      return out;
     }
 
     std::string PostgreSQLValueRenderer::render(const BinaryCondition& x) {
-      std::string op;
+      const char* op = "";
       switch (x.op) {
         case BinaryCondition::Eq:                op = "="; break;
         case BinaryCondition::NotEq:             op = "!="; break;
@@ -204,26 +280,44 @@ namespace persistence {
         case BinaryCondition::ILike:             op = "ILIKE"; break;
       }
 
-      return wayward::format("{0} {1} {2}", x.lhs->to_sql(*this), op, x.rhs->to_sql(*this));
+      std::string out = x.lhs->to_sql(*this);
+      out += ' ';
+      out += op;
+      out += ' ';
+      out += x.rhs->to_sql(*this);
+      return out;
     }
 
     std::string PostgreSQLValueRenderer::render(const BetweenCondition& x) {
-      return wayward::format("{0} IS BETWEEN {1} AND {2}", x.value->to_sql(*this), x.lower_bound->to_sql(*this), x.upper_bound->to_sql(*this));
+      std::string out = x.value->to_sql(*this);
+      out += " IS BETWEEN ";
+      out += x.lower_bound->to_sql(*this);
+      out += " AND ";
+      out += x.upper_bound->to_sql(*this);
+      return out;
     }
 
     std::string PostgreSQLValueRenderer::render(const LogicalCondition& x) {
-      std::string op;
+      const char* op = "";
       switch (x.op) {
-        case LogicalCondition::AND: op = "AND"; break;
-        case LogicalCondition::OR:  op = "OR"; break;
+        case LogicalCondition::AND: op = ") AND ("; break;
+        case LogicalCondition::OR:  op = ") OR ("; break;
       }
-      return wayward::format("({0}) {1} ({2})", x.lhs->to_sql(*this), op, x.rhs->to_sql(*this));
+      std::string out = "(";
+      out += x.lhs->to_sql(*this);
+      out += op;
+      out += x.rhs->to_sql(*this);
+      out += ')';
+      return out;
     }
 
     std::string PostgreSQLValueRenderer::render(const SelectQuery& x) {
       // TODO: Actually, the semantics here may have to be slightly different, because
       // a sub-SELECT is allowed to do different things from a toplevel select.
       PostgreSQLQueryRenderer renderer{conn, symbolic_relation_resolver};
-      return wayward::format("({0})", x.to_sql(renderer));
+      std::string out = "(";
+      out += x.to_sql(renderer);
+      out += ')';
+      return out;
     }
 }
@@ -5,6 +5,8 @@
 #include <vector>
 #include <memory>
 #include <string>
+#include <atomic>
+#include <mutex>
 #include <wayward/support/cloning_ptr.hpp>
 #include <wayward/support/maybe.hpp>
 
@@ -217,6 +219,8 @@ namespace persistence {
         IsUnknown,
         IsNotUnknown,
       };
+      UnaryCondition(Ptr<SingleValue> value, Cond op) : value(std::move(value)), op(op) {}
+
       Ptr<SingleValue> value;
       Cond op;
 
@@ -325,6 +329,26 @@ namespace persistence {
       Ordering(Ordering&&) = default;
     };
 
+    // The rendered "SELECT ... FROM ... JOIN ..." part of a query, shared by all queries of the same shape.
+    // It is written once by the first renderer to see it, and is read-only afterwards.
+    struct RenderedHead {
+      const std::string* get() const {
+        return rendered_.load(std::memory_order_acquire) ? &sql_ : nullptr;
+      }
+
+      void put(std::string sql) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!rendered_.load(std::memory_order_relaxed)) {
+          sql_ = std::move(sql);
+          rendered_.store(true, std::memory_order_release);
+        }
+      }
+    private:
+      std::mutex mutex_;
+      std::atomic<bool> rendered_ {false};
+      std::string sql_;
+    };
+
     // SELECT select FROM relation joins WHERE where GROUP BY group ORDER BY order order_descending
     // This is a SingleValue to provide support for subselects.
     struct SelectQuery : Cloneable<SelectQuery, SingleValue>, IQuery {
@@ -340,6 +364,10 @@ namespace persistence {
       Maybe<size_t> limit;
       Maybe<size_t> offset;
 
+      // When set, renderers may use (or fill in) this instead of rendering select, relation and joins.
+      // Anything that changes those must reset it.
+      std::shared_ptr<RenderedHead> head;
+
       std::string to_sql(ISQLQueryRenderer& visitor) const final { return visitor.render(*this); }
       std::string to_sql(ISQLValueRenderer& visitor) const final { return visitor.render(*this); }
     };
@@ -368,7 +396,7 @@ namespace persistence {
       virtual ~InsertQuery() {}
       std::string relation;
       std::vector<std::string> columns;
-      std::vector<Ptr<SingleValue>> values;
+      std::vector<Ptr<SingleValue>> values; // Row-major; inserts values.size() / columns.size() rows.
       std::vector<std::string> returning_columns;
 
       std::string to_sql(ISQLQueryRenderer& visitor) const final { return visitor.render(*this); }
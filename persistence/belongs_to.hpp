@@ -4,6 +4,7 @@
 
 #include <persistence/association.hpp>
 #include <persistence/primary_key.hpp>
+#include <persistence/record_snapshot.hpp>
 #include <persistence/column_abilities.hpp>
 
 #include <wayward/support/either.hpp>
@@ -138,6 +139,23 @@ namespace persistence {
     }
   };
 
+  // The foreign key column. NULL leaves the association as it is, like decoding it through BelongsToType.
+  template <typename T>
+  struct ColumnDecoderFor<BelongsTo<T>> {
+    static void decode(void* member, const char* value, size_t) {
+      if (value == nullptr) return;
+      *static_cast<BelongsTo<T>*>(member) = int64_t(std::strtoll(value, nullptr, 10));
+    }
+    static ColumnDecoder get() { return decode; }
+  };
+
+  // Compared by foreign key, which is what gets written.
+  template <typename T>
+  struct ColumnEqualityFor<BelongsTo<T>> {
+    static const bool Supported = true;
+    static bool equal(const BelongsTo<T>& a, const BelongsTo<T>& b) { return a.id().id == b.id().id; }
+  };
+
   template <typename O, typename A>
   struct BelongsToAssociation : SingularAssociationBase<O, BelongsTo<A>> {
     using MemberPointer = BelongsTo<A> O::*;
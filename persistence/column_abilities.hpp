@@ -13,6 +13,15 @@ namespace persistence {
     Cond operator==(T lit) && { return std::move(*this).value() == relational_algebra::literal(std::move(lit)); }
     Cond operator!=(T lit) && { return std::move(*this).value() != relational_algebra::literal(std::move(lit)); }
 
+    Cond in(const std::vector<T>& lits) && {
+      std::vector<relational_algebra::Value> values;
+      values.reserve(lits.size());
+      for (T lit: lits) {
+        values.push_back(relational_algebra::literal(std::move(lit)));
+      }
+      return std::move(*this).value().in(relational_algebra::list(std::move(values)));
+    }
+
   private:
     relational_algebra::Value value() && { return static_cast<Col*>(this)->value(); }
   };
@@ -0,0 +1,24 @@
+#include "persistence/column_decoder.hpp"
+#include "persistence/property.hpp"
+
+#include <wayward/support/format.hpp>
+
+namespace persistence {
+  wayward::DateTime parse_timestamp_column(const std::string& string_rep) {
+    // PostgreSQL timestamp with time zone looks like this: YYYY-mm-dd HH:MM:ss+ZZ
+    // Unfortunately, POSIX strptime can't deal with the two-digit timezone at the end, so we tinker with the string
+    // to get it into a parseable state.
+    std::string local_time_string = string_rep.substr(0, 19);
+    std::string timezone_string = string_rep.substr(string_rep.size() - 3);
+    local_time_string += timezone_string;
+    if (timezone_string.size() == 3) {
+      local_time_string += "00";
+    }
+
+    auto m = wayward::DateTime::strptime(local_time_string, "%Y-%m-%d %T%z");
+    if (m) {
+      return std::move(*m);
+    }
+    throw TypeError(wayward::format("Couldn't parse DateTime from string: '{0}'", string_rep));
+  }
+}
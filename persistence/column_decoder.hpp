@@ -0,0 +1,103 @@
+#pragma once
+#ifndef PERSISTENCE_COLUMN_DECODER_HPP_INCLUDED
+#define PERSISTENCE_COLUMN_DECODER_HPP_INCLUDED
+
+#include <persistence/primary_key.hpp>
+#include <wayward/support/datetime.hpp>
+#include <wayward/support/maybe.hpp>
+
+#include <cstdlib>
+#include <string>
+#include <type_traits>
+
+namespace persistence {
+  /*
+    Parses the text of a column value into the member that `member` points to, with the same
+    result as decoding it through the member's IType. `value` is NUL-terminated, or nullptr
+    if the value is NULL.
+  */
+  using ColumnDecoder = void(*)(void* member, const char* value, size_t length);
+
+  // Specializations return their decoder from get(). Types without one are decoded through their IType.
+  template <typename T, typename Enable = void>
+  struct ColumnDecoderFor {
+    static ColumnDecoder get() { return nullptr; }
+  };
+
+  // Throws TypeError if the string isn't a PostgreSQL "timestamp with time zone".
+  wayward::DateTime parse_timestamp_column(const std::string& value);
+
+  template <typename T>
+  struct ColumnDecoderFor<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+    static void decode(void* member, const char* value, size_t) {
+      if (value == nullptr) return;
+      if (std::is_signed<T>::value) {
+        *static_cast<T*>(member) = static_cast<T>(std::strtoll(value, nullptr, 10));
+      } else {
+        *static_cast<T*>(member) = static_cast<T>(std::strtoull(value, nullptr, 10));
+      }
+    }
+    static ColumnDecoder get() { return decode; }
+  };
+
+  template <>
+  struct ColumnDecoderFor<float> {
+    static void decode(void* member, const char* value, size_t) {
+      if (value == nullptr) return;
+      *static_cast<float*>(member) = std::strtof(value, nullptr);
+    }
+    static ColumnDecoder get() { return decode; }
+  };
+
+  template <>
+  struct ColumnDecoderFor<double> {
+    static void decode(void* member, const char* value, size_t) {
+      if (value == nullptr) return;
+      *static_cast<double*>(member) = std::strtod(value, nullptr);
+    }
+    static ColumnDecoder get() { return decode; }
+  };
+
+  template <>
+  struct ColumnDecoderFor<std::string> {
+    static void decode(void* member, const char* value, size_t length) {
+      if (value == nullptr) return;
+      static_cast<std::string*>(member)->assign(value, length);
+    }
+    static ColumnDecoder get() { return decode; }
+  };
+
+  template <>
+  struct ColumnDecoderFor<PrimaryKey> {
+    static void decode(void* member, const char* value, size_t) {
+      if (value == nullptr) return;
+      static_cast<PrimaryKey*>(member)->id = std::strtoll(value, nullptr, 10);
+    }
+    static ColumnDecoder get() { return decode; }
+  };
+
+  template <>
+  struct ColumnDecoderFor<wayward::DateTime> {
+    static void decode(void* member, const char* value, size_t length) {
+      if (value == nullptr) return;
+      *static_cast<wayward::DateTime*>(member) = parse_timestamp_column(std::string{value, length});
+    }
+    static ColumnDecoder get() { return decode; }
+  };
+
+  template <typename T>
+  struct ColumnDecoderFor<wayward::Maybe<T>> {
+    static void decode(void* member, const char* value, size_t length) {
+      auto& m = *static_cast<wayward::Maybe<T>*>(member);
+      if (value == nullptr) {
+        m = wayward::Nothing;
+      } else {
+        m = T{};
+        ColumnDecoderFor<T>::get()(m.get(), value, length);
+      }
+    }
+    static ColumnDecoder get() { return ColumnDecoderFor<T>::get() ? decode : nullptr; }
+  };
+}
+
+#endif // PERSISTENCE_COLUMN_DECODER_HPP_INCLUDED
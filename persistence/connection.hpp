@@ -47,6 +47,23 @@ namespace persistence {
     virtual std::unique_ptr<IResultSet> execute(std::string sql) = 0;
     virtual std::unique_ptr<IResultSet> execute(const ast::IQuery& query) = 0;
     virtual std::unique_ptr<IResultSet> execute(const ast::IQuery& query, const relational_algebra::IResolveSymbolicRelation&) = 0;
+    // Sends all statements before waiting for any result, so the batch costs one round trip.
+    // Results come back in the same order.
+    virtual std::vector<std::unique_ptr<IResultSet>> execute_batch(const std::vector<std::string>& sql) = 0;
+
+    // Bulk loading
+    // `data` is in the text COPY format: one line per row, columns separated by tabs, NULL as \N.
+    virtual size_t copy_in(const std::string& relation, const std::vector<std::string>& columns, const std::string& data) = 0;
+
+    // Health
+    // A cheap round trip to the server. Returns false if the connection is broken.
+    virtual bool ping() = 0;
+    // Re-establishes a broken connection in place. Returns false if the server is still unreachable.
+    virtual bool reconnect() = 0;
+
+    // Transactions
+    // True while a transaction block is open on this connection.
+    virtual bool in_transaction() = 0;
   };
 
   void set_connection(IConnection* conn);
@@ -1,90 +1,505 @@
 #include <persistence/connection_pool.hpp>
 #include <persistence/adapter.hpp>
 #include <wayward/support/format.hpp>
+#include <wayward/support/fiber.hpp>
+#include <wayward/support/event_loop.hpp>
 
+#include <atomic>
+#include <deque>
 #include <mutex>
 #include <condition_variable>
+#include <thread>
+#include <algorithm>
 
 namespace persistence {
   using wayward::Nothing;
+  using Clock = std::chrono::steady_clock;
 
+  namespace {
+    ConnectionWaiterFactory& connection_waiter_factory();
+
+    /*
+      A pool slot. The pool hands out the slot rather than the underlying connection,
+      so the connection can be opened, reset and closed behind it.
+      `busy` is held by whoever owns the slot's connection: the checked out holder, or
+      briefly the reaper while it detaches an idle connection from a free slot.
+    */
+    struct PooledConnection : IConnection {
+      std::unique_ptr<IConnection> connection;
+      Clock::time_point last_released;
+      std::atomic<bool> busy {false};
+
+      std::string database() const final { return connection->database(); }
+      std::string user() const final { return connection->user(); }
+      std::string host() const final { return connection->host(); }
+      std::string to_sql(const ast::IQuery& q) final { return connection->to_sql(q); }
+      std::string to_sql(const ast::IQuery& q, const relational_algebra::IResolveSymbolicRelation& rel) final { return connection->to_sql(q, rel); }
+      std::string sanitize(std::string input) final { return connection->sanitize(std::move(input)); }
+      std::unique_ptr<IResultSet> execute(std::string sql) final { return connection->execute(std::move(sql)); }
+      std::unique_ptr<IResultSet> execute(const ast::IQuery& query) final { return connection->execute(query); }
+      std::unique_ptr<IResultSet> execute(const ast::IQuery& query, const relational_algebra::IResolveSymbolicRelation& rel) final { return connection->execute(query, rel); }
+      std::vector<std::unique_ptr<IResultSet>> execute_batch(const std::vector<std::string>& sql) final { return connection->execute_batch(sql); }
+      size_t copy_in(const std::string& relation, const std::vector<std::string>& columns, const std::string& data) final { return connection->copy_in(relation, columns, data); }
+      bool ping() final { return connection->ping(); }
+      bool reconnect() final { return connection->reconnect(); }
+      bool in_transaction() final { return connection->in_transaction(); }
+      std::shared_ptr<ILogger> logger() const final { return connection->logger(); }
+      void set_logger(std::shared_ptr<ILogger> l) final { connection->set_logger(std::move(l)); }
+    };
+  }
+
+  /*
+    Slots are fixed for the lifetime of the pool, but their connections are opened on
+    first checkout and closed again when idle. Free slots form a Treiber stack threaded
+    through `next_`, so acquiring and releasing never take a lock unless somebody has
+    to wait. The head packs a generation tag in the upper 32 bits to rule out ABA, and
+    slot index + 1 in the lower 32 bits (0 = empty). Being a stack, recently used
+    connections are handed out first, and the cold ones sink to the bottom to be reaped.
+  */
   struct LimitedConnectionPool : IConnectionPool {
   public:
-    LimitedConnectionPool(const IAdapter& adapter, std::string connection_string, size_t pool_size) : adapter_(adapter), connection_string_(std::move(connection_string)), size_(pool_size) { fill_pool(); }
+    LimitedConnectionPool(const IAdapter& adapter, std::string connection_string, const ConnectionPoolOptions& options);
     virtual ~LimitedConnectionPool();
 
-    Maybe<AcquiredConnection> try_acquire();
-    AcquiredConnection acquire();
+    Maybe<AcquiredConnection> try_acquire() final;
+    AcquiredConnection acquire() final;
+    Maybe<AcquiredConnection> try_acquire_for(std::chrono::milliseconds timeout) final;
+    ConnectionPoolStats stats() const final;
   private:
     const IAdapter& adapter_;
-    std::mutex mutex_;
-    std::condition_variable available_;
-
     std::string connection_string_;
-    std::vector<std::unique_ptr<IConnection>> pool_;
-    std::vector<std::unique_ptr<IConnection>> reserved_;
-    size_t size_ = 0;
+    ConnectionPoolOptions options_;
+    std::unique_ptr<PooledConnection[]> slots_;
+    std::unique_ptr<std::atomic<uint32_t>[]> next_;
+    std::atomic<uint64_t> head_ {0};
+    std::atomic<size_t> in_use_ {0};
+    std::atomic<size_t> open_ {0};
 
-    void fill_pool();
-    AcquiredConnection acquire_unlocked();
+    std::mutex reap_mutex_;
+    std::atomic<int64_t> next_reap_ {0}; // Clock ticks.
+
+    std::mutex waiters_mutex_;
+    std::deque<IConnectionWaiter*> waiters_;
+    std::atomic<size_t> num_waiters_ {0};
+
+    std::atomic<uint64_t> reconnects_ {0};
+    std::atomic<uint64_t> acquisitions_ {0};
+    std::atomic<uint64_t> waits_ {0};
+    std::atomic<uint64_t> timeouts_ {0};
+    std::atomic<int64_t> total_wait_us_ {0};
+    std::atomic<int64_t> max_wait_us_ {0};
+
+    Maybe<AcquiredConnection> pop();
+    Maybe<uint32_t> pop_slot();
+    void push(uint32_t slot);
+    AcquiredConnection check_out(uint32_t slot);
+    void claim(PooledConnection& slot);
+    void open_or_validate(PooledConnection& slot);
+    void reap_idle_connections(Clock::time_point now);
+    Maybe<AcquiredConnection> wait_for_connection(Maybe<Clock::time_point> deadline);
+    bool remove_waiter(IConnectionWaiter*);
+    void notify_one_waiter();
+    void record_wait(Clock::time_point started);
     friend struct AcquiredConnection;
-    void release(IConnection*);
+    void release(IConnection*) final;
   };
 
+  std::unique_ptr<IConnectionPool> make_connection_pool(const IAdapter& adapter, std::string connection_string, const ConnectionPoolOptions& options) {
+    return std::unique_ptr<IConnectionPool>(new LimitedConnectionPool(adapter, std::move(connection_string), options));
+  }
+
   std::unique_ptr<IConnectionPool> make_limited_connection_pool(const IAdapter& adapter, std::string connection_string, size_t pool_size) {
-    return std::unique_ptr<IConnectionPool>(new LimitedConnectionPool(adapter, std::move(connection_string), pool_size));
+    ConnectionPoolOptions options;
+    options.max_connections = pool_size;
+    return make_connection_pool(adapter, std::move(connection_string), options);
+  }
+
+  namespace {
+    const uint64_t SLOT_MASK = 0xffffffffull;
+
+    inline uint64_t make_head(uint64_t old_head, uint32_t slot_plus_one) {
+      return ((old_head & ~SLOT_MASK) + (SLOT_MASK + 1)) | slot_plus_one;
+    }
+  }
+
+  LimitedConnectionPool::LimitedConnectionPool(const IAdapter& adapter, std::string connection_string, const ConnectionPoolOptions& options)
+  : adapter_(adapter)
+  , connection_string_(std::move(connection_string))
+  , options_(options)
+  , slots_(new PooledConnection[options.max_connections])
+  , next_(new std::atomic<uint32_t>[options.max_connections])
+  {
+    // Push in reverse, so slot 0 ends up on top.
+    for (size_t i = options_.max_connections; i > 0; --i) {
+      next_[i - 1].store(0, std::memory_order_relaxed);
+      push((uint32_t)(i - 1));
+    }
   }
 
   LimitedConnectionPool::~LimitedConnectionPool() {
-    if (reserved_.size()) {
-      throw ConnectionPoolError(wayward::format("Consistency error: Trying to destroy connection pool, but there are {0} AcquiredConnections still in use.", reserved_.size()));
+    size_t in_use = in_use_.load();
+    if (in_use) {
+      throw ConnectionPoolError(wayward::format("Consistency error: Trying to destroy connection pool, but there are {0} AcquiredConnections still in use.", in_use));
     }
   }
 
-  void LimitedConnectionPool::fill_pool() {
-    pool_.reserve(size_);
-    reserved_.reserve(size_);
-    while (pool_.size() < size_) {
-      pool_.push_back(adapter_.connect(connection_string_));
+  /*
+    The head is accessed sequentially consistently, as is num_waiters_: a waiter bumps
+    num_waiters_ and then reads head_, while a releaser writes head_ and then reads
+    num_waiters_. With anything weaker, both could read the stale value, and the waiter
+    would sleep on a connection that nobody is going to tell it about.
+  */
+  Maybe<uint32_t> LimitedConnectionPool::pop_slot() {
+    uint64_t head = head_.load(std::memory_order_seq_cst);
+    while (true) {
+      uint32_t slot_plus_one = (uint32_t)(head & SLOT_MASK);
+      if (slot_plus_one == 0) {
+        return Nothing;
+      }
+      uint32_t next = next_[slot_plus_one - 1].load(std::memory_order_relaxed);
+      if (head_.compare_exchange_weak(head, make_head(head, next), std::memory_order_seq_cst, std::memory_order_seq_cst)) {
+        return slot_plus_one - 1;
+      }
     }
   }
 
+  void LimitedConnectionPool::push(uint32_t slot) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    do {
+      next_[slot].store((uint32_t)(head & SLOT_MASK), std::memory_order_relaxed);
+    } while (!head_.compare_exchange_weak(head, make_head(head, slot + 1), std::memory_order_seq_cst, std::memory_order_relaxed));
+  }
+
+  Maybe<AcquiredConnection> LimitedConnectionPool::pop() {
+    auto slot = pop_slot();
+    if (!slot) {
+      return Nothing;
+    }
+    return check_out(*slot);
+  }
+
+  AcquiredConnection LimitedConnectionPool::check_out(uint32_t index) {
+    auto& slot = slots_[index];
+    claim(slot);
+    try {
+      open_or_validate(slot);
+    }
+    catch (...) {
+      slot.busy.store(false, std::memory_order_release);
+      push(index);
+      notify_one_waiter();
+      throw;
+    }
+    ++in_use_;
+    ++acquisitions_;
+    return AcquiredConnection{*this, slot};
+  }
+
+  void LimitedConnectionPool::claim(PooledConnection& slot) {
+    // Only contended while the reaper is detaching this slot's connection, which is quick.
+    while (slot.busy.exchange(true, std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+  }
+
+  void LimitedConnectionPool::open_or_validate(PooledConnection& slot) {
+    if (slot.connection) {
+      if (options_.validate_after.count() == 0 || Clock::now() - slot.last_released < options_.validate_after) {
+        return;
+      }
+      if (slot.connection->ping()) {
+        return;
+      }
+      ++reconnects_;
+      if (slot.connection->reconnect()) {
+        return;
+      }
+      slot.connection = nullptr;
+      --open_;
+    }
+    // Throws if the server can't be reached.
+    slot.connection = adapter_.connect(connection_string_);
+    ++open_;
+  }
+
   AcquiredConnection LimitedConnectionPool::acquire() {
-    std::unique_lock<std::mutex> L(mutex_);
-    while (pool_.empty()) {
-      available_.wait(L);
+    auto conn = pop();
+    if (!conn) {
+      conn = wait_for_connection(Nothing);
     }
-    return acquire_unlocked();
+    return std::move(*conn);
   }
 
   Maybe<AcquiredConnection> LimitedConnectionPool::try_acquire() {
-    std::lock_guard<std::mutex> L(mutex_);
-    if (pool_.empty()) {
-      return Nothing;
+    return pop();
+  }
+
+  Maybe<AcquiredConnection> LimitedConnectionPool::try_acquire_for(std::chrono::milliseconds timeout) {
+    auto conn = pop();
+    if (!conn) {
+      conn = wait_for_connection(Clock::now() + timeout);
+    }
+    return conn;
+  }
+
+  Maybe<AcquiredConnection> LimitedConnectionPool::wait_for_connection(Maybe<Clock::time_point> deadline) {
+    ++waits_;
+    auto started = Clock::now();
+    auto parked = connection_waiter_factory()();
+
+    while (true) {
+      {
+        std::lock_guard<std::mutex> L(waiters_mutex_);
+        waiters_.push_back(parked.get());
+        num_waiters_.fetch_add(1, std::memory_order_seq_cst);
+      }
+
+      // A connection may have been released between the failed pop() and registering
+      // as a waiter, in which case nobody is going to notify us.
+      auto slot = pop_slot();
+      if (slot) {
+        if (!remove_waiter(parked.get())) {
+          // We were notified as well, but don't need it anymore. Pass it on.
+          notify_one_waiter();
+        }
+        record_wait(started);
+        return check_out(*slot);
+      }
+
+      bool notified = parked->wait_until(deadline ? *deadline : Clock::time_point::max());
+      if (!notified && remove_waiter(parked.get())) {
+        // Timed out for real. Still give it one last shot.
+        slot = pop_slot();
+        record_wait(started);
+        if (!slot) {
+          ++timeouts_;
+          return Nothing;
+        }
+        return check_out(*slot);
+      }
+
+      slot = pop_slot();
+      if (slot) {
+        record_wait(started);
+        return check_out(*slot);
+      }
+      // Somebody else grabbed the connection on the fast path; wait again.
+    }
+  }
+
+  bool LimitedConnectionPool::remove_waiter(IConnectionWaiter* waiter) {
+    std::lock_guard<std::mutex> L(waiters_mutex_);
+    auto it = std::find(waiters_.begin(), waiters_.end(), waiter);
+    if (it != waiters_.end()) {
+      waiters_.erase(it);
+      --num_waiters_;
+      return true;
     }
-    return acquire_unlocked();
+    return false;
   }
 
-  AcquiredConnection LimitedConnectionPool::acquire_unlocked() {
-    auto conn = std::move(pool_.back());
-    pool_.pop_back();
-    AcquiredConnection ac{*this, *conn.get()};
-    reserved_.push_back(std::move(conn));
-    return std::move(ac);
+  void LimitedConnectionPool::record_wait(Clock::time_point started) {
+    int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - started).count();
+    total_wait_us_ += us;
+    int64_t max = max_wait_us_.load(std::memory_order_relaxed);
+    while (us > max && !max_wait_us_.compare_exchange_weak(max, us, std::memory_order_relaxed)) {}
   }
 
   void LimitedConnectionPool::release(IConnection* conn) {
-    std::lock_guard<std::mutex> L(mutex_);
-    auto it = std::find_if(reserved_.begin(), reserved_.end(), [&](const std::unique_ptr<IConnection>& ptr) { return ptr.get() == conn; });
-    if (it != reserved_.end()) {
-      std::swap(*it, reserved_.back());
-      auto c = std::move(reserved_.back());
-      reserved_.pop_back();
-      pool_.push_back(std::move(c));
-      available_.notify_one();
-    } else {
+    auto slot = dynamic_cast<PooledConnection*>(conn);
+    if (slot == nullptr || slot < &slots_[0] || slot >= &slots_[options_.max_connections]) {
       throw ConnectionPoolError("Tried to release a connection that wasn't reserved by this connection pool!");
     }
+    auto now = Clock::now();
+    slot->last_released = now;
+    slot->busy.store(false, std::memory_order_release);
+    --in_use_;
+    push((uint32_t)(slot - &slots_[0]));
+    notify_one_waiter();
+
+    if (options_.idle_timeout.count() && now.time_since_epoch().count() >= next_reap_.load(std::memory_order_relaxed)) {
+      reap_idle_connections(now);
+    }
+  }
+
+  /*
+    Free slots stay on the free list while they are examined, so nobody has to wait
+    for the reaper. An idle connection is detached from its slot under the slot's busy
+    flag, and closed only once every slot has been let go of. Closed slots keep their
+    place near the bottom of the stack, where the least recently used ones are.
+  */
+  void LimitedConnectionPool::reap_idle_connections(Clock::time_point now) {
+    std::unique_lock<std::mutex> L(reap_mutex_, std::try_to_lock);
+    if (!L.owns_lock()) {
+      return; // Somebody else is on it.
+    }
+    next_reap_ = (now + options_.idle_timeout / 2).time_since_epoch().count();
+
+    std::vector<std::unique_ptr<IConnection>> closing;
+    for (size_t i = 0; i < options_.max_connections && open_.load() > options_.min_connections; ++i) {
+      auto& slot = slots_[i];
+      bool expected = false;
+      if (!slot.busy.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+        continue; // Checked out.
+      }
+      if (slot.connection && now - slot.last_released >= options_.idle_timeout) {
+        closing.push_back(std::move(slot.connection));
+        --open_;
+      }
+      slot.busy.store(false, std::memory_order_release);
+    }
+    L.unlock();
+    closing.clear();
+  }
+
+  void LimitedConnectionPool::notify_one_waiter() {
+    if (num_waiters_.load(std::memory_order_seq_cst) == 0) {
+      return;
+    }
+    // Notify while holding the lock, so a waiter that is timing out can't be destroyed under us.
+    std::lock_guard<std::mutex> L(waiters_mutex_);
+    if (waiters_.size()) {
+      auto waiter = waiters_.front();
+      waiters_.pop_front();
+      --num_waiters_;
+      waiter->notify();
+    }
+  }
+
+  ConnectionPoolStats LimitedConnectionPool::stats() const {
+    ConnectionPoolStats s;
+    s.open_connections = open_.load();
+    s.reconnects = reconnects_.load();
+    s.acquisitions = acquisitions_.load();
+    s.waits = waits_.load();
+    s.timeouts = timeouts_.load();
+    s.total_wait_time = std::chrono::microseconds{total_wait_us_.load()};
+    s.max_wait_time = std::chrono::microseconds{max_wait_us_.load()};
+    return s;
+  }
+
+  namespace {
+    struct ThreadConnectionWaiter : IConnectionWaiter {
+      std::mutex mutex;
+      std::condition_variable cv;
+      bool notified = false;
+
+      bool wait_until(Clock::time_point deadline) final {
+        std::unique_lock<std::mutex> L(mutex);
+        if (deadline == Clock::time_point::max()) {
+          cv.wait(L, [&]() { return notified; });
+        } else {
+          cv.wait_until(L, deadline, [&]() { return notified; });
+        }
+        bool result = notified;
+        notified = false;
+        return result;
+      }
+
+      void notify() final {
+        std::lock_guard<std::mutex> L(mutex);
+        notified = true;
+        cv.notify_one();
+      }
+    };
+
+    /*
+      The releasing thread is usually not the one running the parked fiber's event
+      loop, and fibers may only be resumed from their own thread. So notify() posts
+      the resume to the loop the fiber is parked on.
+    */
+    struct FiberConnectionWaiter : IConnectionWaiter {
+      struct State {
+        std::mutex mutex;
+        bool notified = false;
+        bool timed_out = false;
+        wayward::FiberPtr fiber;
+        wayward::IEventLoop* loop = nullptr;
+
+        void wake() {
+          wayward::FiberPtr f;
+          {
+            std::lock_guard<std::mutex> L(mutex);
+            f = std::move(fiber);
+          }
+          if (f) {
+            wayward::fiber::resume(std::move(f));
+          }
+        }
+      };
+      std::shared_ptr<State> state = std::make_shared<State>();
+
+      bool wait_until(Clock::time_point deadline) final {
+        auto s = state;
+        s->loop = wayward::current_event_loop();
+        s->timed_out = false;
+        std::unique_ptr<wayward::IEventHandle> timer;
+        if (deadline != Clock::time_point::max()) {
+          auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::max(deadline - Clock::now(), Clock::duration::zero()));
+          timer = s->loop->call_in(wayward::Microseconds{us}, [s]() {
+            {
+              std::lock_guard<std::mutex> L(s->mutex);
+              s->timed_out = true;
+            }
+            s->wake();
+          });
+        }
+
+        // Stale wakeups from an earlier wait just park the fiber again.
+        while (true) {
+          {
+            std::lock_guard<std::mutex> L(s->mutex);
+            if (s->notified || s->timed_out || Clock::now() >= deadline) {
+              s->fiber = nullptr;
+              bool result = s->notified;
+              s->notified = false;
+              return result;
+            }
+            s->fiber = wayward::fiber::current();
+          }
+          wayward::fiber::yield();
+        }
+      }
+
+      void notify() final {
+        auto s = state;
+        wayward::IEventLoop* loop;
+        {
+          std::lock_guard<std::mutex> L(s->mutex);
+          s->notified = true;
+          loop = s->fiber ? s->loop : nullptr;
+        }
+        if (loop) {
+          loop->post([s]() { s->wake(); });
+        }
+      }
+    };
+
+    ConnectionWaiterFactory default_connection_waiter_factory() {
+      return []() {
+        if (wayward::current_event_loop() && wayward::fiber::can_yield()) {
+          return make_fiber_connection_waiter();
+        }
+        return make_thread_connection_waiter();
+      };
+    }
+
+    ConnectionWaiterFactory& connection_waiter_factory() {
+      static ConnectionWaiterFactory factory = default_connection_waiter_factory();
+      return factory;
+    }
+  }
+
+  void set_connection_waiter_factory(ConnectionWaiterFactory factory) {
+    connection_waiter_factory() = factory ? std::move(factory) : default_connection_waiter_factory();
+  }
+
+  std::unique_ptr<IConnectionWaiter> make_thread_connection_waiter() {
+    return std::unique_ptr<IConnectionWaiter>(new ThreadConnectionWaiter);
+  }
+
+  std::unique_ptr<IConnectionWaiter> make_fiber_connection_waiter() {
+    return std::unique_ptr<IConnectionWaiter>(new FiberConnectionWaiter);
   }
 
   AcquiredConnection::AcquiredConnection(AcquiredConnection&& other) {
@@ -7,6 +7,9 @@
 #include <wayward/support/error.hpp>
 #include <wayward/support/any.hpp>
 
+#include <chrono>
+#include <functional>
+
 namespace persistence {
   struct IConnectionPool;
   struct IAdapter;
@@ -29,6 +32,11 @@ namespace persistence {
     std::unique_ptr<IResultSet> execute(std::string sql) final { return connection_->execute(std::move(sql)); }
     std::unique_ptr<IResultSet> execute(const ast::IQuery& query) final { return connection_->execute(query); }
     std::unique_ptr<IResultSet> execute(const ast::IQuery& query, const relational_algebra::IResolveSymbolicRelation& rel) final { return connection_->execute(query, rel); }
+    std::vector<std::unique_ptr<IResultSet>> execute_batch(const std::vector<std::string>& sql) final { return connection_->execute_batch(sql); }
+    size_t copy_in(const std::string& relation, const std::vector<std::string>& columns, const std::string& data) final { return connection_->copy_in(relation, columns, data); }
+    bool ping() final { return connection_->ping(); }
+    bool reconnect() final { return connection_->reconnect(); }
+    bool in_transaction() final { return connection_->in_transaction(); }
     std::shared_ptr<ILogger> logger() const final { return connection_->logger(); }
     void set_logger(std::shared_ptr<ILogger> l) final { connection_->set_logger(std::move(l)); }
   private:
@@ -38,10 +46,33 @@ namespace persistence {
     void release();
   };
 
+  struct ConnectionPoolOptions {
+    size_t max_connections = 5;
+    size_t min_connections = 0; // Idle connections below this count are never closed.
+    // Connections unused for longer than this are closed, and reopened on demand. Zero disables.
+    std::chrono::milliseconds idle_timeout = std::chrono::minutes(5);
+    // Connections unused for longer than this are pinged before being handed out,
+    // and reset if the server doesn't answer. Zero disables.
+    std::chrono::milliseconds validate_after = std::chrono::seconds(30);
+  };
+
+  struct ConnectionPoolStats {
+    size_t open_connections = 0;
+    uint64_t reconnects = 0;   // Broken connections found on checkout and reset.
+    uint64_t acquisitions = 0; // Connections handed out.
+    uint64_t waits = 0;        // Acquisitions that found the pool empty and had to wait.
+    uint64_t timeouts = 0;     // Waits that gave up before a connection became available.
+    std::chrono::microseconds total_wait_time {0};
+    std::chrono::microseconds max_wait_time {0};
+  };
+
   struct IConnectionPool {
     virtual ~IConnectionPool() {}
     virtual Maybe<AcquiredConnection> try_acquire() = 0;
     virtual AcquiredConnection acquire() = 0;
+    // Waits at most `timeout` for a connection. Returns Nothing if none became available.
+    virtual Maybe<AcquiredConnection> try_acquire_for(std::chrono::milliseconds timeout) = 0;
+    virtual ConnectionPoolStats stats() const = 0;
   protected:
     friend struct AcquiredConnection;
     virtual void release(IConnection*) = 0;
@@ -51,6 +82,31 @@ namespace persistence {
     ConnectionPoolError(const std::string& str) : wayward::Error(str) {}
   };
 
+  /*
+    Parks a caller of acquire() while the pool is empty. The pool calls notify()
+    from whichever thread released a connection.
+  */
+  struct IConnectionWaiter {
+    virtual ~IConnectionWaiter() {}
+    // Returns false if the deadline passed before notify() was called.
+    virtual bool wait_until(std::chrono::steady_clock::time_point deadline) = 0;
+    virtual void notify() = 0;
+  };
+
+  using ConnectionWaiterFactory = std::function<std::unique_ptr<IConnectionWaiter>()>;
+
+  /*
+    The default factory parks the current fiber when running inside one (as HTTP
+    handlers do), and blocks the thread otherwise. Pass nullptr to restore it.
+  */
+  void set_connection_waiter_factory(ConnectionWaiterFactory);
+  std::unique_ptr<IConnectionWaiter> make_thread_connection_waiter();
+  std::unique_ptr<IConnectionWaiter> make_fiber_connection_waiter();
+
+  /*
+    Connections are opened lazily, up to options.max_connections.
+  */
+  std::unique_ptr<IConnectionPool> make_connection_pool(const IAdapter& adapter, std::string connection_string, const ConnectionPoolOptions& options);
   std::unique_ptr<IConnectionPool> make_limited_connection_pool(const IAdapter& adapter, std::string connection_string, size_t pool_size);
 }
 
@@ -1,20 +1,53 @@
 #include <persistence/connection_provider.hpp>
 #include <persistence/connection_pool.hpp>
 #include <persistence/data_store.hpp>
+#include <wayward/support/fiber.hpp>
 
 namespace persistence {
+  void RecentWrites::record(const std::string& data_store_name) {
+    std::lock_guard<std::mutex> L(mutex_);
+    last_write_[data_store_name] = std::chrono::steady_clock::now();
+  }
+
+  bool RecentWrites::within(const std::string& data_store_name, std::chrono::milliseconds window) const {
+    std::lock_guard<std::mutex> L(mutex_);
+    auto it = last_write_.find(data_store_name);
+    return it != last_write_.end() && std::chrono::steady_clock::now() - it->second < window;
+  }
+
   AcquiredConnection DefaultConnectionProvider::acquire_connection_for_data_store(const std::string& data_store_name) {
     auto& ds = data_store(data_store_name);
+    if (ds.has_replicas()) {
+      recent_writes_.record(data_store_name);
+    }
+    return ds.acquire();
+  }
+
+  AcquiredConnection DefaultConnectionProvider::acquire_read_connection_for_data_store(const std::string& data_store_name) {
+    auto& ds = data_store(data_store_name);
+    if (ds.has_replicas() && !recent_writes_.within(data_store_name, ds.read_your_writes_window())) {
+      return ds.acquire_replica();
+    }
     return ds.acquire();
   }
 
   namespace {
-    static DefaultConnectionProvider g_default_connection_provider = DefaultConnectionProvider();
-    __thread IConnectionProvider* g_current_connection_provider = &g_default_connection_provider;
+    static DefaultConnectionProvider g_default_connection_provider;
+    // Fiber-local: a request fiber may be parked mid-request while others run on the same thread.
+    static const char g_current_connection_provider_key = 0;
+
+    IConnectionProvider* current_provider_or_null() {
+      return static_cast<IConnectionProvider*>(wayward::fiber::get_local(&g_current_connection_provider_key));
+    }
+
+    void set_current_provider(IConnectionProvider* provider) {
+      wayward::fiber::set_local(&g_current_connection_provider_key, provider);
+    }
   }
 
   IConnectionProvider& current_connection_provider() {
-    return *g_current_connection_provider;
+    auto provider = current_provider_or_null();
+    return provider ? *provider : g_default_connection_provider;
   }
 
   void with_connection_provider(IConnectionProvider& provider, std::function<void()> callback) {
@@ -22,12 +55,12 @@ namespace persistence {
       IConnectionProvider* previous;
       PopConnectionProvider(IConnectionProvider* connection_provider) : previous(connection_provider) {}
       ~PopConnectionProvider() {
-        g_current_connection_provider = previous;
+        set_current_provider(previous);
       }
     };
 
-    PopConnectionProvider pop{g_current_connection_provider};
-    g_current_connection_provider = &provider;
+    PopConnectionProvider pop{current_provider_or_null()};
+    set_current_provider(&provider);
     callback();
   }
 }
@@ -4,19 +4,43 @@
 
 #include <string>
 #include <functional>
+#include <chrono>
+#include <map>
+#include <mutex>
 
 namespace persistence {
   struct AcquiredConnection;
 
   struct IConnectionProvider {
+    // A connection to the primary, for writes.
     virtual AcquiredConnection acquire_connection_for_data_store(const std::string& data_store_name) = 0;
+    // A connection for a read-only query, which may be served by a replica.
+    virtual AcquiredConnection acquire_read_connection_for_data_store(const std::string& data_store_name) = 0;
   };
 
   /*
-    This just does a plain datastore->acquire.
+    Remembers when each data store was last written to, so that reads following a
+    write can stay on the primary until the replicas have caught up.
+  */
+  struct RecentWrites {
+    void record(const std::string& data_store_name);
+    bool within(const std::string& data_store_name, std::chrono::milliseconds window) const;
+  private:
+    mutable std::mutex mutex_;
+    std::map<std::string, std::chrono::steady_clock::time_point> last_write_;
+  };
+
+  /*
+    This just does a plain datastore->acquire. Reads go to a replica unless this
+    provider wrote to the data store recently. Give each request its own provider
+    (see with_connection_provider), so that one request's writes don't send
+    everybody else's reads to the primary.
   */
   struct DefaultConnectionProvider : IConnectionProvider {
     AcquiredConnection acquire_connection_for_data_store(const std::string& data_store_name) final;
+    AcquiredConnection acquire_read_connection_for_data_store(const std::string& data_store_name) final;
+  private:
+    RecentWrites recent_writes_;
   };
 
   IConnectionProvider& current_connection_provider();
@@ -19,6 +19,9 @@ namespace persistence {
     std::vector<std::string> necessary_data_stores_;
     std::map<std::string, AcquiredConnection> acquired_connections_;
     size_t loaned_out_ = 0;
+    RecentWrites recent_writes_;
+
+    AcquiredConnection loan(const std::string& data_store_name);
 
     bool is_aquired() const;
     void acquire_all();
@@ -30,6 +33,8 @@ namespace persistence {
     // IConnectionPool interface
     Maybe<AcquiredConnection> try_acquire() final;
     AcquiredConnection acquire() final;
+    Maybe<AcquiredConnection> try_acquire_for(std::chrono::milliseconds) final;
+    ConnectionPoolStats stats() const final;
     void release(IConnection*) final;
   };
 
@@ -42,11 +47,32 @@ namespace persistence {
   }
 
   AcquiredConnection ConnectionRetainer::acquire_connection_for_data_store(const std::string& data_store_name) {
-    impl->acquire_all();
-    auto it = impl->acquired_connections_.find(data_store_name);
-    if (it != impl->acquired_connections_.end()) {
-      ++impl->loaned_out_;
-      return AcquiredConnection{*impl, it->second};
+    auto conn = impl->loan(data_store_name);
+    if (data_store(data_store_name).has_replicas()) {
+      impl->recent_writes_.record(data_store_name);
+    }
+    return conn;
+  }
+
+  AcquiredConnection ConnectionRetainer::acquire_read_connection_for_data_store(const std::string& data_store_name) {
+    auto& ds = data_store(data_store_name);
+    if (ds.has_replicas() && !impl->recent_writes_.within(data_store_name, ds.read_your_writes_window())) {
+      // Without a replica, read from the primary connection we retain. Acquiring another
+      // one from the pool could wait forever on connections held by this very request.
+      auto conn = ds.acquire_replica_only();
+      if (conn) {
+        return std::move(*conn);
+      }
+    }
+    return impl->loan(data_store_name);
+  }
+
+  AcquiredConnection ConnectionRetainer::Impl::loan(const std::string& data_store_name) {
+    acquire_all();
+    auto it = acquired_connections_.find(data_store_name);
+    if (it != acquired_connections_.end()) {
+      ++loaned_out_;
+      return AcquiredConnection{*this, it->second};
     }
     throw ConnectionRetainerError{wayward::format("Data store '{0}' not supported by this ConnectionRetainer.", data_store_name)};
   }
@@ -67,6 +93,7 @@ namespace persistence {
   }
 
   void ConnectionRetainer::Impl::acquire_all() {
+    if (is_aquired()) return;
     // Keep trying until we have them all.
     while (!acquire_at_index_recursive(0, true));
   }
@@ -103,6 +130,14 @@ namespace persistence {
     return AcquiredConnection();
   }
 
+  Maybe<AcquiredConnection> ConnectionRetainer::Impl::try_acquire_for(std::chrono::milliseconds) {
+    return wayward::Nothing;
+  }
+
+  ConnectionPoolStats ConnectionRetainer::Impl::stats() const {
+    return ConnectionPoolStats{};
+  }
+
   void ConnectionRetainer::Impl::release(IConnection* connection) {
     --loaned_out_;
   }
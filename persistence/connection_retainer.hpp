@@ -27,6 +27,9 @@ namespace persistence {
   struct ConnectionRetainer : IConnectionProvider {
     // IConnectionProvider interface
     AcquiredConnection acquire_connection_for_data_store(const std::string& data_store_name);
+    // Reads are served by a replica, outside the retained connections, unless this retainer
+    // wrote to the data store within its read-your-writes window.
+    AcquiredConnection acquire_read_connection_for_data_store(const std::string& data_store_name);
 
     // ConnectionRetainer interface
     explicit ConnectionRetainer(IConnectionProvider& previous, std::vector<std::string> data_store_names);
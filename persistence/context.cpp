@@ -0,0 +1,10 @@
+#include "persistence/context.hpp"
+
+#include <atomic>
+
+namespace persistence {
+  size_t Context::allocate_pool_index() {
+    static std::atomic<size_t> next_index { 0 };
+    return next_index++;
+  }
+}
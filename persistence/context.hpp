@@ -3,52 +3,189 @@
 #define PERSISTENCE_CONTEXT_HPP_INCLUDED
 
 #include <memory>
-#include <deque>
-#include <map>
+#include <vector>
+#include <unordered_map>
+#include <type_traits>
 
 #include <persistence/record_ptr.hpp>
 #include <persistence/record_type.hpp>
+#include <persistence/record_snapshot.hpp>
+#include <persistence/primary_key.hpp>
 
 namespace persistence {
-  struct ContextLifetimeSentinel {};
-
   struct Context {
-    Context() : sentinel_(std::make_shared<ContextLifetimeSentinel>()) {}
+    Context() : sentinel_(std::make_shared<ContextLifetimeSentinel>()) { sentinel_->context = this; }
     ~Context();
 
     struct IPool {
       virtual ~IPool() {}
     };
 
+    /*
+      Records are allocated contiguously in fixed-size slabs and never move.
+      They live until the pool is destroyed, which destroys them in allocation order.
+    */
     template <typename T>
     struct Pool : IPool {
-      std::deque<std::unique_ptr<T>> objects_;
+      static const size_t SlabBytes = 64 * 1024;
+      static const size_t RecordsPerSlab = sizeof(T) < SlabBytes ? SlabBytes / sizeof(T) : 1;
+      using Storage = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+      ~Pool() {
+        for (size_t i = 0; i < slabs_.size(); ++i) {
+          size_t n = (i + 1 == slabs_.size()) ? used_in_last_slab_ : RecordsPerSlab;
+          for (size_t j = 0; j < n; ++j) {
+            reinterpret_cast<T*>(&slabs_[i][j])->~T();
+          }
+        }
+      }
+
+      T* allocate() {
+        if (used_in_last_slab_ == RecordsPerSlab) {
+          slabs_.emplace_back(new Storage[RecordsPerSlab]);
+          used_in_last_slab_ = 0;
+        }
+        T* ptr = new(&slabs_.back()[used_in_last_slab_]) T;
+        ++used_in_last_slab_;
+        return ptr;
+      }
+
+      size_t size() const {
+        return slabs_.size() ? (slabs_.size() - 1) * RecordsPerSlab + used_in_last_slab_ : 0;
+      }
+
+    private:
+      std::vector<std::unique_ptr<Storage[]>> slabs_;
+      size_t used_in_last_slab_ = RecordsPerSlab;
     };
 
     template <typename T>
     RecordPtr<T> create() {
-      auto it = pools_.find(get_type<T>());
-      Pool<T>* pool = nullptr;
-      if (it == pools_.end()) {
-        pool = new Pool<T>();
-        pools_[get_type<T>()] = std::unique_ptr<IPool>(pool);
-      } else {
-        pool = dynamic_cast<Pool<T>*>(it->second.get());
-      }
-      auto ptr = std::unique_ptr<T>(new T);
-      get_type<T>()->initialize_associations_in_object(ptr.get(), this);
-      RecordPtr<T> rptr { ptr.get(), sentinel_ };
-      pool->objects_.push_back(std::move(ptr));
-      return std::move(rptr);
+      T* ptr = pool_for<T>().allocate();
+      get_type<T>()->initialize_associations_in_object(ptr, this);
+      return RecordPtr<T>{ ptr, sentinel_ };
+    }
+
+    // Number of records of type T allocated in this context.
+    template <typename T>
+    size_t num_allocated() const {
+      size_t index = pool_index<T>();
+      return index < pools_.size() && pools_[index] ? static_cast<const Pool<T>*>(pools_[index].get())->size() : 0;
     }
 
     void clear() {
+      identities_.clear();
+      snapshots_.clear();
       pools_.clear();
     }
 
+    // Dirty tracking. The snapshot is the record as last seen in the data store.
+    template <typename T>
+    void remember_snapshot(const T& record) {
+      snapshots_[&record] = take_snapshot(record, get_type<T>());
+    }
+
+    RecordSnapshot& snapshot_for(const void* record) {
+      return snapshots_[record];
+    }
+
+    void forget_snapshot(const void* record) {
+      snapshots_.erase(record);
+    }
+
+    // Identity map: at most one record per (type, primary key) is materialized in a context.
+    template <typename T>
+    RecordPtr<T> find_loaded(int64 id) const {
+      auto it = identities_.find(IdentityKey{get_type<T>(), id});
+      if (it == identities_.end()) {
+        return RecordPtr<T>{};
+      }
+      return RecordPtr<T>{ static_cast<T*>(it->second), sentinel_ };
+    }
+
+    template <typename T>
+    void remember_identity(const RecordPtr<T>& record, int64 id) {
+      identities_[IdentityKey{get_type<T>(), id}] = record.get();
+    }
+
+    template <typename T>
+    void remember_identity(const RecordPtr<T>& record) {
+      auto id = primary_key_of(*record);
+      if (id) {
+        remember_identity(record, *id);
+      }
+    }
+
+    // Forgets every loaded record of a type, and its snapshot. For when rows were deleted wholesale.
+    void forget_all_of_type(const IRecordType* type) {
+      for (auto it = identities_.begin(); it != identities_.end();) {
+        if (it->first.type == type) {
+          snapshots_.erase(it->second);
+          it = identities_.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+
+    template <typename T>
+    void forget_identity(const RecordPtr<T>& record) {
+      auto id = primary_key_of(*record);
+      if (id) {
+        auto it = identities_.find(IdentityKey{get_type<T>(), *id});
+        if (it != identities_.end() && it->second == record.get()) {
+          identities_.erase(it);
+        }
+      }
+    }
+
   private:
-    using PoolMap = std::map<const IRecordType*, std::unique_ptr<IPool>>;
-    PoolMap pools_;
+    struct IdentityKey {
+      const IRecordType* type;
+      int64 id;
+      bool operator==(const IdentityKey& other) const { return type == other.type && id == other.id; }
+    };
+
+    struct IdentityKeyHash {
+      size_t operator()(const IdentityKey& key) const {
+        return std::hash<const void*>()(key.type) * 31 + std::hash<int64>()(key.id);
+      }
+    };
+
+    // Every record type gets a small dense index on first use, so pool lookup is a vector access.
+    static size_t allocate_pool_index();
+
+    template <typename T>
+    static size_t pool_index() {
+      static const size_t index = allocate_pool_index();
+      return index;
+    }
+
+    template <typename T>
+    Pool<T>& pool_for() {
+      size_t index = pool_index<T>();
+      if (index >= pools_.size()) {
+        pools_.resize(index + 1);
+      }
+      auto& pool = pools_[index];
+      if (!pool) {
+        pool.reset(new Pool<T>);
+      }
+      return *static_cast<Pool<T>*>(pool.get());
+    }
+
+    template <typename T>
+    static Maybe<int64> primary_key_of(const T& record) {
+      auto pk = dynamic_cast<const PropertyOf<T, PrimaryKey>*>(get_type<T>()->primary_key());
+      if (pk == nullptr || !pk->get_known(record).is_persisted()) {
+        return wayward::Nothing;
+      }
+      return pk->get_known(record).id;
+    }
+
+    std::vector<std::unique_ptr<IPool>> pools_;
+    std::unordered_map<IdentityKey, void*, IdentityKeyHash> identities_;
+    std::unordered_map<const void*, RecordSnapshot> snapshots_;
     std::shared_ptr<ContextLifetimeSentinel> sentinel_;
   };
 
@@ -0,0 +1,75 @@
+#include "persistence/data_as_text.hpp"
+
+#include <wayward/support/data_visitor.hpp>
+#include <wayward/support/datetime.hpp>
+
+#include <sstream>
+#include <iomanip>
+
+namespace persistence {
+  using wayward::AnyRef;
+  using wayward::TypeError;
+  using wayward::DateTime;
+
+  struct DataAsText::Visitor : wayward::DataVisitor {
+    std::string& out;
+    Visitor(std::string& out) : out(out) {}
+
+    template <class T>
+    void write_number(T value) {
+      std::stringstream ss;
+      ss << std::setprecision(17) << value;
+      out += ss.str();
+    }
+
+    void write_escaped(const std::string& str) {
+      for (char c: str) {
+        switch (c) {
+          case '\\': out += "\\\\"; break;
+          case '\n': out += "\\n"; break;
+          case '\r': out += "\\r"; break;
+          case '\t': out += "\\t"; break;
+          default: out += c; break;
+        }
+      }
+    }
+
+    void visit_nil() final { out += "\\N"; }
+    void visit_boolean(bool& value) final { out += value ? 't' : 'f'; }
+    void visit_int8(std::int8_t& value) final { write_number((int)value); }
+    void visit_int16(std::int16_t& value) final { write_number(value); }
+    void visit_int32(std::int32_t& value) final { write_number(value); }
+    void visit_int64(std::int64_t& value) final { write_number(value); }
+    void visit_uint8(std::uint8_t& value) final { write_number((unsigned)value); }
+    void visit_uint16(std::uint16_t& value) final { write_number(value); }
+    void visit_uint32(std::uint32_t& value) final { write_number(value); }
+    void visit_uint64(std::uint64_t& value) final { write_number(value); }
+    void visit_float(float& value) final { write_number(value); }
+    void visit_double(double& value) final { write_number(value); }
+    void visit_string(std::string& value) final { write_escaped(value); }
+
+    void visit_key_value(const std::string& key, AnyRef data, const IType* type) final {
+      throw TypeError{"Cannot represent key-value data type as column text."};
+    }
+
+    void visit_element(std::int64_t idx, AnyRef data, const IType* type) final {
+      throw TypeError{"Cannot represent list data type as column text."};
+    }
+
+    void visit_special(AnyRef data, const IType* type) final {
+      if (data.is_a<DateTime>()) {
+        write_escaped(data.get<const DateTime&>()->iso8601());
+      } else {
+        throw TypeError{wayward::format("Unsupported type in column text: {0}", type->name())};
+      }
+    }
+
+    bool can_modify() const final { return false; }
+    bool is_nil_at_current() const final { return false; }
+  };
+
+  void DataAsText::append(AnyConstRef data, const IType* type) {
+    Visitor visitor { out_ };
+    type->visit_data(data, visitor);
+  }
+}
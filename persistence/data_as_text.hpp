@@ -0,0 +1,35 @@
+#pragma once
+#ifndef PERSISTENCE_DATA_AS_TEXT_HPP_INCLUDED
+#define PERSISTENCE_DATA_AS_TEXT_HPP_INCLUDED
+
+#include <wayward/support/data_visitor.hpp>
+#include <wayward/support/any.hpp>
+
+#include <string>
+
+namespace persistence {
+  using wayward::AnyConstRef;
+  using wayward::IType;
+
+  /*
+    Renders values in the PostgreSQL COPY text format: NULL is \N, and backslashes,
+    tabs, newlines and carriage returns are escaped. The rendering is unambiguous, so
+    it doubles as the canonical form for comparing values that have no typed equality.
+  */
+  struct DataAsText {
+    struct Visitor;
+
+    explicit DataAsText(std::string& out) : out_(out) {}
+
+    template <class T>
+    void append(const T& data) {
+      append(data, wayward::get_type<T>());
+    }
+
+    void append(AnyConstRef, const IType*);
+  private:
+    std::string& out_;
+  };
+}
+
+#endif // PERSISTENCE_DATA_AS_TEXT_HPP_INCLUDED
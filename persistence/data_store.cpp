@@ -9,16 +9,100 @@
 namespace persistence {
   using wayward::URI;
   using wayward::ILogger;
+  using wayward::Nothing;
+
+  namespace {
+    ConnectionPoolOptions pool_options(const DataStoreOptions& options) {
+      ConnectionPoolOptions pool;
+      pool.max_connections = options.pool_size;
+      pool.min_connections = options.pool_min_size;
+      pool.idle_timeout = options.pool_idle_timeout;
+      pool.validate_after = options.pool_validate_after;
+      return pool;
+    }
+  }
 
   DataStore::DataStore(std::string name, std::string connection_url, const DataStoreOptions& options)
   : name(std::move(name))
   , connection_url(connection_url)
   , logger_(options.logger)
-  , pool(make_limited_connection_pool(adapter_or_error(connection_url), connection_url, options.pool_size))
-  {}
+  , acquire_timeout_(options.acquire_timeout)
+  , pool(make_connection_pool(adapter_or_error(connection_url), connection_url, pool_options(options)))
+  , replica_down_until_(new std::atomic<int64_t>[options.replica_urls.size()])
+  , replica_retry_after_(options.replica_retry_after)
+  , read_your_writes_window_(options.read_your_writes_window)
+  , query_cache_(options.query_cache.enabled ? new QueryCache(options.query_cache) : nullptr)
+  {
+    for (size_t i = 0; i < options.replica_urls.size(); ++i) {
+      auto& url = options.replica_urls[i];
+      replica_pools_.push_back(make_connection_pool(adapter_or_error(url), url, pool_options(options)));
+      replica_down_until_[i].store(0, std::memory_order_relaxed);
+    }
+  }
 
   AcquiredConnection DataStore::acquire() {
-    auto conn = pool->acquire();
+    return acquire_from(*pool);
+  }
+
+  AcquiredConnection DataStore::acquire_replica() {
+    auto conn = acquire_replica_only();
+    return conn ? std::move(*conn) : acquire();
+  }
+
+  Maybe<AcquiredConnection> DataStore::acquire_replica_only() {
+    if (replica_pools_.empty()) {
+      return Nothing;
+    }
+    auto now = std::chrono::steady_clock::now();
+    size_t n = replica_pools_.size();
+    size_t start = next_replica_++ % n;
+    Maybe<size_t> first_up;
+    for (size_t i = 0; i < n; ++i) {
+      size_t index = (start + i) % n;
+      if (!replica_is_up(index, now)) {
+        continue;
+      }
+      try {
+        auto mconn = replica_pools_[index]->try_acquire();
+        if (mconn) {
+          mconn->set_logger(logger());
+          return std::move(*mconn);
+        }
+        if (!first_up) first_up = index;
+      }
+      catch (const wayward::Error& error) {
+        replica_down_until_[index].store((now + replica_retry_after_).time_since_epoch().count(), std::memory_order_relaxed);
+        WAYWARD_LOG(logger(), wayward::Severity::Warning, "p", wayward::format("Replica of data store '{0}' unavailable, skipping it for {1}ms: {2}", name, replica_retry_after_.count(), error.what()));
+      }
+    }
+    if (!first_up) {
+      // Every replica is down.
+      return Nothing;
+    }
+    // Everything is busy, so wait in line at the first live replica whose turn it was.
+    try {
+      return acquire_from(*replica_pools_[*first_up]);
+    }
+    catch (const wayward::Error& error) {
+      WAYWARD_LOG(logger(), wayward::Severity::Warning, "p", wayward::format("Replica of data store '{0}' unavailable, reading from primary: {1}", name, error.what()));
+      return Nothing;
+    }
+  }
+
+  bool DataStore::replica_is_up(size_t index, std::chrono::steady_clock::time_point now) const {
+    return replica_down_until_[index].load(std::memory_order_relaxed) <= now.time_since_epoch().count();
+  }
+
+  AcquiredConnection DataStore::acquire_from(IConnectionPool& pool) {
+    if (acquire_timeout_.count() > 0) {
+      auto mconn = pool.try_acquire_for(acquire_timeout_);
+      if (!mconn) {
+        throw ConnectionPoolError(wayward::format("Timed out after {0}ms waiting for a connection to data store '{1}'.", acquire_timeout_.count(), name));
+      }
+      mconn->set_logger(logger());
+      return std::move(*mconn);
+    }
+    auto conn = pool.acquire();
     conn.set_logger(logger());
     return conn;
   }
@@ -70,6 +154,18 @@ namespace persistence {
     return data_store("default");
   }
 
+  QueryCache* query_cache_for(const std::string& data_store_name) {
+    auto it = g_data_stores.find(data_store_name);
+    return it != g_data_stores.end() ? it->second->query_cache() : nullptr;
+  }
+
+  void invalidate_cached_queries(const std::string& data_store_name, const std::string& relation) {
+    auto cache = query_cache_for(data_store_name);
+    if (cache) {
+      cache->invalidate(relation);
+    }
+  }
+
   DataStore& data_store(const std::string& name) {
     auto it = g_data_stores.find(name);
     if (it != g_data_stores.end()) {
@@ -3,8 +3,11 @@
 #define PERSISTENCE_DATA_STORE_HPP_INCLUDED
 
 #include <string>
+#include <vector>
+#include <atomic>
 
 #include <persistence/connection_pool.hpp>
+#include <persistence/query_cache.hpp>
 #include <wayward/support/logger.hpp>
 #include <wayward/support/error.hpp>
 
@@ -12,8 +15,21 @@ namespace persistence {
   using wayward::ILogger;
 
   struct DataStoreOptions {
-    size_t pool_size = 5;
+    size_t pool_size = 5; // Connections are opened on demand, up to this many.
+    size_t pool_min_size = 0; // Idle connections are not closed below this count.
+    std::chrono::milliseconds pool_idle_timeout = std::chrono::minutes(5); // See ConnectionPoolOptions.
+    std::chrono::milliseconds pool_validate_after = std::chrono::seconds(30);
+    std::chrono::milliseconds acquire_timeout {0}; // Wait indefinitely for a connection if zero.
     std::shared_ptr<ILogger> logger = nullptr; // Uses console output if left as null.
+    QueryCacheOptions query_cache; // Disabled by default.
+
+    // Read-only replicas of the primary. Each gets its own pool with the settings above.
+    std::vector<std::string> replica_urls;
+    // After a write, reads from the same connection provider stay on the primary this long,
+    // so they see the write even if the replicas are lagging.
+    std::chrono::milliseconds read_your_writes_window = std::chrono::seconds(2);
+    // A replica that can't be reached is skipped this long before it is tried again.
+    std::chrono::milliseconds replica_retry_after = std::chrono::seconds(5);
   };
 
   struct DataStoreError : wayward::Error {
@@ -26,14 +42,37 @@ namespace persistence {
 
     AcquiredConnection acquire();
     Maybe<AcquiredConnection> try_acquire();
+    ConnectionPoolStats pool_stats() const { return pool->stats(); }
+
+    // Round-robins over the replicas, preferring one with an idle connection.
+    // Falls back to the primary if there are no replicas, or none can be reached.
+    // Replicas that fail to connect are left alone for replica_retry_after.
+    AcquiredConnection acquire_replica();
+    // Like acquire_replica(), but returns Nothing instead of falling back to the primary.
+    Maybe<AcquiredConnection> acquire_replica_only();
+    bool has_replicas() const { return replica_pools_.size() != 0; }
+    std::chrono::milliseconds read_your_writes_window() const { return read_your_writes_window_; }
 
     const std::shared_ptr<ILogger>& logger();
     void set_logger(std::shared_ptr<ILogger>);
+
+    // nullptr unless enabled in DataStoreOptions.
+    QueryCache* query_cache() { return query_cache_.get(); }
   private:
     std::string name;
     std::string connection_url;
     std::shared_ptr<ILogger> logger_;
+    std::chrono::milliseconds acquire_timeout_;
     std::unique_ptr<IConnectionPool> pool;
+    std::vector<std::unique_ptr<IConnectionPool>> replica_pools_;
+    std::atomic<size_t> next_replica_ {0};
+    std::unique_ptr<std::atomic<int64_t>[]> replica_down_until_; // Steady clock ticks.
+    std::chrono::milliseconds replica_retry_after_;
+    std::chrono::milliseconds read_your_writes_window_;
+    std::unique_ptr<QueryCache> query_cache_;
+
+    AcquiredConnection acquire_from(IConnectionPool&);
+    bool replica_is_up(size_t index, std::chrono::steady_clock::time_point now) const;
 
     const IAdapter& adapter_or_error(const std::string& connection_url);
   };
@@ -43,6 +82,12 @@ namespace persistence {
 
   DataStore& data_store();
   DataStore& data_store(const std::string& name);
+
+  // The query cache of the named data store, or nullptr if it doesn't exist or has caching disabled.
+  QueryCache* query_cache_for(const std::string& data_store_name);
+
+  // Drops cached queries that read from `relation`. Called by persistence after every write.
+  void invalidate_cached_queries(const std::string& data_store_name, const std::string& relation);
 }
 
 #endif // PERSISTENCE_DATA_STORE_HPP_INCLUDED
@@ -0,0 +1,59 @@
+#include "persistence/destroy.hpp"
+#include "persistence/ast.hpp"
+#include "persistence/connection_pool.hpp"
+#include "persistence/data_store.hpp"
+#include "persistence/record_type.hpp"
+#include "persistence/record.hpp"
+#include "persistence/primary_key.hpp"
+#include "persistence/data_as_literal.hpp"
+
+#include <wayward/support/format.hpp>
+
+namespace persistence {
+  namespace detail {
+    using wayward::make_error;
+    using wayward::make_cloning_ptr;
+
+    Result<size_t>
+    destroy(AnyRef record, const IRecordType* record_type) {
+      auto pk = record_type->abstract_primary_key();
+      if (pk == nullptr) {
+        return make_error<PrimaryKeyError>("This record class does not seem to have a primary key column defined.");
+      }
+      auto id = pk->get(record);
+      if (!id) {
+        return std::move(id).error();
+      }
+      if (!id.get().get<PrimaryKey&>()->is_persisted()) {
+        return make_error<PrimaryKeyError>("Cannot DELETE because the record is new and doesn't have a primary key.");
+      }
+
+      ast::DeleteQuery query;
+      query.relation = record_type->relation();
+      DataAsLiteral data_as_literal;
+      query.where = make_cloning_ptr(new ast::BinaryCondition{
+        make_cloning_ptr(new ast::ColumnReference{record_type->relation(), pk->column()}),
+        data_as_literal.make_literal(id.get(), &pk->type()),
+        ast::BinaryCondition::Eq
+      });
+
+      auto conn = current_connection_provider().acquire_connection_for_data_store(record_type->data_store());
+      WAYWARD_LOG(conn.logger(), wayward::Severity::Debug, "p", wayward::format("Delete {0}", record_type->name()));
+      std::unique_ptr<IResultSet> results;
+      try {
+        results = conn.execute(query);
+      }
+      catch (const wayward::Error& error) {
+        WAYWARD_LOG(conn.logger(), wayward::Severity::Error, "p", wayward::format("Error executing SQL:\n{0}", error.what()));
+      }
+      invalidate_cached_queries(record_type->data_store(), record_type->relation());
+      if (!results) {
+        return make_error<PersistError>("Backend did not return any results (meaning DELETE probably failed).");
+      }
+
+      PrimaryKey new_record_key;
+      pk->set(record, new_record_key);
+      return results->affected_rows();
+    }
+  }
+}
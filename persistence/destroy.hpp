@@ -5,10 +5,32 @@
 #include <persistence/record_ptr.hpp>
 #include <persistence/context.hpp>
 
+#include <wayward/support/any.hpp>
+#include <wayward/support/result.hpp>
+
 namespace persistence {
+  using wayward::AnyRef;
+  using wayward::Result;
+
+  struct IRecordType;
+
+  namespace detail {
+    // Deletes the row of `record` by primary key, and marks the record as new again.
+    // Returns the number of rows deleted.
+    Result<size_t>
+    destroy(AnyRef record, const IRecordType* record_type);
+  }
+
   template <typename T>
   bool destroy(Context& ctx, RecordPtr<T>& ptr) {
-    return false; // TODO
+    ctx.forget_identity(ptr);
+    auto result = detail::destroy(*ptr, get_type<T>());
+    if (!result || result.get() == 0) {
+      ctx.remember_identity(ptr); // No-op unless the record still has its primary key.
+      return false;
+    }
+    ctx.forget_snapshot(ptr.get());
+    return true;
   }
 }
 
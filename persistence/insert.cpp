@@ -1,12 +1,17 @@
 #include "persistence/insert.hpp"
 #include "persistence/ast.hpp"
 #include "persistence/connection_pool.hpp"
+#include "persistence/data_store.hpp"
 #include "persistence/record_type.hpp"
 #include "persistence/record.hpp"
 #include "persistence/primary_key.hpp"
 #include "persistence/data_as_literal.hpp"
+#include "persistence/data_as_text.hpp"
 
 #include <wayward/support/format.hpp>
+#include <wayward/support/datetime.hpp>
+
+#include <algorithm>
 
 namespace persistence {
   namespace detail {
@@ -15,70 +20,173 @@ namespace persistence {
     using wayward::make_error;
     using wayward::NothingType;
 
-    Result<InsertQueryWithConnection>
-    make_insert_query(AnyRef record, const IRecordType* record_type, bool set_created_at) {
-      //static_assert(!boost::is_copy_constructible<std::tuple<ast::InsertQuery, AcquiredConnection>>::value, "TUPLE IS is_copy_constructible!!!");
+    namespace {
+      Result<void>
+      prepare_record_for_insert(AnyRef record, const IRecordType* record_type, bool set_created_at) {
+        // Get the primary key.
+        auto pk = record_type->abstract_primary_key();
 
-      // Get the primary key.
-      auto pk = record_type->abstract_primary_key();
+        if (pk) {
+          Result<Any> existing_pk = pk->get(record);
+          if (existing_pk.good()) {
+            PrimaryKey& primary_key_value = *existing_pk.get().get<PrimaryKey&>();
+            if (primary_key_value.is_persisted()) {
+              return make_error<PersistError>(wayward::format("Trying to insert record that already has a primary key (real type: {0}).", existing_pk.get().type_info().name()));
+            }
+          }
+        }
 
-      if (pk) {
-        Result<Any> existing_pk = pk->get(record);
-        if (existing_pk.good()) {
-          PrimaryKey& primary_key_value = *existing_pk.get().get<PrimaryKey&>();
-          if (primary_key_value.is_persisted()) {
-            return make_error<PersistError>(wayward::format("Trying to insert record that already has a primary key (real type: {0}).", existing_pk.get().type_info().name()));
+        // Set created_at if it exists.
+        if (set_created_at) {
+          auto created_at_property = record_type->find_abstract_property_by_column_name("created_at");
+          if (created_at_property != nullptr) {
+            auto now = wayward::DateTime::now();
+            created_at_property->set(record, now);
           }
         }
+        return Nothing;
       }
 
-      // Set created_at if it exists.
-      if (set_created_at) {
-        auto created_at_property = record_type->find_abstract_property_by_column_name("created_at");
-        if (created_at_property != nullptr) {
-          auto now = wayward::DateTime::now();
-          created_at_property->set(record, now);
+      // Runs `body` as a single unit: in a transaction of its own, or inside a
+      // savepoint when the caller already has a transaction open.
+      template <typename Body>
+      Result<void>
+      atomically(IConnection& conn, Body body) {
+        bool nested = conn.in_transaction();
+        try {
+          conn.execute(nested ? "SAVEPOINT persistence_insert_all" : "BEGIN");
+        }
+        catch (const wayward::Error& error) {
+          return make_error<PersistError>(wayward::format("Could not start a transaction:\n{0}", error.what()));
+        }
+
+        auto rollback = [&]() {
+          try {
+            conn.execute(nested ? "ROLLBACK TO SAVEPOINT persistence_insert_all" : "ROLLBACK");
+          }
+          catch (const wayward::Error& error) {
+            WAYWARD_LOG(conn.logger(), wayward::Severity::Error, "p", wayward::format("Error rolling back:\n{0}", error.what()));
+          }
+        };
+
+        Result<void> result = Nothing;
+        try {
+          result = body();
         }
+        catch (...) {
+          rollback();
+          throw;
+        }
+        if (!result) {
+          rollback();
+          return result;
+        }
+
+        try {
+          conn.execute(nested ? "RELEASE SAVEPOINT persistence_insert_all" : "COMMIT");
+        }
+        catch (const wayward::Error& error) {
+          rollback();
+          return make_error<PersistError>(wayward::format("Could not commit:\n{0}", error.what()));
+        }
+        return result;
       }
 
-      // Build the INSERT query.
-      ast::InsertQuery query;
-      query.relation = record_type->relation();
-      size_t num = record_type->num_properties();
-      query.columns.reserve(num);
-      query.values.reserve(num);
-      if (pk) {
-        query.returning_columns.push_back(pk->column());
+      ast::InsertQuery
+      make_insert_query_skeleton(const IRecordType* record_type, size_t num_records) {
+        auto pk = record_type->abstract_primary_key();
+        ast::InsertQuery query;
+        query.relation = record_type->relation();
+        size_t num = record_type->num_properties();
+        query.columns.reserve(num);
+        query.values.reserve(num * num_records);
+        if (pk) {
+          query.returning_columns.push_back(pk->column());
+        }
+        for (size_t i = 0; i < num; ++i) {
+          auto p = record_type->abstract_property_at(i);
+          if (p == pk) continue;
+          query.columns.push_back(p->column());
+        }
+        return std::move(query);
       }
 
-      auto conn = current_connection_provider().acquire_connection_for_data_store(record_type->data_store());
+      Result<void>
+      append_insert_values(AnyRef record, const IRecordType* record_type, ast::InsertQuery& query) {
+        auto pk = record_type->abstract_primary_key();
+        for (size_t i = 0; i < record_type->num_properties(); ++i) {
+          auto p = record_type->abstract_property_at(i);
+          if (p == pk) continue;
+          auto value = p->get(record);
+          if (value) {
+            DataAsLiteral data_as_literal;
+            query.values.push_back(data_as_literal.make_literal(value.get(), &p->type()));
+          } else {
+            return std::move(std::move(value).error());
+          }
+        }
+        return Nothing;
+      }
 
-      for (size_t i = 0; i < record_type->num_properties(); ++i) {
-        auto p = record_type->abstract_property_at(i);
-        if (p == pk) continue;
-        query.columns.push_back(p->column());
-        auto value = p->get(record);
-        if (value) {
-          DataAsLiteral data_as_literal;
-          query.values.push_back(data_as_literal.make_literal(value.get(), &p->type()));
-        } else {
-          return std::move(std::move(value).error());
+      Result<void>
+      parse_primary_key(const Maybe<std::string>& id_as_string, PrimaryKey& out_key) {
+        if (!id_as_string) {
+          return make_error<PersistError>("Backend did not return an ID for the primary key (meaning INSERT probably failed).");
         }
+        std::stringstream ss { *id_as_string };
+        ss >> out_key.id;
+        return Nothing;
+      }
+    }
+
+    Result<InsertQueryWithConnection>
+    make_insert_query(AnyRef record, const IRecordType* record_type, bool set_created_at) {
+      //static_assert(!boost::is_copy_constructible<std::tuple<ast::InsertQuery, AcquiredConnection>>::value, "TUPLE IS is_copy_constructible!!!");
+      auto prepared = prepare_record_for_insert(record, record_type, set_created_at);
+      if (!prepared) {
+        return std::move(prepared).error();
+      }
+
+      // Build the INSERT query.
+      ast::InsertQuery query = make_insert_query_skeleton(record_type, 1);
+
+      auto conn = current_connection_provider().acquire_connection_for_data_store(record_type->data_store());
+
+      auto appended = append_insert_values(record, record_type, query);
+      if (!appended) {
+        return std::move(appended).error();
       }
 
       return InsertQueryWithConnection{std::move(query), std::move(conn)};
     }
 
+    Result<ast::InsertQuery>
+    make_bulk_insert_query(const std::vector<AnyRef>& records, const IRecordType* record_type, bool set_created_at) {
+      ast::InsertQuery query = make_insert_query_skeleton(record_type, records.size());
+      for (auto& record: records) {
+        auto prepared = prepare_record_for_insert(record, record_type, set_created_at);
+        if (!prepared) {
+          return std::move(prepared).error();
+        }
+        auto appended = append_insert_values(record, record_type, query);
+        if (!appended) {
+          return std::move(appended).error();
+        }
+      }
+      return std::move(query);
+    }
+
     Result<std::unique_ptr<IResultSet>>
     execute_insert(const ast::InsertQuery& query, IConnection& conn, const IRecordType* record_type) {
-      conn.logger()->log(wayward::Severity::Debug, "p", wayward::format("Insert {0}", record_type->name()));
+      WAYWARD_LOG(conn.logger(), wayward::Severity::Debug, "p", wayward::format("Insert {0}", record_type->name()));
       std::unique_ptr<IResultSet> results;
       try {
         results = conn.execute(query);
       }
       catch (const wayward::Error& error) {
-        conn.logger()->log(wayward::Severity::Error, "p", wayward::format("Error executing SQL:\n{0}", error.what()));
+        WAYWARD_LOG(conn.logger(), wayward::Severity::Error, "p", wayward::format("Error executing SQL:\n{0}", error.what()));
       }
+      invalidate_cached_queries(record_type->data_store(), record_type->relation());
 
       if (!results) {
         return make_error<PersistError>("Backend did not return any results (meaning INSERT probably failed).");
@@ -91,15 +199,118 @@ namespace persistence {
       // Set the primary key of the record.
       auto pk = record_type->abstract_primary_key();
       if (pk) {
-        auto id_as_string = results.get(0, pk->column());
-        if (id_as_string) {
-          PrimaryKey pk_value;
-          std::stringstream ss { *id_as_string };
-          ss >> pk_value.id;
-          pk->set(record, pk_value);
-          return Nothing;
-        } else {
-          return make_error<PersistError>("Backend did not return an ID for the primary key (meaning INSERT probably failed).");
+        PrimaryKey pk_value;
+        auto parsed = parse_primary_key(results.get(0, pk->column()), pk_value);
+        if (!parsed) {
+          return std::move(parsed);
+        }
+        pk->set(record, pk_value);
+      }
+      return Nothing;
+    }
+
+    Result<void>
+    set_primary_keys_from_results(const std::vector<AnyRef>& records, const IRecordType* record_type, const IResultSet& results) {
+      auto pk = record_type->abstract_primary_key();
+      if (pk == nullptr) {
+        return Nothing;
+      }
+      if (results.height() != records.size()) {
+        return make_error<PersistError>(wayward::format("Backend returned {0} IDs for {1} inserted records.", results.height(), records.size()));
+      }
+      // PostgreSQL returns the rows of INSERT ... RETURNING in the order of the VALUES list.
+      for (size_t i = 0; i < records.size(); ++i) {
+        PrimaryKey pk_value;
+        auto parsed = parse_primary_key(results.get(i, pk->column()), pk_value);
+        if (!parsed) {
+          return std::move(parsed);
+        }
+        pk->set(records[i], pk_value);
+      }
+      return Nothing;
+    }
+
+    Result<void>
+    copy_records(const std::vector<AnyRef>& records, IConnection& conn, const IRecordType* record_type, bool set_created_at) {
+      auto pk = record_type->abstract_primary_key();
+      std::vector<std::string> columns;
+      std::vector<PrimaryKey> keys;
+
+      // Validate everything before reserving keys, so a bad record doesn't burn sequence values.
+      for (auto& record: records) {
+        auto prepared = prepare_record_for_insert(record, record_type, set_created_at);
+        if (!prepared) {
+          return std::move(prepared);
+        }
+      }
+
+      // COPY can't return generated keys, so reserve them from the sequence up front.
+      if (pk) {
+        columns.push_back(pk->column());
+        auto sql = wayward::format("SELECT nextval(pg_get_serial_sequence('{0}', '{1}')) AS \"{1}\" FROM generate_series(1, {2})",
+          conn.sanitize(record_type->relation()), conn.sanitize(pk->column()), records.size());
+        std::unique_ptr<IResultSet> results;
+        try {
+          results = conn.execute(std::move(sql));
+        }
+        catch (const wayward::Error& error) {
+          return make_error<PersistError>(wayward::format("Could not reserve primary keys for COPY:\n{0}", error.what()));
+        }
+        if (!results || results->height() != records.size()) {
+          return make_error<PersistError>("Backend did not reserve a primary key for every record.");
+        }
+        keys.resize(records.size());
+        for (size_t i = 0; i < records.size(); ++i) {
+          auto parsed = parse_primary_key(results->get(i, pk->column()), keys[i]);
+          if (!parsed) {
+            return std::move(parsed);
+          }
+        }
+      }
+
+      for (size_t i = 0; i < record_type->num_properties(); ++i) {
+        auto p = record_type->abstract_property_at(i);
+        if (p == pk) continue;
+        columns.push_back(p->column());
+      }
+
+      std::string data;
+      DataAsText text { data };
+      for (size_t r = 0; r < records.size(); ++r) {
+        auto record = records[r];
+        bool first_column = true;
+        if (pk) {
+          text.append(keys[r]);
+          first_column = false;
+        }
+        for (size_t i = 0; i < record_type->num_properties(); ++i) {
+          auto p = record_type->abstract_property_at(i);
+          if (p == pk) continue;
+          auto value = p->get(record);
+          if (!value) {
+            return std::move(value).error();
+          }
+          if (!first_column) {
+            data += '\t';
+          }
+          first_column = false;
+          text.append(value.get(), &p->type());
+        }
+        data += '\n';
+      }
+
+      WAYWARD_LOG(conn.logger(), wayward::Severity::Debug, "p", wayward::format("Copy {0} x {1}", record_type->name(), records.size()));
+      try {
+        conn.copy_in(record_type->relation(), columns, data);
+      }
+      catch (const wayward::Error& error) {
+        return make_error<PersistError>(wayward::format("Error executing COPY:\n{0}", error.what()));
+      }
+      invalidate_cached_queries(record_type->data_store(), record_type->relation());
+
+      if (pk) {
+        for (size_t i = 0; i < records.size(); ++i) {
+          pk->set(records[i], keys[i]);
         }
       }
       return Nothing;
@@ -123,5 +334,56 @@ namespace persistence {
         }
       );
     }
+
+    Result<void>
+    insert_all(const std::vector<AnyRef>& records, const IRecordType* record_type, const BulkInsertOptions& options) {
+      if (records.empty()) {
+        return Nothing;
+      }
+
+      auto conn = current_connection_provider().acquire_connection_for_data_store(record_type->data_store());
+
+      // Records [0, keyed) have been given primary keys by this call.
+      size_t keyed = 0;
+      auto inserted = atomically(conn, [&]() -> Result<void> {
+        if (records.size() >= options.copy_threshold) {
+          auto copied = copy_records(records, conn, record_type, options.set_created_at);
+          if (copied) {
+            keyed = records.size();
+          }
+          return copied;
+        }
+
+        size_t batch_size = options.batch_size ? options.batch_size : records.size();
+        for (size_t offset = 0; offset < records.size(); offset += batch_size) {
+          size_t end = std::min(offset + batch_size, records.size());
+          std::vector<AnyRef> batch { records.begin() + offset, records.begin() + end };
+
+          auto query = make_bulk_insert_query(batch, record_type, options.set_created_at);
+          if (!query) {
+            return std::move(query).error();
+          }
+          auto results = execute_insert(query.get(), conn, record_type);
+          if (!results) {
+            return std::move(results).error();
+          }
+          auto assigned = set_primary_keys_from_results(batch, record_type, *results.get());
+          if (!assigned) {
+            return std::move(assigned);
+          }
+          keyed = end;
+        }
+        return Nothing;
+      });
+
+      // Nothing was inserted, so take back the keys of the batches that had been.
+      auto pk = record_type->abstract_primary_key();
+      if (!inserted && pk) {
+        for (size_t i = 0; i < keyed; ++i) {
+          pk->set(records[i], PrimaryKey{});
+        }
+      }
+      return inserted;
+    }
   }
 }
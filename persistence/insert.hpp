@@ -5,9 +5,13 @@
 #include <wayward/support/any.hpp>
 #include <wayward/support/result.hpp>
 #include <persistence/record_ptr.hpp>
+#include <persistence/context.hpp>
 #include <wayward/support/type.hpp>
 #include <persistence/connection_pool.hpp>
 
+#include <vector>
+#include <iterator>
+
 namespace persistence {
   using wayward::AnyRef;
   using wayward::Result;
@@ -20,6 +24,12 @@ namespace persistence {
     struct InsertQuery;
   }
 
+  struct BulkInsertOptions {
+    size_t batch_size = 500;      // Maximum number of rows per multi-row INSERT statement.
+    size_t copy_threshold = 5000; // Use COPY FROM STDIN when inserting at least this many records.
+    bool set_created_at = true;
+  };
+
   namespace detail {
     struct InsertQueryWithConnection {
       ast::InsertQuery query;
@@ -37,12 +47,59 @@ namespace persistence {
 
     Result<void>
     insert(AnyRef record, const IRecordType* record_type, bool set_created_at);
+
+    Result<ast::InsertQuery>
+    make_bulk_insert_query(const std::vector<AnyRef>& records, const IRecordType* record_type, bool set_created_at);
+
+    Result<void>
+    set_primary_keys_from_results(const std::vector<AnyRef>& records, const IRecordType* record_type, const IResultSet& results);
+
+    Result<void>
+    copy_records(const std::vector<AnyRef>& records, IConnection& connection, const IRecordType* record_type, bool set_created_at);
+
+    Result<void>
+    insert_all(const std::vector<AnyRef>& records, const IRecordType* record_type, const BulkInsertOptions& options);
   }
 
 
   template <class T>
   Result<void> insert(RecordPtr<T> record, bool set_created_at = true) {
-    return detail::insert(*record, wayward::get_type<T>(), set_created_at);
+    auto result = detail::insert(*record, wayward::get_type<T>(), set_created_at);
+    if (result && record.context()) {
+      record.context()->remember_snapshot(*record);
+      record.context()->remember_identity(record);
+    }
+    return std::move(result);
+  }
+
+  /*
+    Insert a range of RecordPtr<T> using as few round-trips as possible.
+    Moderate batches become multi-row INSERT ... RETURNING statements, and large
+    ones are streamed with COPY FROM STDIN. Primary keys are assigned back to the records.
+  */
+  template <class Iterator>
+  Result<void> insert_all(Iterator begin, Iterator end, const BulkInsertOptions& options = BulkInsertOptions{}) {
+    using T = typename std::remove_reference<decltype(**begin)>::type;
+    std::vector<AnyRef> records;
+    records.reserve(std::distance(begin, end));
+    for (auto it = begin; it != end; ++it) {
+      records.push_back(AnyRef{**it});
+    }
+    auto result = detail::insert_all(records, wayward::get_type<T>(), options);
+    if (result) {
+      for (auto it = begin; it != end; ++it) {
+        if (it->context()) {
+          it->context()->remember_snapshot(**it);
+          it->context()->remember_identity(*it);
+        }
+      }
+    }
+    return std::move(result);
+  }
+
+  template <class T>
+  Result<void> insert_all(const std::vector<RecordPtr<T>>& records, const BulkInsertOptions& options = BulkInsertOptions{}) {
+    return insert_all(records.begin(), records.end(), options);
   }
 }
 
@@ -8,6 +8,7 @@
 #include <persistence/datetime.hpp>
 #include <persistence/relational_algebra.hpp>
 #include <persistence/projection.hpp>
+#include <persistence/query_batch.hpp>
 #include <persistence/belongs_to.hpp>
 #include <persistence/has_many.hpp>
 #include <persistence/has_one.hpp>
@@ -17,8 +18,10 @@
 #include <persistence/record_type_builder.hpp>
 #include <persistence/persistence_macro.hpp>
 #include <persistence/record_as_structured_data.hpp>
+#include <persistence/record_as_json.hpp>
 #include <persistence/projection_as_structured_data.hpp>
 #include <persistence/create.hpp>
+#include <persistence/destroy.hpp>
 #include <persistence/assign_attributes.hpp>
 #include <persistence/validation_errors.hpp>
 
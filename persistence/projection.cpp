@@ -1,9 +1,19 @@
 #include "persistence/projection.hpp"
 #include "persistence/data_store.hpp"
 #include "persistence/connection_pool.hpp"
+#include "persistence/record.hpp"
+#include "persistence/data_as_text.hpp"
 
 #include <wayward/support/format.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <unordered_map>
+
 
 namespace persistence {
   namespace detail {
@@ -23,6 +33,15 @@ namespace persistence {
       // in queries for every referenced column -- it is the rare case that it's ambiguous after all.
       std::map<const IRecordType*, std::string> first_relations_;
 
+      // Stateless, so copies of the projection can share them.
+      std::vector<std::shared_ptr<const IPreloader>> preloaders;
+
+      // Identifies the primary relation and the association joins, which together determine
+      // the select list and the JOIN clauses. Projections with equal shapes share a RenderedHead.
+      std::string shape;
+      size_t association_joins = 0;
+      std::shared_ptr<ast::RenderedHead> head;
+
       std::string relation_for_symbol(ast::SymbolicRelation relation) const final {
         auto t = reinterpret_cast<const IRecordType*>(relation);
         auto it = first_relations_.find(t);
@@ -34,7 +53,28 @@ namespace persistence {
       }
     };
 
+    namespace {
+      void append_shape_pointer(std::string& shape, const void* ptr) {
+        shape += std::to_string(reinterpret_cast<uintptr_t>(ptr));
+      }
+
+      std::shared_ptr<ast::RenderedHead> rendered_head_for_shape(const std::string& shape) {
+        // Shapes come from code, not data, so this is bounded by the number of distinct projections in the program.
+        static std::mutex mutex;
+        static std::unordered_map<std::string, std::shared_ptr<ast::RenderedHead>> heads;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& head = heads[shape];
+        if (head == nullptr) {
+          head = std::make_shared<ast::RenderedHead>();
+        }
+        return head;
+      }
+    }
+
     ProjectionBase::ProjectionBase(Context& ctx, CloningPtr<RelationProjector> base) : context_(ctx), private_(new Private) {
+      append_shape_pointer(private_->shape, base->record_type());
+      private_->shape += ':';
+      private_->shape += base->relation_alias();
       private_->join_map[base->relation_alias()] = base.get();
       auto real_table_name = base->record_type()->relation();
       projection_.query->relation = real_table_name;
@@ -106,7 +146,7 @@ namespace persistence {
 
     std::string ProjectionBase::to_sql() {
       update_select_expressions();
-      auto conn = current_connection_provider().acquire_connection_for_data_store(primary_type()->data_store());
+      auto conn = current_connection_provider().acquire_read_connection_for_data_store(primary_type()->data_store());
       return conn.to_sql(*projection_.query, *private_);
     }
 
@@ -114,19 +154,78 @@ namespace persistence {
       if (results_)
         return results_->height();
 
-      auto p_copy = projection_.select({
+      auto p_copy = count_projection();
+      auto conn = current_connection_provider().acquire_read_connection_for_data_store(primary_type()->data_store());
+      auto results = execute_select(conn, *p_copy.query);
+      return read_count(*results);
+    }
+
+    relational_algebra::Projection ProjectionBase::count_projection() const {
+      return projection_.select({
         {relational_algebra::aggregate("COUNT", relational_algebra::column(private_->base_projector->relation_alias(), private_->base_projector->record_type()->abstract_primary_key()->column())),
         "count"}
       });
-      auto conn = current_connection_provider().acquire_connection_for_data_store(primary_type()->data_store());
-      auto results = conn.execute(*p_copy.query, *private_);
+    }
+
+    size_t ProjectionBase::read_count(const IResultSet& results) {
       uint64_t count = 0;
-      Maybe<std::string> count_column = results->get(0, "count");
+      Maybe<std::string> count_column = results.get(0, "count");
       std::stringstream ss(*count_column);
       ss >> count;
       return count;
     }
 
+    std::string ProjectionBase::select_sql(IConnection& conn) {
+      update_select_expressions();
+      return conn.to_sql(*projection_.query, *private_);
+    }
+
+    std::string ProjectionBase::count_sql(IConnection& conn) {
+      return conn.to_sql(*count_projection().query, *private_);
+    }
+
+    Maybe<std::vector<std::string>> ProjectionBase::relations() const {
+      return relations_in(*projection_.query);
+    }
+
+    void ProjectionBase::use_results(std::unique_ptr<IResultSet> results) {
+      results_ = std::move(results);
+    }
+
+    size_t ProjectionBase::destroy_all() {
+      auto type = primary_type();
+      auto& select = *projection_.query;
+
+      ast::DeleteQuery query;
+      query.relation = type->relation();
+      if (select.joins.empty() && !select.limit && !select.offset && !select.relation_alias) {
+        query.where = select.where;
+      } else {
+        // DELETE can't express joins, aliases or LIMIT, so delete by primary key from the projected rows.
+        auto pk = type->abstract_primary_key();
+        if (pk == nullptr) {
+          throw PrimaryKeyError{"This record class does not seem to have a primary key column defined."};
+        }
+        auto subquery = projection_.select({
+          {relational_algebra::column(private_->base_projector->relation_alias(), pk->column())}
+        });
+        query.where = make_cloning_ptr(new ast::BinaryCondition{
+          make_cloning_ptr(new ast::ColumnReference{type->relation(), pk->column()}),
+          make_cloning_ptr(new ast::SelectQuery{*subquery.query}),
+          ast::BinaryCondition::In
+        });
+      }
+
+      auto conn = current_connection_provider().acquire_connection_for_data_store(type->data_store());
+      WAYWARD_LOG(conn.logger(), wayward::Severity::Debug, "p", wayward::format("Delete {0}", type->name()));
+      auto results = conn.execute(query, *private_);
+      invalidate_cached_queries(type->data_store(), type->relation());
+      // We don't know which of the loaded records were deleted, so forget all of them.
+      context_.forget_all_of_type(type);
+      results_ = nullptr;
+      return results ? results->affected_rows() : 0;
+    }
+
     void ProjectionBase::rebuild_join_map() {
       private_->join_map.clear();
       private_->base_projector->rebuild_join_map_recursively(private_->join_map);
@@ -135,16 +234,88 @@ namespace persistence {
     void ProjectionBase::execute_query() {
       if (results_ == nullptr) {
         update_select_expressions();
-        auto conn = current_connection_provider().acquire_connection_for_data_store(primary_type()->data_store());
+        auto conn = current_connection_provider().acquire_read_connection_for_data_store(primary_type()->data_store());
         //conn.logger()->log(wayward::Severity::Debug, "p", wayward::format("Load {0}", get_type<Primary>()->name()));
-        results_ = conn.execute(*projection_.query, *private_);
+        results_ = execute_select(conn, *projection_.query);
+      }
+      if (results_) {
+        private_->base_projector->plan_decoding(*results_);
+      }
+    }
+
+    std::unique_ptr<IResultSet> ProjectionBase::execute_select(IConnection& conn, const ast::SelectQuery& query) {
+      auto cache = query_cache_for(primary_type()->data_store());
+      if (cache == nullptr) {
+        return conn.execute(query, *private_);
+      }
+      auto relations = relations_in(query);
+      if (!relations) {
+        return conn.execute(query, *private_);
+      }
+      auto sql = conn.to_sql(query, *private_);
+      auto cached = cache->get(sql);
+      if (cached == nullptr) {
+        auto generation = cache->generation();
+        auto results = conn.execute(sql);
+        if (results == nullptr) {
+          return nullptr;
+        }
+        cached = cache->put(sql, std::move(*relations), *results, generation);
+      }
+      return share_result_set(std::move(cached));
+    }
+
+    void ProjectionBase::add_preloader(std::shared_ptr<const IPreloader> preloader) {
+      private_->preloaders.push_back(std::move(preloader));
+    }
+
+    bool ProjectionBase::has_preloaders() const {
+      return !private_->preloaders.empty();
+    }
+
+    void ProjectionBase::run_preloaders(const std::vector<AnyRef>& records) {
+      for (auto& preloader: private_->preloaders) {
+        preloader->preload(context_, records);
       }
     }
 
+    Maybe<int64> read_key(AnyConstRef record, const IProperty* property) {
+      auto value = property->get(record);
+      if (!value) {
+        return Nothing;
+      }
+      std::string text;
+      DataAsText data_as_text { text };
+      data_as_text.append(value.get(), &property->type());
+      char* end = nullptr;
+      int64 key = std::strtoll(text.c_str(), &end, 10);
+      if (text.empty() || *end != '\0') {
+        return Nothing;
+      }
+      return key;
+    }
+
     void ProjectionBase::update_select_expressions() {
+      auto& query = *projection_.query;
+      // Hand-written joins can have any condition, so only projections joined purely by association are shared.
+      bool shareable = query.joins.size() == private_->association_joins;
+      if (shareable) {
+        if (private_->head == nullptr) {
+          private_->head = rendered_head_for_shape(private_->shape);
+        }
+        if (private_->head->get()) {
+          // The renderer won't look at the select list, so don't bother rebuilding it.
+          query.head = private_->head;
+          return;
+        }
+      }
+
       std::vector<relational_algebra::SelectAlias> selects;
       private_->base_projector->append_selects(selects);
       projection_ = std::move(projection_).select(std::move(selects));
+      if (shareable) {
+        projection_.query->head = private_->head;
+      }
     }
 
 
@@ -161,6 +332,16 @@ namespace persistence {
       auto& to_alias = projector->relation_alias();
 
       // Add it to the list of joins:
+      private_->shape += '|';
+      private_->shape += from_alias;
+      private_->shape += '>';
+      append_shape_pointer(private_->shape, &assoc);
+      private_->shape += '>';
+      private_->shape += to_alias;
+      private_->shape += ':';
+      private_->shape += std::to_string(type);
+      ++private_->association_joins;
+      private_->head = nullptr;
       private_->join_map[to_alias] = projector.get();
       source_projector->add_join(assoc, std::move(projector));
 
@@ -198,13 +379,79 @@ namespace persistence {
       auto len = record_type_->num_properties();
       for (size_t i = 0; i < record_type_->num_properties(); ++i) {
         auto prop = record_type_->abstract_property_at(i);
-        auto alias = wayward::format("{0}_{1}", relation_alias_, prop->column());
+        auto alias = relation_alias_ + "_" + prop->column();
         column_aliases_[prop->column()] = std::move(alias);
       }
     }
 
+    namespace {
+      Maybe<int64> parse_primary_key(const char* value, size_t length) {
+        char* end = nullptr;
+        int64 id = std::strtoll(value, &end, 10);
+        if (length == 0 || end != value + length) {
+          return Nothing;
+        }
+        return id;
+      }
+    }
+
+    Maybe<int64> RelationProjector::primary_key_in_row(const IResultSet& results, size_t row) const {
+      if (planned_) {
+        if (!primary_key_column_) {
+          return Nothing;
+        }
+        size_t length = 0;
+        const char* value = results.get_raw(row, *primary_key_column_, length);
+        return value ? parse_primary_key(value, length) : Nothing;
+      }
+
+      auto pk = record_type_->abstract_primary_key();
+      if (pk == nullptr) {
+        return Nothing;
+      }
+      auto it = column_aliases_.find(pk->column());
+      if (it == column_aliases_.end()) {
+        return Nothing;
+      }
+      auto value = results.get(row, it->second);
+      if (!value) {
+        return Nothing;
+      }
+      return parse_primary_key(value->c_str(), value->size());
+    }
+
     void RelationProjector::add_join(const IAssociation& association, CloningPtr<RelationProjector> other) {
       sub_projectors_[&association] = std::move(other);
+      planned_ = false;
+    }
+
+    void RelationProjector::plan_decoding(const IResultSet& results) {
+      decode_steps_.clear();
+      undecoded_aliases_.clear();
+      primary_key_column_ = Nothing;
+      if (auto pk = record_type_->abstract_primary_key()) {
+        auto it = column_aliases_.find(pk->column());
+        if (it != column_aliases_.end()) {
+          primary_key_column_ = results.column_index(it->second);
+        }
+      }
+      for (size_t i = 0; i < record_type_->num_properties(); ++i) {
+        auto prop = record_type_->abstract_property_at(i);
+        auto it = column_aliases_.find(prop->column());
+        if (it == column_aliases_.end()) {
+          continue;
+        }
+        auto decode = prop->column_decoder();
+        if (decode == nullptr) {
+          undecoded_aliases_.insert(*it);
+          continue;
+        }
+        decode_steps_.push_back(ColumnDecodeStep{results.column_index(it->second), prop->member_offset(), decode});
+      }
+      for (auto& pair: sub_projectors_) {
+        pair.second->plan_decoding(results);
+      }
+      planned_ = true;
     }
 
     void RelationProjector::rebuild_join_map_recursively(std::map<std::string, RelationProjector*>& out_joins) {
@@ -332,26 +579,7 @@ namespace persistence {
           if (data.is_a<DateTime>()) {
             auto v = results.get(row, column_alias);
             if (v) {
-              auto& value = *data.get<DateTime&>();
-
-              std::string string_rep = std::move(*v);
-              // PostgreSQL timestamp with time zone looks like this: YYYY-mm-dd HH:MM:ss+ZZ
-              // Unfortunately, POSIX strptime can't deal with the two-digit timezone at the end, so we tinker with the string
-              // to get it into a parseable state.
-              std::string local_time_string = string_rep.substr(0, 19);
-              std::string timezone_string = string_rep.substr(string_rep.size() - 3);
-              local_time_string += timezone_string;
-              if (timezone_string.size() == 3) {
-                local_time_string += "00";
-              }
-
-              auto m = DateTime::strptime(local_time_string, "%Y-%m-%d %T%z");
-
-              if (m) {
-                value = std::move(*m);
-                return;
-              }
-              throw TypeError(wayward::format("Couldn't parse DateTime from string: '{0}'", string_rep));
+              *data.get<DateTime&>() = parse_timestamp_column(*v);
             }
           }
         }
@@ -406,9 +634,104 @@ namespace persistence {
     }
 
     void RelationProjector::populate_with_results(Context& ctx, AnyRef record_ref, const IResultSet& results, size_t row) {
-      RecordProjectionVisitor visitor { column_aliases_, results, row };
-      record_type_->visit_data(record_ref, visitor);
+      if (&record_ref.type_info() != &record_type_->type_info()) {
+        throw wayward::TypeError{wayward::format("Cannot populate a record of type {0} with rows of {1}.", record_ref.type_info().name(), record_type_->name())};
+      }
+      if (!planned_) {
+        plan_decoding(results);
+      }
+
+      char* record = static_cast<char*>(record_ref.memory());
+      for (auto& step: decode_steps_) {
+        size_t length = 0;
+        const char* value = step.column ? results.get_raw(row, *step.column, length) : nullptr;
+        step.decode(record + step.member_offset, value, length);
+      }
+      if (!undecoded_aliases_.empty()) {
+        RecordProjectionVisitor visitor { undecoded_aliases_, results, row };
+        record_type_->visit_data(record_ref, visitor);
+      }
+      populate_associations_with_results(ctx, record_ref, results, row);
+    }
+
+    namespace {
+      /*
+        Calls body(begin, end) for consecutive ranges of [0, n), on the workers and the calling thread,
+        and returns when all of them are done, rethrowing the first exception thrown by any of them.
+        The calling thread keeps taking ranges itself, so it never waits on tasks that haven't started,
+        even if the workers are busy or it is one of them.
+      */
+      void parallel_for(wayward::Teamwork& workers, size_t n, size_t chunk, const std::function<void(size_t, size_t)>& body) {
+        struct State {
+          const std::function<void(size_t, size_t)>* body; // Only dereferenced while the caller waits.
+          size_t n;
+          size_t chunk;
+          size_t num_chunks;
+          std::atomic<size_t> next_chunk {0};
+          std::mutex mutex;
+          std::condition_variable all_done;
+          size_t num_done = 0;
+          std::exception_ptr error;
+
+          void run() {
+            size_t c;
+            while ((c = next_chunk++) < num_chunks) {
+              try {
+                (*body)(c * chunk, std::min(n, (c + 1) * chunk));
+              }
+              catch (...) {
+                std::unique_lock<std::mutex> L(mutex);
+                if (!error) {
+                  error = std::current_exception();
+                }
+              }
+              std::unique_lock<std::mutex> L(mutex);
+              if (++num_done == num_chunks) {
+                all_done.notify_all();
+              }
+            }
+          }
+        };
+
+        chunk = std::max<size_t>(chunk, 1);
+        auto state = std::make_shared<State>();
+        state->body = &body;
+        state->n = n;
+        state->chunk = chunk;
+        state->num_chunks = (n + chunk - 1) / chunk;
+        if (state->num_chunks == 0) {
+          return;
+        }
+
+        size_t helpers = std::min(workers.number_of_workers(), state->num_chunks - 1);
+        for (size_t i = 0; i < helpers; ++i) {
+          workers.work([state]() { state->run(); });
+        }
+        state->run();
+
+        std::unique_lock<std::mutex> L(state->mutex);
+        state->all_done.wait(L, [&]() { return state->num_done == state->num_chunks; });
+        if (state->error) {
+          std::rethrow_exception(state->error);
+        }
+      }
+    }
+
+    void RelationProjector::populate_in_parallel(Context& ctx, wayward::Teamwork& workers, size_t rows_per_task, const IResultSet& results, const std::vector<AnyRef>& records, const std::vector<size_t>& rows, std::vector<RecordSnapshot>& out_snapshots) {
+      assert(!has_joins());
+      if (!planned_) {
+        plan_decoding(results);
+      }
+      out_snapshots.resize(records.size());
+      parallel_for(workers, records.size(), rows_per_task, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          populate_with_results(ctx, records[i], results, rows[i]);
+          out_snapshots[i] = take_snapshot(records[i], record_type_);
+        }
+      });
+    }
 
+    void RelationProjector::populate_associations_with_results(Context& ctx, AnyRef record_ref, const IResultSet& results, size_t row) {
       for (auto& pair: sub_projectors_) {
         auto& anchor = *pair.first->get_anchor(record_ref);
         pair.second->project_and_populate_association(ctx, anchor, results, row);
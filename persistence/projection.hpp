@@ -21,9 +21,11 @@
 #include <wayward/support/logger.hpp>
 #include <wayward/support/data_franca/adapters.hpp>
 #include <wayward/support/types.hpp>
+#include <wayward/support/teamwork.hpp>
 
 #include <functional>
 #include <cassert>
+#include <unordered_map>
 
 namespace persistence {
   namespace meta = ::wayward::meta;
@@ -40,8 +42,22 @@ namespace persistence {
   template <typename... Relations> struct Joins;
 
   template <typename T, typename Jx = Joins<>> struct Projection;
+  template <typename T> struct HasMany;
 
   namespace detail {
+    /*
+      Eager loading of one association for a whole result: after the primary query,
+      the owners' keys are collected and the associated records are loaded with a
+      single WHERE key IN (...) query, then handed to the anchors through populate().
+    */
+    struct IPreloader {
+      virtual ~IPreloader() {}
+      virtual void preload(Context& ctx, const std::vector<AnyRef>& owners) const = 0;
+    };
+
+    template <typename Owner, typename Association> struct BelongsToPreloader;
+    template <typename Owner, typename Association> struct HasManyPreloader;
+
     struct RelationProjector {
       using ColumnAliases = std::map<std::string, std::string>; // original->alias
 
@@ -55,7 +71,23 @@ namespace persistence {
       void rebuild_join_map_recursively(std::map<std::string, RelationProjector*>& out_joins);
       void append_selects(std::vector<relational_algebra::SelectAlias>& out_selects) const;
 
+      // Resolves the columns of this relation and its joins in the result set once, so that rows
+      // can be decoded without name lookups. Must be called for every new result set before its
+      // rows are populated (ProjectionBase::execute_query does); the plan is only made on demand
+      // if there has never been one.
+      void plan_decoding(const IResultSet&);
+
       void populate_with_results(Context&, AnyRef record_ref, const IResultSet&, size_t row);
+      void populate_associations_with_results(Context&, AnyRef record_ref, const IResultSet&, size_t row);
+
+      // The primary key of this relation's row, or Nothing if it's absent (e.g. an unmatched outer join).
+      Maybe<int64> primary_key_in_row(const IResultSet&, size_t row) const;
+
+      bool has_joins() const { return !sub_projectors_.empty(); }
+
+      // Populates records[i] from rows[i] and takes its snapshot, spreading the rows over the workers
+      // and the calling thread. Only joins touch the Context, so this is only for projectors without them.
+      void populate_in_parallel(Context&, wayward::Teamwork& workers, size_t rows_per_task, const IResultSet&, const std::vector<AnyRef>& records, const std::vector<size_t>& rows, std::vector<RecordSnapshot>& out_snapshots);
 
       virtual void project_and_populate_association(Context&, IAssociationAnchor&, const IResultSet& result_set, size_t row) = 0;
     private:
@@ -63,6 +95,16 @@ namespace persistence {
       std::string relation_alias_;
       std::map<const IAssociation*, CloningPtr<RelationProjector>> sub_projectors_;
       ColumnAliases column_aliases_;
+
+      struct ColumnDecodeStep {
+        Maybe<size_t> column; // Nothing if the column isn't in the result set, which decodes as NULL.
+        size_t member_offset;
+        ColumnDecoder decode;
+      };
+      bool planned_ = false;
+      Maybe<size_t> primary_key_column_;
+      std::vector<ColumnDecodeStep> decode_steps_;
+      ColumnAliases undecoded_aliases_; // Properties without a ColumnDecoder, which go through their IType.
     };
 
     void throw_association_type_mismatch_error(const IRecordType* expected, const IRecordType* got);
@@ -75,11 +117,67 @@ namespace persistence {
       RelationProjectorFor() : RelationProjectorFor(get_type<T>()->relation()) {}
 
       RecordPtr<T> project(Context& ctx, const IResultSet& result_set, size_t row) {
+        auto id = this->primary_key_in_row(result_set, row);
+        if (id) {
+          // Reuse the record if this row is already materialized, keeping any changes made to it.
+          auto existing = ctx.find_loaded<T>(*id);
+          if (existing) {
+            this->populate_associations_with_results(ctx, *existing, result_set, row);
+            return std::move(existing);
+          }
+        }
         auto record = ctx.create<T>();
         this->populate_with_results(ctx, *record, result_set, row);
+        ctx.remember_snapshot(*record);
+        if (id) {
+          ctx.remember_identity(record, *id);
+        }
         return std::move(record);
       }
 
+      // Like project() for every row, with the new records populated in parallel. Allocation and
+      // the identity map stay on the calling thread.
+      std::vector<RecordPtr<T>> project_all_in_parallel(Context& ctx, const IResultSet& result_set, wayward::Teamwork& workers, size_t rows_per_task) {
+        size_t num_rows = result_set.height();
+        std::vector<RecordPtr<T>> records;
+        records.reserve(num_rows);
+        std::vector<AnyRef> created;
+        std::vector<size_t> created_rows;
+        // Index into records by primary key, so later rows with the same key reuse the record.
+        // The context only learns about them once they are fully populated.
+        std::unordered_map<int64, size_t> created_ids;
+        for (size_t row = 0; row < num_rows; ++row) {
+          auto id = this->primary_key_in_row(result_set, row);
+          if (id) {
+            auto existing = ctx.find_loaded<T>(*id);
+            if (existing) {
+              records.push_back(std::move(existing));
+              continue;
+            }
+            auto it = created_ids.find(*id);
+            if (it != created_ids.end()) {
+              records.push_back(records[it->second]);
+              continue;
+            }
+            created_ids[*id] = records.size();
+          }
+          auto record = ctx.create<T>();
+          created.push_back(*record);
+          created_rows.push_back(row);
+          records.push_back(std::move(record));
+        }
+
+        std::vector<RecordSnapshot> snapshots;
+        this->populate_in_parallel(ctx, workers, rows_per_task, result_set, created, created_rows, snapshots);
+        for (size_t i = 0; i < created.size(); ++i) {
+          ctx.snapshot_for(created[i].memory()) = std::move(snapshots[i]);
+        }
+        for (auto& pair: created_ids) {
+          ctx.remember_identity(records[pair.second], pair.first);
+        }
+        return std::move(records);
+      }
+
       void project_and_populate_association(Context& ctx, IAssociationAnchor& association, const IResultSet& result_set, size_t row) {
         auto ptr = project(ctx, result_set, row);
         auto typed_association = dynamic_cast<ISingularAssociationAnchor<T>*>(&association);
@@ -97,6 +195,17 @@ namespace persistence {
 
       std::string to_sql();
       size_t count();
+
+      // Deletes every row matched by the projection in a single statement, without loading them.
+      // Returns the number of rows deleted.
+      size_t destroy_all();
+
+      // For QueryBatch: render the queries without running them, and take results obtained elsewhere.
+      std::string select_sql(IConnection& conn);
+      std::string count_sql(IConnection& conn);
+      Maybe<std::vector<std::string>> relations() const;
+      void use_results(std::unique_ptr<IResultSet> results);
+      static size_t read_count(const IResultSet& results);
     protected:
       ProjectionBase(const ProjectionBase&);
       ProjectionBase(ProjectionBase&&);
@@ -114,7 +223,12 @@ namespace persistence {
       CloningPtr<Private> private_;
 
       void update_select_expressions();
+      relational_algebra::Projection count_projection() const;
       void execute_query();
+      std::unique_ptr<IResultSet> execute_select(IConnection& conn, const ast::SelectQuery& query);
+      void add_preloader(std::shared_ptr<const IPreloader>);
+      bool has_preloaders() const;
+      void run_preloaders(const std::vector<AnyRef>& records);
       void rebuild_join_map();
       void build_join(std::string from_alias, const IRecordType* from_type, const IAssociation& assoc, CloningPtr<RelationProjector> projector, ast::Join::Type type);
       std::string alias_for(const IRecordType*) const;
@@ -183,6 +297,13 @@ namespace persistence {
       });
     }
     void each(std::function<void(RecordPtr<Primary>&)> callback) {
+      if (has_preloaders()) {
+        // Preloading needs every owner up front.
+        for (auto& ptr: all()) {
+          callback(ptr);
+        }
+        return;
+      }
       execute_query();
       size_t num_rows = results_->height();
       for (size_t i = 0; i < num_rows; ++i) {
@@ -200,6 +321,24 @@ namespace persistence {
       for (size_t i = 0; i < num_rows; ++i) {
         records.push_back(project(i));
       }
+      preload(records);
+      return std::move(records);
+    }
+
+    /*
+      Like all(), but the rows are decoded on the threads of `workers` as well as the calling one,
+      in tasks of at least rows_per_task rows. Worth it for large results; projections with
+      association joins are loaded serially.
+    */
+    std::vector<RecordPtr<Primary>>
+    all(wayward::Teamwork& workers, size_t rows_per_task = 1024) {
+      if (primary_projector()->has_joins()) {
+        return all();
+      }
+      execute_query();
+      auto p = static_cast<detail::RelationProjectorFor<Primary>*>(primary_projector());
+      auto records = p->project_all_in_parallel(context_, *results_, workers, rows_per_task);
+      preload(records);
       return std::move(records);
     }
 
@@ -243,6 +382,27 @@ namespace persistence {
       return copy().order(col);
     }
 
+    // Eager loading (see detail::IPreloader). includes() is a synonym for preload().
+    template <typename Association>
+    Self preload(BelongsTo<Association> Primary::*assoc) && {
+      add_preloader(std::make_shared<detail::BelongsToPreloader<Primary, Association>>(assoc));
+      return replace_p(std::move(projection_));
+    }
+    template <typename Association>
+    Self preload(HasMany<Association> Primary::*assoc) && {
+      add_preloader(std::make_shared<detail::HasManyPreloader<Primary, Association>>(assoc));
+      return replace_p(std::move(projection_));
+    }
+    template <typename Association>
+    Self preload(BelongsTo<Association> Primary::*assoc) const& { return copy().preload(assoc); }
+    template <typename Association>
+    Self preload(HasMany<Association> Primary::*assoc) const& { return copy().preload(assoc); }
+
+    template <typename Anchor>
+    Self includes(Anchor Primary::*assoc) && { return std::move(*this).preload(assoc); }
+    template <typename Anchor>
+    Self includes(Anchor Primary::*assoc) const& { return copy().preload(assoc); }
+
     // Association Joins:
     template <typename Owner, typename Association>
     SelfJoining<Association> inner_join(BelongsTo<Association> Owner::*assoc) && {
@@ -391,6 +551,17 @@ namespace persistence {
       return std::move(new_projection);
     }
 
+    void preload(const std::vector<RecordPtr<Primary>>& records) {
+      if (has_preloaders()) {
+        std::vector<AnyRef> owners;
+        owners.reserve(records.size());
+        for (auto& record: records) {
+          owners.push_back(*record);
+        }
+        run_preloaders(owners);
+      }
+    }
+
     RecordPtr<Primary> project(size_t row) {
       assert(results_ != nullptr);
       // It's safe to static cast because we know what ProjectionBase looks like internally.
@@ -413,8 +584,106 @@ namespace persistence {
 
   template <typename T>
   RecordPtr<T> find(Context& ctx, PrimaryKey key) {
+    auto loaded = ctx.find_loaded<T>(key.id);
+    if (loaded) {
+      return std::move(loaded);
+    }
     return from<T>(ctx).where(column(&T::id) == key).first();
   }
+
+  namespace detail {
+    // Reads an integer key column (int, PrimaryKey, BelongsTo<>) from a loaded record.
+    Maybe<int64> read_key(AnyConstRef record, const IProperty* property);
+
+    template <typename Owner, typename Association>
+    struct BelongsToPreloader : IPreloader {
+      using MemberPtr = BelongsTo<Association> Owner::*;
+      explicit BelongsToPreloader(MemberPtr member) : member_(member) {}
+
+      void preload(Context& ctx, const std::vector<AnyRef>& owners) const final {
+        std::map<int64, std::vector<BelongsTo<Association>*>> anchors;
+        std::vector<int64> ids;
+        for (AnyRef owner: owners) {
+          auto& anchor = (*owner.get<Owner&>()).*member_;
+          if (anchor.is_loaded()) continue;
+          auto id = anchor.id();
+          if (!id.is_persisted()) continue;
+          auto loaded = ctx.find_loaded<Association>(id.id);
+          if (loaded) {
+            anchor.populate(std::move(loaded));
+            continue;
+          }
+          auto& waiting = anchors[id.id];
+          if (waiting.empty()) ids.push_back(id.id);
+          waiting.push_back(&anchor);
+        }
+        if (ids.empty()) return;
+
+        auto pk = get_type<Association>()->abstract_primary_key();
+        if (pk == nullptr) {
+          throw AssociationError{"Cannot preload BelongsTo association to a record type without a primary key."};
+        }
+        auto records = from<Association>(ctx).where(column<Association, int64_t>(pk->column()).in(ids)).all();
+        for (auto& record: records) {
+          auto id = get_pk_for_record(record);
+          if (id == nullptr) continue;
+          auto it = anchors.find(id->id);
+          if (it == anchors.end()) continue;
+          for (auto anchor: it->second) {
+            anchor->populate(record);
+          }
+        }
+      }
+    private:
+      MemberPtr member_;
+    };
+
+    template <typename Owner, typename Association>
+    struct HasManyPreloader : IPreloader {
+      using MemberPtr = HasMany<Association> Owner::*;
+      explicit HasManyPreloader(MemberPtr member) : member_(member) {}
+
+      void preload(Context& ctx, const std::vector<AnyRef>& owners) const final {
+        std::map<int64, std::vector<HasMany<Association>*>> anchors;
+        std::vector<int64> ids;
+        const IAssociation* association = nullptr;
+        for (AnyRef owner: owners) {
+          auto& anchor = (*owner.get<Owner&>()).*member_;
+          if (anchor.is_loaded()) continue;
+          association = anchor.association();
+          auto id = anchor.id_of_owner();
+          if (!id.is_persisted()) continue;
+          auto& waiting = anchors[id.id];
+          if (waiting.empty()) ids.push_back(id.id);
+          waiting.push_back(&anchor);
+        }
+        if (ids.empty()) return;
+
+        auto fk = association->foreign_key();
+        auto fk_property = get_type<Association>()->find_abstract_property_by_column_name(fk);
+        if (fk_property == nullptr) {
+          throw AssociationError{wayward::format("Cannot preload HasMany association: {0} has no property for column '{1}'.", get_type<Association>()->name(), fk)};
+        }
+
+        std::map<int64, std::vector<RecordPtr<Association>>> grouped;
+        auto records = from<Association>(ctx).where(column<Association, int64_t>(fk).in(ids)).all();
+        for (auto& record: records) {
+          auto key = read_key(*record, fk_property);
+          if (key) {
+            grouped[*key].push_back(record);
+          }
+        }
+        for (auto& pair: anchors) {
+          auto& loaded = grouped[pair.first];
+          for (auto anchor: pair.second) {
+            anchor->populate(loaded);
+          }
+        }
+      }
+    private:
+      MemberPtr member_;
+    };
+  }
 }
 
 #endif // PERSISTENCE_PROJECTION_HPP_INCLUDED
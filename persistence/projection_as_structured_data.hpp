@@ -36,6 +36,15 @@ namespace wayward {
         return make_reader(*values_, this->options_)->enumerator();
       }
 
+      void visit_children(IReaderVisitor& visitor) const final {
+        load();
+        for (auto& record: *values_) {
+          visit_reader(record, this->options_, [&](const IReader& reader) {
+            visitor.visit(nullptr, reader);
+          });
+        }
+      }
+
     private:
       mutable Maybe<std::vector<persistence::RecordPtr<Primary>>> values_;
 
@@ -3,9 +3,12 @@
 #define PERSISTENCE_PROPERTY_HPP_INCLUDED
 
 #include <string>
+#include <type_traits>
 #include <wayward/support/type.hpp>
 #include <persistence/result_set.hpp>
 #include <persistence/ast.hpp>
+#include <persistence/column_decoder.hpp>
+#include <persistence/record_snapshot.hpp>
 
 #include <wayward/support/result.hpp>
 #include <wayward/support/any.hpp>
@@ -13,6 +16,7 @@
 #include <wayward/support/data_franca/adapter.hpp>
 #include <wayward/support/data_franca/spectator.hpp>
 #include <wayward/support/data_franca/mutator.hpp>
+#include <wayward/support/json.hpp>
 
 namespace persistence {
   using wayward::Result;
@@ -31,6 +35,15 @@ namespace persistence {
 
     virtual Result<Any> get(AnyConstRef record) const = 0;
     virtual Result<void> set(AnyRef record, AnyConstRef value) const = 0;
+
+    // For decoding result rows straight into records: where the member is, and how to parse it.
+    // The decoder is nullptr if the member has to be decoded through its IType.
+    virtual size_t member_offset() const = 0;
+    virtual ColumnDecoder column_decoder() const = 0;
+
+    // Dirty tracking: the value a RecordSnapshot keeps for the member, and whether the member still matches it.
+    virtual Any snapshot_value(AnyConstRef record) const = 0;
+    virtual bool matches_snapshot(AnyConstRef record, const Any& value) const = 0;
   };
 
   template <typename T>
@@ -54,11 +67,19 @@ namespace persistence {
     virtual wayward::data_franca::ReaderPtr
     get_member_reader(const T&, wayward::Bitflags<wayward::data_franca::Options> options) const = 0;
 
+    // Like get_member_reader(), but passes a stack-allocated reader to the visitor, keyed by the column name.
+    virtual void
+    visit_member_reader(const T&, wayward::Bitflags<wayward::data_franca::Options> options, wayward::data_franca::IReaderVisitor& visitor) const = 0;
+
     virtual wayward::data_franca::AdapterPtr
     get_member_adapter(T&, wayward::Bitflags<wayward::data_franca::Options> options) const = 0;
 
     virtual void
     visit(T&, wayward::DataVisitor& visitor) const = 0;
+
+    // Appends "column": value as compact JSON, reading the member directly.
+    virtual void
+    write_json_member(std::string& out, const T& record) const = 0;
   };
 
   struct ASTError : wayward::Error {
@@ -70,6 +91,14 @@ namespace persistence {
   };
 
   namespace detail {
+    // The byte offset of a data member, which identifies a member pointer without comparing types.
+    template <typename T, typename M>
+    size_t member_offset(M T::*member) {
+      typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+      const T* object = reinterpret_cast<const T*>(&storage);
+      return reinterpret_cast<const char*>(&(object->*member)) - reinterpret_cast<const char*>(object);
+    }
+
     wayward::ErrorPtr make_type_error_for_mismatching_record_type(const IType* expected_type, const TypeInfo& got_type);
     wayward::ErrorPtr make_type_error_for_mismatching_value_type(const IType* record_type, const IType* expected_type, const TypeInfo& got_type);
   }
@@ -78,7 +107,11 @@ namespace persistence {
   struct PropertyOfBase : IPropertyOf<T>, Property<M> {
     using MemberPtr = M T::*;
     MemberPtr ptr_;
-    PropertyOfBase(MemberPtr ptr, std::string column) : Property<M>{column}, ptr_(ptr) {}
+    std::string json_key_; // The column as an escaped JSON string, followed by ": ".
+    PropertyOfBase(MemberPtr ptr, std::string column) : Property<M>{column}, ptr_(ptr) {
+      wayward::detail::write_json_string(json_key_, this->column_);
+      json_key_ += ": ";
+    }
     const IType& type() const { return *wayward::get_type<M>(); }
     std::string column() const { return this->column_; }
 
@@ -107,6 +140,32 @@ namespace persistence {
       return Nothing;
     }
 
+    size_t member_offset() const final {
+      return detail::member_offset(ptr_);
+    }
+
+    ColumnDecoder column_decoder() const final {
+      return ColumnDecoderFor<M>::get();
+    }
+
+    Any snapshot_value(AnyConstRef record) const final {
+      auto& member = get_known(*record.get<const T&>());
+      if (ColumnEqualityFor<M>::Supported) {
+        return Any{member};
+      }
+      return Any{detail::snapshot_text(member, &type())};
+    }
+
+    bool matches_snapshot(AnyConstRef record, const Any& value) const final {
+      auto& member = get_known(*record.get<const T&>());
+      if (ColumnEqualityFor<M>::Supported) {
+        auto previous = value.get<const M&>();
+        return previous && ColumnEqualityFor<M>::equal(*previous, member);
+      }
+      auto previous = value.get<const std::string&>();
+      return previous && *previous == detail::snapshot_text(member, &type());
+    }
+
     const M& get_known(const T& record) const {
       return record.*ptr_;
     }
@@ -124,6 +183,19 @@ namespace persistence {
       return wayward::data_franca::make_reader(get_known(object), options);
     }
 
+    void
+    visit_member_reader(const T& object, wayward::Bitflags<wayward::data_franca::Options> options, wayward::data_franca::IReaderVisitor& visitor) const override {
+      wayward::data_franca::visit_reader(get_known(object), options, [&](const wayward::data_franca::IReader& reader) {
+        visitor.visit(&this->column_, reader);
+      });
+    }
+
+    void
+    write_json_member(std::string& out, const T& record) const override {
+      out += json_key_;
+      wayward::JSONSerializer<M>::write(out, get_known(record));
+    }
+
     wayward::data_franca::AdapterPtr
     get_member_adapter(T& object, wayward::Bitflags<wayward::data_franca::Options> options) const override {
       return wayward::data_franca::make_adapter(get_known(object), options);
@@ -0,0 +1,65 @@
+#include <persistence/query_batch.hpp>
+#include <persistence/query_cache.hpp>
+#include <persistence/data_store.hpp>
+#include <persistence/connection_pool.hpp>
+#include <wayward/support/format.hpp>
+
+#include <map>
+
+namespace persistence {
+  namespace detail {
+    void QueryBatchState::execute() {
+      auto batch = std::move(queued);
+      queued.clear();
+
+      // One round trip per data store, keeping the queries' order within each.
+      std::map<std::string, std::vector<IBatchedQuery*>> by_data_store;
+      for (auto& query: batch) {
+        by_data_store[query->projection().primary_type()->data_store()].push_back(query.get());
+      }
+
+      for (auto& pair: by_data_store) {
+        auto conn = current_connection_provider().acquire_read_connection_for_data_store(pair.first);
+        auto cache = query_cache_for(pair.first);
+
+        std::vector<std::string> sql;
+        std::vector<IBatchedQuery*> pending;
+        std::vector<Maybe<std::vector<std::string>>> relations; // Nothing for queries that can't be cached.
+        for (auto query: pair.second) {
+          auto s = query->to_sql(conn);
+          Maybe<std::vector<std::string>> reads;
+          if (cache) {
+            reads = query->projection().relations();
+          }
+          if (reads) {
+            auto cached = cache->get(s);
+            if (cached) {
+              query->deliver(share_result_set(std::move(cached)));
+              continue;
+            }
+          }
+          sql.push_back(std::move(s));
+          pending.push_back(query);
+          relations.push_back(std::move(reads));
+        }
+        if (sql.empty()) {
+          continue;
+        }
+
+        auto generation = cache ? cache->generation() : 0;
+        auto results = conn.execute_batch(sql);
+        if (results.size() != pending.size()) {
+          throw QueryBatchError{wayward::format("Expected {0} results from query batch, got {1}.", pending.size(), results.size())};
+        }
+        for (size_t i = 0; i < pending.size(); ++i) {
+          if (relations[i]) {
+            auto cached = cache->put(sql[i], std::move(*relations[i]), *results[i], generation);
+            pending[i]->deliver(share_result_set(std::move(cached)));
+          } else {
+            pending[i]->deliver(std::move(results[i]));
+          }
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,125 @@
+#pragma once
+#ifndef PERSISTENCE_QUERY_BATCH_HPP_INCLUDED
+#define PERSISTENCE_QUERY_BATCH_HPP_INCLUDED
+
+#include <persistence/projection.hpp>
+#include <wayward/support/error.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace persistence {
+  struct QueryBatchError : wayward::Error {
+    QueryBatchError(const std::string& message) : wayward::Error(message) {}
+  };
+
+  namespace detail {
+    struct IBatchedQuery {
+      virtual ~IBatchedQuery() {}
+      virtual ProjectionBase& projection() = 0;
+      virtual std::string to_sql(IConnection& conn) = 0;
+      virtual void deliver(std::unique_ptr<IResultSet> results) = 0;
+    };
+
+    struct QueryBatchState {
+      std::vector<std::shared_ptr<IBatchedQuery>> queued;
+      void execute();
+    };
+
+    template <typename T>
+    struct DeferredSlot {
+      explicit DeferredSlot(T value) : value(std::move(value)) {}
+      T value;
+      bool ready = false;
+    };
+
+    template <typename P>
+    struct BatchedLoad : IBatchedQuery {
+      explicit BatchedLoad(std::shared_ptr<DeferredSlot<P>> slot) : slot(std::move(slot)) {}
+      std::shared_ptr<DeferredSlot<P>> slot;
+
+      ProjectionBase& projection() final { return slot->value; }
+      std::string to_sql(IConnection& conn) final { return slot->value.select_sql(conn); }
+      void deliver(std::unique_ptr<IResultSet> results) final {
+        slot->value.use_results(std::move(results));
+        slot->ready = true;
+      }
+    };
+
+    template <typename P>
+    struct BatchedCount : IBatchedQuery {
+      BatchedCount(P projection, std::shared_ptr<DeferredSlot<size_t>> slot) : projection_(std::move(projection)), slot(std::move(slot)) {}
+      P projection_;
+      std::shared_ptr<DeferredSlot<size_t>> slot;
+
+      ProjectionBase& projection() final { return projection_; }
+      std::string to_sql(IConnection& conn) final { return projection_.count_sql(conn); }
+      void deliver(std::unique_ptr<IResultSet> results) final {
+        slot->value = ProjectionBase::read_count(*results);
+        slot->ready = true;
+      }
+    };
+  }
+
+  /*
+    The result of a query queued in a QueryBatch. Reading it runs the batch,
+    if that hasn't happened yet.
+  */
+  template <typename T>
+  struct Deferred {
+    T& get() {
+      if (!slot_->ready) {
+        batch_->execute();
+      }
+      if (!slot_->ready) {
+        throw QueryBatchError{"The query batch this value belongs to has failed."};
+      }
+      return slot_->value;
+    }
+    T& operator*() { return get(); }
+    T* operator->() { return &get(); }
+    bool ready() const { return slot_->ready; }
+  private:
+    friend struct QueryBatch;
+    Deferred(std::shared_ptr<detail::QueryBatchState> batch, std::shared_ptr<detail::DeferredSlot<T>> slot) : batch_(std::move(batch)), slot_(std::move(slot)) {}
+    std::shared_ptr<detail::QueryBatchState> batch_;
+    std::shared_ptr<detail::DeferredSlot<T>> slot_;
+  };
+
+  /*
+    Independent reads queued in a batch are sent together, so they cost one
+    round trip per data store instead of one each:
+
+      QueryBatch batch;
+      auto total = batch.count(from<Post>(ctx));
+      auto page = batch.load(from<Post>(ctx).order(...).limit(20));
+      for (auto& post: page->all()) { ... } // Runs both queries.
+      render(*total);
+  */
+  struct QueryBatch {
+    QueryBatch() : state_(std::make_shared<detail::QueryBatchState>()) {}
+
+    // all()/each() on the deferred projection use the batched results.
+    template <typename T, typename Jx>
+    Deferred<Projection<T, Jx>> load(Projection<T, Jx> projection) {
+      auto slot = std::make_shared<detail::DeferredSlot<Projection<T, Jx>>>(std::move(projection));
+      state_->queued.push_back(std::make_shared<detail::BatchedLoad<Projection<T, Jx>>>(slot));
+      return Deferred<Projection<T, Jx>>{state_, std::move(slot)};
+    }
+
+    template <typename T, typename Jx>
+    Deferred<size_t> count(Projection<T, Jx> projection) {
+      auto slot = std::make_shared<detail::DeferredSlot<size_t>>(0);
+      state_->queued.push_back(std::make_shared<detail::BatchedCount<Projection<T, Jx>>>(std::move(projection), slot));
+      return Deferred<size_t>{state_, std::move(slot)};
+    }
+
+    // Sends all queued queries. Happens implicitly when a Deferred is first read.
+    void execute() { state_->execute(); }
+    size_t size() const { return state_->queued.size(); }
+  private:
+    std::shared_ptr<detail::QueryBatchState> state_;
+  };
+}
+
+#endif // PERSISTENCE_QUERY_BATCH_HPP_INCLUDED
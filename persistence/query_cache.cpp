@@ -0,0 +1,283 @@
+#include "persistence/query_cache.hpp"
+
+#include <algorithm>
+
+namespace persistence {
+  using wayward::Nothing;
+
+  CachedResultSet::CachedResultSet(const IResultSet& results)
+  : columns_(results.columns())
+  , height_(results.height())
+  , affected_rows_(results.affected_rows())
+  {
+    values_.reserve(columns_.size() * height_);
+    memory_usage_ = sizeof(*this);
+    for (auto& column: columns_) {
+      memory_usage_ += column.capacity();
+    }
+    for (size_t row = 0; row < height_; ++row) {
+      for (auto& column: columns_) {
+        values_.push_back(results.get(row, column));
+        memory_usage_ += sizeof(Maybe<std::string>);
+        if (values_.back()) {
+          memory_usage_ += values_.back()->capacity();
+        }
+      }
+    }
+  }
+
+  const Maybe<std::string>* CachedResultSet::value_at(size_t idx, const std::string& col) const {
+    auto it = std::find(columns_.begin(), columns_.end(), col);
+    if (it == columns_.end() || idx >= height_) {
+      return nullptr;
+    }
+    return &values_[idx * columns_.size() + (it - columns_.begin())];
+  }
+
+  bool CachedResultSet::is_null_at(size_t idx, const std::string& col) const {
+    auto v = value_at(idx, col);
+    return v == nullptr || !*v;
+  }
+
+  Maybe<std::string> CachedResultSet::get(size_t idx, const std::string& col) const {
+    auto v = value_at(idx, col);
+    if (v == nullptr) {
+      return Nothing;
+    }
+    return *v;
+  }
+
+  Maybe<size_t> CachedResultSet::column_index(const std::string& col) const {
+    auto it = std::find(columns_.begin(), columns_.end(), col);
+    if (it == columns_.end()) {
+      return Nothing;
+    }
+    return size_t(it - columns_.begin());
+  }
+
+  const char* CachedResultSet::get_raw(size_t row, size_t col, size_t& length) const {
+    auto& v = values_[row * columns_.size() + col];
+    if (!v) {
+      return nullptr;
+    }
+    length = v->size();
+    return v->c_str();
+  }
+
+  QueryCache::QueryCache(const QueryCacheOptions& options) : options_(options) {}
+
+  std::shared_ptr<const CachedResultSet> QueryCache::get(const std::string& sql) {
+    std::unique_lock<std::mutex> L(mutex_);
+    auto it = by_sql_.find(sql);
+    if (it == by_sql_.end()) {
+      return nullptr;
+    }
+    auto entry = it->second;
+    if (entry->expires_at <= Clock::now()) {
+      erase(entry);
+      return nullptr;
+    }
+    entries_.splice(entries_.begin(), entries_, entry);
+    return entry->results;
+  }
+
+  QueryCache::Generation QueryCache::generation() const {
+    std::unique_lock<std::mutex> L(mutex_);
+    return generation_;
+  }
+
+  std::shared_ptr<const CachedResultSet> QueryCache::put(const std::string& sql, std::vector<std::string> relations, const IResultSet& results, Generation executed_after) {
+    // Copy outside the lock; this is the expensive part.
+    auto cached = std::make_shared<const CachedResultSet>(results);
+
+    std::unique_lock<std::mutex> L(mutex_);
+    auto existing = by_sql_.find(sql);
+    if (existing != by_sql_.end()) {
+      erase(existing->second);
+    }
+    // The result may predate a write that was made while the query ran.
+    if (cleared_at_ > executed_after) {
+      return cached;
+    }
+    for (auto& relation: relations) {
+      auto it = invalidated_at_.find(relation);
+      if (it != invalidated_at_.end() && it->second > executed_after) {
+        return cached;
+      }
+    }
+    if (cached->memory_usage() > options_.max_bytes || options_.max_entries == 0) {
+      return cached;
+    }
+
+    entries_.push_front(Entry{sql, std::move(relations), cached, Clock::now() + options_.ttl});
+    auto it = entries_.begin();
+    by_sql_[sql] = it;
+    for (auto& relation: it->relations) {
+      by_relation_[relation].insert(sql);
+    }
+    memory_usage_ += cached->memory_usage();
+    evict_to_fit();
+    return cached;
+  }
+
+  void QueryCache::invalidate(const std::string& relation) {
+    std::unique_lock<std::mutex> L(mutex_);
+    invalidated_at_[relation] = ++generation_;
+    auto it = by_relation_.find(relation);
+    if (it == by_relation_.end()) {
+      return;
+    }
+    auto sqls = std::move(it->second);
+    by_relation_.erase(it);
+    for (auto& sql: sqls) {
+      auto entry = by_sql_.find(sql);
+      if (entry != by_sql_.end()) {
+        erase(entry->second);
+      }
+    }
+  }
+
+  void QueryCache::clear() {
+    std::unique_lock<std::mutex> L(mutex_);
+    cleared_at_ = ++generation_;
+    entries_.clear();
+    by_sql_.clear();
+    by_relation_.clear();
+    memory_usage_ = 0;
+  }
+
+  size_t QueryCache::size() const {
+    std::unique_lock<std::mutex> L(mutex_);
+    return entries_.size();
+  }
+
+  size_t QueryCache::memory_usage() const {
+    std::unique_lock<std::mutex> L(mutex_);
+    return memory_usage_;
+  }
+
+  void QueryCache::erase(EntryList::iterator it) {
+    for (auto& relation: it->relations) {
+      auto r = by_relation_.find(relation);
+      if (r != by_relation_.end()) {
+        r->second.erase(it->sql);
+        if (r->second.empty()) {
+          by_relation_.erase(r);
+        }
+      }
+    }
+    memory_usage_ -= it->results->memory_usage();
+    by_sql_.erase(it->sql);
+    entries_.erase(it);
+  }
+
+  void QueryCache::evict_to_fit() {
+    while (!entries_.empty() && (entries_.size() > options_.max_entries || memory_usage_ > options_.max_bytes)) {
+      erase(std::prev(entries_.end()));
+    }
+  }
+
+  namespace {
+    struct RelationCollector {
+      std::vector<std::string> relations;
+      bool opaque = false;
+
+      void add(const std::string& relation) {
+        if (std::find(relations.begin(), relations.end(), relation) == relations.end()) {
+          relations.push_back(relation);
+        }
+      }
+
+      void fragment(const std::string& sql) {
+        // Raw SQL can only read another relation through a subquery.
+        std::string lower = sql;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        if (lower.find("select") != std::string::npos) {
+          opaque = true;
+        }
+      }
+
+      void visit(const ast::SelectQuery& query) {
+        add(query.relation);
+        for (auto& join: query.joins) {
+          add(join->relation);
+          visit(join->on.get());
+        }
+        for (auto& alias: query.select) {
+          visit(alias.value.get());
+        }
+        visit(query.where.get());
+        for (auto& group: query.group) {
+          visit(group.get());
+        }
+        for (auto& order: query.order) {
+          visit(order.value.get());
+        }
+      }
+
+      void visit(const ast::Value* value) {
+        if (value == nullptr) return;
+        if (auto x = dynamic_cast<const ast::SelectQuery*>(value)) {
+          visit(*x);
+        } else if (auto x = dynamic_cast<const ast::SQLFragmentValue*>(value)) {
+          fragment(x->sql);
+        } else if (auto x = dynamic_cast<const ast::SQLFragmentCondition*>(value)) {
+          fragment(x->sql);
+        } else if (auto x = dynamic_cast<const ast::Aggregate*>(value)) {
+          for (auto& argument: x->arguments) visit(argument.get());
+        } else if (auto x = dynamic_cast<const ast::List*>(value)) {
+          for (auto& element: x->elements) visit(element.get());
+        } else if (auto x = dynamic_cast<const ast::CaseSimple*>(value)) {
+          visit(x->value.get());
+          visit(x->otherwise.get());
+        } else if (auto x = dynamic_cast<const ast::Case*>(value)) {
+          visit(x->otherwise.get());
+        } else if (auto x = dynamic_cast<const ast::NotCondition*>(value)) {
+          visit(x->subcondition.get());
+        } else if (auto x = dynamic_cast<const ast::UnaryCondition*>(value)) {
+          visit(x->value.get());
+        } else if (auto x = dynamic_cast<const ast::BinaryCondition*>(value)) {
+          visit(x->lhs.get());
+          visit(x->rhs.get());
+        } else if (auto x = dynamic_cast<const ast::BetweenCondition*>(value)) {
+          visit(x->value.get());
+          visit(x->lower_bound.get());
+          visit(x->upper_bound.get());
+        } else if (auto x = dynamic_cast<const ast::LogicalCondition*>(value)) {
+          visit(x->lhs.get());
+          visit(x->rhs.get());
+        }
+      }
+    };
+  }
+
+  Maybe<std::vector<std::string>> relations_in(const ast::SelectQuery& query) {
+    RelationCollector collector;
+    collector.visit(query);
+    if (collector.opaque) {
+      return Nothing;
+    }
+    return std::move(collector.relations);
+  }
+
+  namespace {
+    struct SharedResultSet : IResultSet {
+      explicit SharedResultSet(std::shared_ptr<const IResultSet> results) : results_(std::move(results)) {}
+
+      size_t width() const final { return results_->width(); }
+      size_t height() const final { return results_->height(); }
+      std::vector<std::string> columns() const final { return results_->columns(); }
+      bool is_null_at(size_t idx, const std::string& col) const final { return results_->is_null_at(idx, col); }
+      Maybe<std::string> get(size_t idx, const std::string& col) const final { return results_->get(idx, col); }
+      size_t affected_rows() const final { return results_->affected_rows(); }
+      Maybe<size_t> column_index(const std::string& col) const final { return results_->column_index(col); }
+      const char* get_raw(size_t row, size_t col, size_t& length) const final { return results_->get_raw(row, col, length); }
+
+      std::shared_ptr<const IResultSet> results_;
+    };
+  }
+
+  std::unique_ptr<IResultSet> share_result_set(std::shared_ptr<const IResultSet> results) {
+    return std::unique_ptr<IResultSet>(new SharedResultSet(std::move(results)));
+  }
+}
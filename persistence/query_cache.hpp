@@ -0,0 +1,113 @@
+#pragma once
+#ifndef PERSISTENCE_QUERY_CACHE_HPP_INCLUDED
+#define PERSISTENCE_QUERY_CACHE_HPP_INCLUDED
+
+#include <persistence/result_set.hpp>
+#include <persistence/ast.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace persistence {
+  struct QueryCacheOptions {
+    bool enabled = false;
+    size_t max_entries = 1024;
+    size_t max_bytes = 64 * 1024 * 1024;
+    std::chrono::milliseconds ttl = std::chrono::seconds(30);
+  };
+
+  /*
+    An immutable in-memory copy of a result set. Since it never changes, one instance
+    can be read from any number of threads at once.
+  */
+  struct CachedResultSet : IResultSet {
+    explicit CachedResultSet(const IResultSet& results);
+
+    size_t width() const final { return columns_.size(); }
+    size_t height() const final { return height_; }
+    std::vector<std::string> columns() const final { return columns_; }
+    bool is_null_at(size_t idx, const std::string& col) const final;
+    Maybe<std::string> get(size_t idx, const std::string& col) const final;
+    size_t affected_rows() const final { return affected_rows_; }
+    Maybe<size_t> column_index(const std::string& col) const final;
+    const char* get_raw(size_t row, size_t col, size_t& length) const final;
+
+    size_t memory_usage() const { return memory_usage_; }
+  private:
+    const Maybe<std::string>* value_at(size_t idx, const std::string& col) const;
+
+    std::vector<std::string> columns_;
+    std::vector<Maybe<std::string>> values_; // Row-major
+    size_t height_ = 0;
+    size_t affected_rows_ = 0;
+    size_t memory_usage_ = 0;
+  };
+
+  /*
+    Caches SELECT results by their rendered SQL. Entries expire after a TTL, the least
+    recently used ones are evicted beyond the entry and memory caps, and writes made
+    through persistence invalidate every entry that read from the written relation.
+    Raw SQL writes bypass invalidation.
+
+    A write can invalidate a relation while a query reading it is in flight. To keep such a
+    result out of the cache, take generation() before executing the query and pass it to put(),
+    which doesn't store the result if any of its relations has been invalidated since.
+  */
+  class QueryCache {
+  public:
+    using Generation = uint64_t;
+
+    explicit QueryCache(const QueryCacheOptions& options);
+
+    Generation generation() const;
+    std::shared_ptr<const CachedResultSet> get(const std::string& sql);
+    std::shared_ptr<const CachedResultSet> put(const std::string& sql, std::vector<std::string> relations, const IResultSet& results, Generation executed_after);
+    void invalidate(const std::string& relation);
+    void clear();
+
+    size_t size() const;
+    size_t memory_usage() const;
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+      std::string sql;
+      std::vector<std::string> relations;
+      std::shared_ptr<const CachedResultSet> results;
+      Clock::time_point expires_at;
+    };
+    using EntryList = std::list<Entry>; // Most recently used first.
+
+    QueryCacheOptions options_;
+    mutable std::mutex mutex_;
+    EntryList entries_;
+    std::unordered_map<std::string, EntryList::iterator> by_sql_;
+    std::unordered_map<std::string, std::set<std::string>> by_relation_;
+    size_t memory_usage_ = 0;
+
+    // Bumped by every invalidation; each relation remembers the generation of its last one.
+    Generation generation_ = 0;
+    Generation cleared_at_ = 0;
+    std::unordered_map<std::string, Generation> invalidated_at_;
+
+    void erase(EntryList::iterator it);
+    void evict_to_fit();
+  };
+
+  // The relations a SELECT reads from: the primary relation, every joined relation, and those of any
+  // subqueries. Nothing if the query embeds an SQL fragment with a subquery we can't see into, in which
+  // case it mustn't be cached.
+  Maybe<std::vector<std::string>> relations_in(const ast::SelectQuery& query);
+
+  // Hands out a shared, immutable result set through the usual unique_ptr<IResultSet> interface.
+  std::unique_ptr<IResultSet> share_result_set(std::shared_ptr<const IResultSet> results);
+}
+
+#endif // PERSISTENCE_QUERY_CACHE_HPP_INCLUDED
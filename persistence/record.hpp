@@ -7,6 +7,8 @@
 #include <persistence/connection_provider.hpp>
 #include <persistence/datetime.hpp>
 #include <persistence/insert.hpp>
+#include <persistence/update.hpp>
+#include <persistence/context.hpp>
 
 #include <wayward/support/datetime.hpp>
 #include <wayward/support/error.hpp>
@@ -42,7 +44,8 @@ namespace persistence {
     if (!is_persisted(record)) {
       return make_error<PrimaryKeyError>("Cannot UPDATE because the record is new and doesn't have a primary key.");
     }
-    return make_error<PersistError>("Update NIY");
+    Context* ctx = record.context();
+    return detail::update(*record, get_type<T>(), ctx ? &ctx->snapshot_for(record.get()) : nullptr, true);
   }
 
   template <typename T>
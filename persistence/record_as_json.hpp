@@ -0,0 +1,58 @@
+#pragma once
+#ifndef PERSISTENCE_RECORD_AS_JSON_HPP_INCLUDED
+#define PERSISTENCE_RECORD_AS_JSON_HPP_INCLUDED
+
+#include <persistence/record_type.hpp>
+#include <persistence/record_ptr.hpp>
+#include <persistence/primary_key.hpp>
+#include <persistence/belongs_to.hpp>
+#include <wayward/support/datetime.hpp>
+#include <wayward/support/json.hpp>
+
+/*
+  Compile-time JSON serializers for records, producing the same output as going through
+  the adapters in record_as_structured_data.hpp (with Options::AllowLoad).
+*/
+
+namespace wayward {
+  template <typename T>
+  struct JSONSerializer<persistence::RecordPtr<T>> {
+    static void write(std::string& out, const persistence::RecordPtr<T>& record) {
+      if (record) {
+        persistence::get_type<T>()->write_json(out, *record);
+      } else {
+        out += "null";
+      }
+    }
+  };
+
+  template <typename T>
+  struct JSONSerializer<persistence::BelongsTo<T>> {
+    static void write(std::string& out, const persistence::BelongsTo<T>& association) {
+      // Like the adapter, this loads the associated record if it isn't already,
+      // and writes an empty object (not null) when there is none.
+      auto record = const_cast<persistence::BelongsTo<T>&>(association).get();
+      if (record) {
+        JSONSerializer<persistence::RecordPtr<T>>::write(out, record);
+      } else {
+        out += "{}";
+      }
+    }
+  };
+
+  template <>
+  struct JSONSerializer<persistence::PrimaryKey> {
+    static void write(std::string& out, const persistence::PrimaryKey& key) {
+      detail::write_json_integer(out, key.id);
+    }
+  };
+
+  template <>
+  struct JSONSerializer<DateTime> {
+    static void write(std::string& out, const DateTime& datetime) {
+      detail::write_json_string(out, datetime.iso8601());
+    }
+  };
+}
+
+#endif // PERSISTENCE_RECORD_AS_JSON_HPP_INCLUDED
@@ -109,6 +109,16 @@ namespace wayward {
       ReaderEnumeratorPtr enumerator() const final {
         return ReaderEnumeratorPtr{new PropertyEnumerator{this->ref_, this->options_}};
       }
+
+      void visit_children(IReaderVisitor& visitor) const final {
+        if (!this->ref_) {
+          return;
+        }
+        auto t = get_type<T>();
+        for (size_t i = 0; i < t->num_properties(); ++i) {
+          t->property_at(i)->visit_member_reader(*this->ref_, this->options_, visitor);
+        }
+      }
     };
 
     template <typename T>
@@ -226,6 +236,12 @@ namespace wayward {
         return value_reader()->enumerator();
       }
 
+      void visit_children(IReaderVisitor& visitor) const override {
+        if (auto reader = value_reader()) {
+          reader->visit_children(visitor);
+        }
+      }
+
       bool set_integer(Integer n) override {
         this->ref_.value_ = persistence::PrimaryKey{n};
         return true;
@@ -274,6 +290,12 @@ namespace wayward {
         return value_reader()->enumerator();
       }
 
+      void visit_children(IReaderVisitor& visitor) const override {
+        if (auto reader = value_reader()) {
+          reader->visit_children(visitor);
+        }
+      }
+
       AdapterPtr reference_at_index(size_t idx) override {
         return nullptr;
       }
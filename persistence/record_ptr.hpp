@@ -5,7 +5,11 @@
 #include <memory>
 
 namespace persistence {
-  struct ContextLifetimeSentinel;
+  struct Context;
+
+  struct ContextLifetimeSentinel {
+    Context* context = nullptr;
+  };
 
   template <typename T>
   struct RecordPtr {
@@ -23,6 +27,9 @@ namespace persistence {
     T* operator->() const { return record_; }
     T& operator*() const { return *record_; }
     T* get() const { return record_; }
+
+    // The context that owns the record, or nullptr.
+    Context* context() const { return sentinel_ ? sentinel_->context : nullptr; }
   private:
     friend struct Context;
     RecordPtr(T* record, std::shared_ptr<ContextLifetimeSentinel> sentinel) : record_(record), sentinel_(std::move(sentinel)) {}
@@ -0,0 +1,34 @@
+#include "persistence/record_snapshot.hpp"
+#include "persistence/record_type.hpp"
+#include "persistence/data_as_text.hpp"
+
+namespace persistence {
+  RecordSnapshot take_snapshot(AnyConstRef record, const IRecordType* record_type) {
+    RecordSnapshot snapshot;
+    size_t num = record_type->num_properties();
+    snapshot.values.reserve(num);
+    for (size_t i = 0; i < num; ++i) {
+      snapshot.values.push_back(record_type->abstract_property_at(i)->snapshot_value(record));
+    }
+    return std::move(snapshot);
+  }
+
+  std::vector<bool> changed_properties(AnyConstRef record, const IRecordType* record_type, const RecordSnapshot& before) {
+    size_t num = record_type->num_properties();
+    std::vector<bool> changed(num, true);
+    if (before.values.size() == num) {
+      for (size_t i = 0; i < num; ++i) {
+        changed[i] = !record_type->abstract_property_at(i)->matches_snapshot(record, before.values[i]);
+      }
+    }
+    return std::move(changed);
+  }
+
+  namespace detail {
+    std::string snapshot_text(AnyConstRef value, const wayward::IType* type) {
+      std::string text;
+      DataAsText{text}.append(value, type);
+      return std::move(text);
+    }
+  }
+}
@@ -0,0 +1,84 @@
+#pragma once
+#ifndef PERSISTENCE_RECORD_SNAPSHOT_HPP_INCLUDED
+#define PERSISTENCE_RECORD_SNAPSHOT_HPP_INCLUDED
+
+#include <persistence/primary_key.hpp>
+#include <wayward/support/any.hpp>
+#include <wayward/support/datetime.hpp>
+#include <wayward/support/maybe.hpp>
+
+#include <vector>
+#include <string>
+#include <type_traits>
+
+namespace persistence {
+  using wayward::Any;
+  using wayward::AnyConstRef;
+
+  struct IRecordType;
+
+  /*
+    The column values of a record as they were last read from or written to the data store,
+    one per property in property order. An empty snapshot means the state of the row is unknown.
+    Values are typed copies of the members (see ColumnEqualityFor), or their text for types
+    that can't be compared directly.
+  */
+  struct RecordSnapshot {
+    std::vector<Any> values;
+
+    bool empty() const { return values.empty(); }
+  };
+
+  RecordSnapshot take_snapshot(AnyConstRef record, const IRecordType* record_type);
+
+  // Returns one flag per property, set if the property differs from the snapshot.
+  // If `before` is empty, every property is considered changed.
+  std::vector<bool> changed_properties(AnyConstRef record, const IRecordType* record_type, const RecordSnapshot& before);
+
+  // Specializations compare column values for dirty tracking. Other types are compared by their text.
+  template <typename T, typename Enable = void>
+  struct ColumnEqualityFor {
+    static const bool Supported = false;
+    static bool equal(const T&, const T&) { return false; }
+  };
+
+  template <typename T>
+  struct ColumnEqualityFor<T, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+    static const bool Supported = true;
+    static bool equal(const T& a, const T& b) { return a == b; }
+  };
+
+  template <>
+  struct ColumnEqualityFor<std::string> {
+    static const bool Supported = true;
+    static bool equal(const std::string& a, const std::string& b) { return a == b; }
+  };
+
+  template <>
+  struct ColumnEqualityFor<PrimaryKey> {
+    static const bool Supported = true;
+    static bool equal(const PrimaryKey& a, const PrimaryKey& b) { return a.id == b.id; }
+  };
+
+  template <>
+  struct ColumnEqualityFor<wayward::DateTime> {
+    static const bool Supported = true;
+    static bool equal(const wayward::DateTime& a, const wayward::DateTime& b) { return a == b; }
+  };
+
+  template <typename T>
+  struct ColumnEqualityFor<wayward::Maybe<T>> {
+    static const bool Supported = ColumnEqualityFor<T>::Supported;
+    static bool equal(const wayward::Maybe<T>& a, const wayward::Maybe<T>& b) {
+      if (!a || !b) return !a && !b;
+      return ColumnEqualityFor<T>::equal(*a, *b);
+    }
+  };
+
+  namespace detail {
+    // The text a value is compared by, for types without a ColumnEqualityFor.
+    std::string snapshot_text(AnyConstRef value, const wayward::IType* type);
+  }
+}
+
+#endif // PERSISTENCE_RECORD_SNAPSHOT_HPP_INCLUDED
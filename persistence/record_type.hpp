@@ -10,6 +10,7 @@
 
 #include <vector>
 #include <memory>
+#include <unordered_map>
 
 namespace persistence {
   using wayward::IType;
@@ -53,6 +54,12 @@ namespace persistence {
     std::vector<std::unique_ptr<IAssociationFrom<RT>>> associations_;
     const IPropertyOf<RT>* primary_key_ = nullptr;
 
+    // Indices maintained by RecordTypeBuilder. When names collide, the first one registered wins.
+    std::unordered_map<std::string, const IPropertyOf<RT>*> properties_by_column_;
+    std::unordered_map<std::string, const IAssociationFrom<RT>*> associations_by_name_;
+    std::unordered_map<size_t, const IPropertyOf<RT>*> properties_by_offset_;
+    std::unordered_map<size_t, const IAssociationFrom<RT>*> singular_associations_by_offset_;
+
     bool has_value(const RT&) const final { return true; }
 
     void visit(RT& value, wayward::DataVisitor& visitor) const final {
@@ -61,6 +68,18 @@ namespace persistence {
       }
     }
 
+    // The compact JSON for record, without going through data_franca readers. See record_as_json.hpp.
+    void write_json(std::string& out, const RT& record) const {
+      out += '{';
+      for (size_t i = 0; i < properties_.size(); ++i) {
+        if (i != 0) {
+          out += ", ";
+        }
+        properties_[i]->write_json_member(out, record);
+      }
+      out += '}';
+    }
+
     void initialize_associations_in_object(void* obj, Context* ctx) const final {
       RT& object = *reinterpret_cast<RT*>(obj);
       for (auto& p: associations_) {
@@ -83,29 +102,23 @@ namespace persistence {
     const IAssociationFrom<RT>* association_at(size_t idx) const { return associations_.at(idx).get(); }
 
     const IPropertyOf<RT>* find_property_by_column_name(const std::string& name) const {
-      for (auto& prop: properties_) {
-        if (prop->column() == name) {
-          return prop.get();
-        }
-      }
-      return nullptr;
+      auto it = properties_by_column_.find(name);
+      return it != properties_by_column_.end() ? it->second : nullptr;
     }
 
     const IAssociationFrom<RT>* find_association_by_name(const std::string& name) const {
-      for (auto& assoc: associations_) {
-        if (assoc->name() == name) {
-          return assoc.get();
-        }
-      }
-      return nullptr;
+      auto it = associations_by_name_.find(name);
+      return it != associations_by_name_.end() ? it->second : nullptr;
     }
 
     template <typename M>
     const PropertyOf<RT, M>*
     find_property_by_member_pointer(M RT::*member) const {
-      for (auto& prop: properties_) {
-        auto p = dynamic_cast<const PropertyOf<RT, M>*>(prop.get());
-        if (p) return p;
+      // Distinct members never share an offset, so the property found was registered with this
+      // very member pointer, and is a PropertyOf<RT, M>.
+      auto it = properties_by_offset_.find(detail::member_offset(member));
+      if (it != properties_by_offset_.end()) {
+        return static_cast<const PropertyOf<RT, M>*>(it->second);
       }
       return nullptr;
     }
@@ -113,16 +126,15 @@ namespace persistence {
     template <typename M>
     auto find_singular_association_by_member_pointer(M RT::*member) const -> const SingularAssociationBase<RT, M>* {
       using Assoc = SingularAssociationBase<RT, M>;
-      for (auto& assoc: associations_) {
-        auto p = dynamic_cast<const Assoc*>(assoc.get());
-        if (p && p->member_ptr() == member) return p;
+      auto it = singular_associations_by_offset_.find(detail::member_offset(member));
+      if (it != singular_associations_by_offset_.end()) {
+        return static_cast<const Assoc*>(it->second);
       }
       return nullptr;
     }
 
     template <typename M>
     wayward::Maybe<std::string> find_column_by_member_pointer(M RT::*member) const {
-      // TODO: We can optimize this by indexing properties by their types.
       auto p = find_property_by_member_pointer(member);
       if (p) {
         return p->column();
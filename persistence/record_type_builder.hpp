@@ -8,6 +8,7 @@
 #include <persistence/has_many.hpp>
 #include <persistence/has_one.hpp>
 #include <persistence/record_as_structured_data.hpp>
+#include <persistence/record_as_json.hpp>
 
 #include <wayward/support/maybe.hpp>
 
@@ -36,8 +37,9 @@ namespace persistence {
 
       auto p = new BelongsToAssociation<RT, AssociatedType> { member, name, fkey };
       auto prop = new PropertyOf<RT, BelongsTo<AssociatedType>> { member, fkey };
-      type_->associations_.push_back(std::unique_ptr<IAssociationFrom<RT>>(p));
-      type_->properties_.push_back(std::unique_ptr<IPropertyOf<RT>>(prop));
+      add_association(p);
+      type_->singular_associations_by_offset_.emplace(detail::member_offset(member), p);
+      add_property(prop, detail::member_offset(member));
       return *p;
     }
 
@@ -45,7 +47,7 @@ namespace persistence {
     HasManyAssociation<RT, AssociatedType>&
     has_many(HasMany<AssociatedType> RT::*member, std::string name, std::string foreign_key) {
       auto p = new HasManyAssociation<RT, AssociatedType> { member, name, foreign_key };
-      type_->associations_.push_back(std::unique_ptr<IAssociationFrom<RT>>(p));
+      add_association(p);
       return *p;
     }
 
@@ -53,7 +55,8 @@ namespace persistence {
     PropertyOf<RT, HasOne<AssociatedType>>&
     has_one(HasOne<AssociatedType> RT::*member, std::string name, std::string foreign_key) {
       auto p = new HasOneAssociation<RT, AssociatedType> { member, name, foreign_key };
-      type_->associations_.push_back(std::unique_ptr<IAssociationFrom<RT>>(p));
+      add_association(p);
+      type_->singular_associations_by_offset_.emplace(detail::member_offset(member), p);
       return *p;
     }
 
@@ -61,7 +64,7 @@ namespace persistence {
     PropertyOf<RT, T>&
     property(T RT::*field, std::string column) {
       auto p = new PropertyOf<RT, T>{field, std::move(column)};
-      type_->properties_.push_back(std::unique_ptr<IPropertyOf<RT>>(p));
+      add_property(p, detail::member_offset(field));
 
       // TODO: Handle multi-column primary keys?
       if (std::is_same<T, PrimaryKey>::value) {
@@ -70,6 +73,18 @@ namespace persistence {
 
       return *p;
     }
+
+  private:
+    void add_property(IPropertyOf<RT>* p, size_t offset) {
+      type_->properties_.push_back(std::unique_ptr<IPropertyOf<RT>>(p));
+      type_->properties_by_column_.emplace(p->column(), p);
+      type_->properties_by_offset_.emplace(offset, p);
+    }
+
+    void add_association(IAssociationFrom<RT>* p) {
+      type_->associations_.push_back(std::unique_ptr<IAssociationFrom<RT>>(p));
+      type_->associations_by_name_.emplace(p->name(), p);
+    }
   };
 }
 
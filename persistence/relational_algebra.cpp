@@ -45,6 +45,15 @@ namespace persistence {
       };
     }
 
+    Value list(std::vector<Value> elements) {
+      auto l = new ast::List;
+      l->elements.reserve(elements.size());
+      for (auto& element: elements) {
+        l->elements.push_back(std::move(element.value));
+      }
+      return Value { make_cloning_ptr(l) };
+    }
+
     Value literal(AnyRef data, const IType* type) {
       DataAsLiteral data_as_literal;
       return Value { data_as_literal.make_literal(data, type) };
@@ -74,10 +83,72 @@ namespace persistence {
       };
     }
 
+    Condition::Condition(SQL sql) {
+      auto fragment = new ast::SQLFragmentCondition;
+      fragment->sql = std::move(sql.sql);
+      cond = make_cloning_ptr(fragment);
+    }
+
     Value::Value(SQL sql) {
       value = make_cloning_ptr(new ast::SQLFragmentValue{std::move(sql.sql)});
     }
 
+    Condition Value::is_null() && {
+      return Condition{make_cloning_ptr(new ast::UnaryCondition{
+        std::move(value),
+        ast::UnaryCondition::IsNull
+      })};
+    }
+
+    Condition Value::is_not_null() && {
+      return Condition{make_cloning_ptr(new ast::UnaryCondition{
+        std::move(value),
+        ast::UnaryCondition::IsNotNull
+      })};
+    }
+
+    Condition Value::is_true() && {
+      return Condition{make_cloning_ptr(new ast::UnaryCondition{
+        std::move(value),
+        ast::UnaryCondition::IsTrue
+      })};
+    }
+
+    Condition Value::is_not_true() && {
+      return Condition{make_cloning_ptr(new ast::UnaryCondition{
+        std::move(value),
+        ast::UnaryCondition::IsNotTrue
+      })};
+    }
+
+    Condition Value::is_false() && {
+      return Condition{make_cloning_ptr(new ast::UnaryCondition{
+        std::move(value),
+        ast::UnaryCondition::IsFalse
+      })};
+    }
+
+    Condition Value::is_not_false() && {
+      return Condition{make_cloning_ptr(new ast::UnaryCondition{
+        std::move(value),
+        ast::UnaryCondition::IsNotFalse
+      })};
+    }
+
+    Condition Value::is_unknown() && {
+      return Condition{make_cloning_ptr(new ast::UnaryCondition{
+        std::move(value),
+        ast::UnaryCondition::IsUnknown
+      })};
+    }
+
+    Condition Value::is_not_unknown() && {
+      return Condition{make_cloning_ptr(new ast::UnaryCondition{
+        std::move(value),
+        ast::UnaryCondition::IsNotUnknown
+      })};
+    }
+
     Condition Value::like(std::string literal) && {
       return Condition{make_cloning_ptr(new ast::BinaryCondition{
         std::move(value),
@@ -102,6 +173,46 @@ namespace persistence {
       })};
     }
 
+    Condition Value::in(Value&& other) && {
+      return Condition{make_cloning_ptr(new ast::BinaryCondition{
+        std::move(value),
+        std::move(other.value),
+        ast::BinaryCondition::In
+      })};
+    }
+
+    Condition Value::not_in(Value&& other) && {
+      return Condition{make_cloning_ptr(new ast::BinaryCondition{
+        std::move(value),
+        std::move(other.value),
+        ast::BinaryCondition::NotIn
+      })};
+    }
+
+    Condition Value::is_distinct_from(Value&& other) && {
+      return Condition{make_cloning_ptr(new ast::BinaryCondition{
+        std::move(value),
+        std::move(other.value),
+        ast::BinaryCondition::IsDistinctFrom
+      })};
+    }
+
+    Condition Value::is_not_distinct_from(Value&& other) && {
+      return Condition{make_cloning_ptr(new ast::BinaryCondition{
+        std::move(value),
+        std::move(other.value),
+        ast::BinaryCondition::IsNotDistinctFrom
+      })};
+    }
+
+    Condition Value::operator!=(Value&& other) && {
+      return Condition{make_cloning_ptr(new ast::BinaryCondition{
+        std::move(value),
+        std::move(other.value),
+        ast::BinaryCondition::NotEq
+      })};
+    }
+
     Condition Value::operator<(Value&& other) && {
       return Condition{make_cloning_ptr(new ast::BinaryCondition{
         std::move(value),
@@ -203,6 +314,7 @@ namespace persistence {
     }
 
     Projection Projection::select(std::vector<SelectAlias> selects) && {
+      query->head = nullptr;
       query->select.resize(selects.size());
       for (size_t i = 0; i < selects.size(); ++i) {
         query->select[i].value = std::move(selects[i].value.value);
@@ -217,6 +329,7 @@ namespace persistence {
     }
 
     Projection Projection::join(std::string relation, std::string as, Condition on, ast::Join::Type type) && {
+      query->head = nullptr;
       query->joins.push_back(make_cloning_ptr(new ast::Join{
         type,
         std::move(relation),
@@ -133,6 +133,7 @@ namespace persistence {
     Value      column(std::string relation, std::string column);
     Value      column(ast::SymbolicRelation, std::string column);
     Value      aggregate_impl(std::string func, Value* args, size_t num_args);
+    Value      list(std::vector<Value> elements);
     Value      literal(AnyRef, const IType*);
     Condition  negate(Condition&& cond);
     SQL        sql(std::string sql);
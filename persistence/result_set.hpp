@@ -18,6 +18,12 @@ namespace persistence {
     virtual std::vector<std::string> columns() const = 0;
     virtual bool is_null_at(size_t idx, const std::string& col) const = 0;
     virtual Maybe<std::string> get(size_t idx, const std::string& col) const = 0;
+    virtual size_t affected_rows() const = 0; // Number of rows touched by INSERT/UPDATE/DELETE
+
+    // Positional access, for decoders that resolve column names once per result set.
+    virtual Maybe<size_t> column_index(const std::string& col) const = 0;
+    // The NUL-terminated value at (row, col), or nullptr if it is NULL. Valid as long as the result set.
+    virtual const char* get_raw(size_t row, size_t col, size_t& length) const = 0;
   };
 }
 
@@ -0,0 +1,120 @@
+#include "persistence/update.hpp"
+#include "persistence/ast.hpp"
+#include "persistence/connection_pool.hpp"
+#include "persistence/data_store.hpp"
+#include "persistence/record_type.hpp"
+#include "persistence/record.hpp"
+#include "persistence/primary_key.hpp"
+#include "persistence/data_as_literal.hpp"
+#include "persistence/data_as_text.hpp"
+
+#include <wayward/support/format.hpp>
+#include <wayward/support/datetime.hpp>
+
+namespace persistence {
+  namespace detail {
+    using wayward::make_error;
+    using wayward::Maybe;
+    using wayward::make_cloning_ptr;
+
+    Maybe<ast::UpdateQuery>
+    make_update_query(AnyRef record, const IRecordType* record_type, const std::vector<bool>& changed) {
+      auto pk = record_type->abstract_primary_key();
+      if (pk == nullptr) {
+        throw PrimaryKeyError{"This record class does not seem to have a primary key column defined."};
+      }
+
+      ast::UpdateQuery query;
+      query.relation = record_type->relation();
+
+      for (size_t i = 0; i < record_type->num_properties(); ++i) {
+        auto p = record_type->abstract_property_at(i);
+        if (p == pk || !changed[i]) continue;
+        auto value = p->get(record);
+        if (!value) {
+          throw *std::move(value).error();
+        }
+        DataAsLiteral data_as_literal;
+        query.columns.push_back(p->column());
+        query.values.push_back(data_as_literal.make_literal(value.get(), &p->type()));
+      }
+
+      if (query.columns.empty()) {
+        return wayward::Nothing;
+      }
+
+      auto id = pk->get(record);
+      if (!id) {
+        throw *std::move(id).error();
+      }
+      DataAsLiteral data_as_literal;
+      query.where = make_cloning_ptr(new ast::BinaryCondition{
+        make_cloning_ptr(new ast::ColumnReference{record_type->relation(), pk->column()}),
+        data_as_literal.make_literal(id.get(), &pk->type()),
+        ast::BinaryCondition::Eq
+      });
+      return std::move(query);
+    }
+
+    Result<void>
+    update(AnyRef record, const IRecordType* record_type, RecordSnapshot* snapshot, bool set_updated_at) {
+      RecordSnapshot unknown;
+      const RecordSnapshot& previous = snapshot ? *snapshot : unknown;
+
+      // Only touch updated_at if something else actually changed.
+      auto changed = changed_properties(record, record_type, previous);
+      auto pk = record_type->abstract_primary_key();
+      bool any_changed = false;
+      for (size_t i = 0; i < changed.size(); ++i) {
+        if (changed[i] && record_type->abstract_property_at(i) != pk) {
+          any_changed = true;
+          break;
+        }
+      }
+      if (!any_changed) {
+        return Nothing;
+      }
+
+      if (set_updated_at) {
+        auto updated_at_property = record_type->find_abstract_property_by_column_name("updated_at");
+        if (updated_at_property != nullptr) {
+          auto now = wayward::DateTime::now();
+          updated_at_property->set(record, now);
+          for (size_t i = 0; i < changed.size(); ++i) {
+            if (record_type->abstract_property_at(i) == updated_at_property) {
+              changed[i] = true;
+            }
+          }
+        }
+      }
+
+      auto conn = current_connection_provider().acquire_connection_for_data_store(record_type->data_store());
+      std::unique_ptr<IResultSet> results;
+      std::string error_message;
+      try {
+        auto query = make_update_query(record, record_type, changed);
+        if (!query) {
+          return Nothing;
+        }
+        WAYWARD_LOG(conn.logger(), wayward::Severity::Debug, "p", wayward::format("Update {0}", record_type->name()));
+        results = conn.execute(*query);
+      }
+      catch (const wayward::Error& error) {
+        WAYWARD_LOG(conn.logger(), wayward::Severity::Error, "p", wayward::format("Error executing SQL:\n{0}", error.what()));
+        error_message = error.what();
+      }
+      invalidate_cached_queries(record_type->data_store(), record_type->relation());
+      if (!results) {
+        if (error_message.size()) {
+          return make_error<PersistError>(wayward::format("UPDATE failed:\n{0}", error_message));
+        }
+        return make_error<PersistError>("Backend did not return any results (meaning UPDATE probably failed).");
+      }
+
+      if (snapshot) {
+        *snapshot = take_snapshot(record, record_type);
+      }
+      return Nothing;
+    }
+  }
+}
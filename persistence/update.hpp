@@ -0,0 +1,28 @@
+#pragma once
+#ifndef PERSISTENCE_UPDATE_HPP_INCLUDED
+#define PERSISTENCE_UPDATE_HPP_INCLUDED
+
+#include <wayward/support/any.hpp>
+#include <wayward/support/result.hpp>
+#include <persistence/ast.hpp>
+#include <persistence/record_snapshot.hpp>
+
+namespace persistence {
+  using wayward::AnyRef;
+  using wayward::Result;
+
+  struct IRecordType;
+
+  namespace detail {
+    // Builds an UPDATE for the properties flagged in `changed` (see changed_properties()).
+    // Returns Nothing if no properties changed.
+    wayward::Maybe<ast::UpdateQuery>
+    make_update_query(AnyRef record, const IRecordType* record_type, const std::vector<bool>& changed);
+
+    // If `snapshot` is non-null, only changed columns are written, and the snapshot is refreshed on success.
+    Result<void>
+    update(AnyRef record, const IRecordType* record_type, RecordSnapshot* snapshot, bool set_updated_at);
+  }
+}
+
+#endif // PERSISTENCE_UPDATE_HPP_INCLUDED
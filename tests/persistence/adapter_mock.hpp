@@ -10,14 +10,23 @@ namespace persistence {
     struct AdapterMock : IAdapter {
       ConnectionMock connection;
       std::shared_ptr<ResultSetMock> result_set_;
+      std::shared_ptr<ConnectionJournalMock> journal_;
 
       AdapterMock() {
         result_set_ = std::make_shared<ResultSetMock>();
+        journal_ = std::make_shared<ConnectionJournalMock>();
       }
 
       std::unique_ptr<IConnection> connect(std::string conn_url) const {
+        ++journal_->connect_attempts;
+        if (!journal_->server_alive || journal_->unreachable.count(conn_url)) {
+          throw wayward::Error("Could not connect to server.");
+        }
         auto conn = std::unique_ptr<ConnectionMock>(new ConnectionMock(connection));
+        conn->host_ = conn_url;
         conn->results_ = result_set_;
+        conn->journal_ = journal_;
+        ++journal_->connects;
         return std::move(conn);
       }
     };
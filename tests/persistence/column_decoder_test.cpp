@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+
+#include <persistence/projection.hpp>
+#include <persistence/primary_key.hpp>
+#include <persistence/persistence_macro.hpp>
+#include <persistence/datetime.hpp>
+#include <persistence/data_store.hpp>
+
+#include "connection_mock.hpp"
+#include "adapter_mock.hpp"
+
+#include <cstring>
+
+namespace {
+  using persistence::PrimaryKey;
+  using persistence::BelongsTo;
+  using persistence::ColumnDecoderFor;
+  using wayward::Maybe;
+  using wayward::Nothing;
+  using wayward::DateTime;
+  using persistence::from;
+  using persistence::Context;
+
+  using persistence::AdapterRegistrar;
+  using persistence::test::AdapterMock;
+
+  struct Owner {
+    PrimaryKey id;
+  };
+
+  // Types without a ColumnDecoder are decoded through their IType.
+  struct Rating {
+    int32_t stars = 0;
+  };
+
+  struct Gadget {
+    PrimaryKey id;
+    int32_t count = 0;
+    float weight = 0;
+    Maybe<int64_t> serial;
+    DateTime made_at;
+    BelongsTo<Owner> owner;
+    std::string label = "unlabeled";
+  };
+
+  PERSISTENCE(Owner) {
+    property(&Owner::id, "id");
+  }
+
+  PERSISTENCE(Gadget) {
+    property(&Gadget::id, "id");
+    property(&Gadget::count, "count");
+    property(&Gadget::weight, "weight");
+    property(&Gadget::serial, "serial");
+    property(&Gadget::made_at, "made_at");
+    belongs_to(&Gadget::owner, "owner");
+    property(&Gadget::label, "label");
+  }
+
+  template <typename T>
+  void decode(T& member, const char* value) {
+    ColumnDecoderFor<T>::get()(&member, value, value ? std::strlen(value) : 0);
+  }
+
+  TEST(ColumnDecoder, decodes_scalars) {
+    int32_t i = 0;
+    decode(i, "-123");
+    EXPECT_EQ(-123, i);
+    decode(i, nullptr);
+    EXPECT_EQ(-123, i);
+
+    uint64_t u = 0;
+    decode(u, "18446744073709551615");
+    EXPECT_EQ(UINT64_MAX, u);
+
+    double d = 0;
+    decode(d, "1.5e3");
+    EXPECT_DOUBLE_EQ(1500, d);
+
+    std::string s = "old";
+    decode(s, "new");
+    EXPECT_EQ("new", s);
+    decode(s, nullptr);
+    EXPECT_EQ("new", s);
+  }
+
+  TEST(ColumnDecoder, decodes_maybes_and_keys) {
+    Maybe<int32_t> m = 1;
+    decode(m, nullptr);
+    EXPECT_FALSE(m);
+    decode(m, "42");
+    EXPECT_EQ(42, *m);
+
+    PrimaryKey pk;
+    decode(pk, "7");
+    EXPECT_EQ(7, pk.id);
+
+    BelongsTo<Owner> owner;
+    decode(owner, "9");
+    EXPECT_EQ(9, owner.id().id);
+  }
+
+  TEST(ColumnDecoder, leaves_unsupported_types_to_their_itype) {
+    EXPECT_EQ(nullptr, ColumnDecoderFor<Rating>::get());
+    EXPECT_EQ(nullptr, ColumnDecoderFor<Maybe<Rating>>::get());
+  }
+
+  struct ColumnDecoderProjectionTest : ::testing::Test {
+    AdapterRegistrar<AdapterMock> adapter_registrar_ = "test";
+    Context context;
+
+    persistence::test::ResultSetMock& results() {
+      return *adapter_registrar_.adapter_.result_set_;
+    }
+
+    void SetUp() override {
+      persistence::setup("test://test");
+      // Shuffled, with "gadgets_label" missing, to check that columns are matched by name.
+      results().columns_ = {"gadgets_weight", "gadgets_id", "gadgets_made_at", "gadgets_count", "gadgets_serial", "gadgets_owner_id"};
+      results().rows_.push_back({std::string{"2.5"}, std::string{"1"}, std::string{"2015-03-04 12:30:15+00"}, std::string{"-7"}, std::string{"123"}, std::string{"5"}});
+      results().rows_.push_back({std::string{"0.25"}, std::string{"2"}, Nothing, std::string{"0"}, Nothing, Nothing});
+    }
+  };
+
+  TEST_F(ColumnDecoderProjectionTest, populates_records_by_plan) {
+    auto gadgets = from<Gadget>(context).all();
+    ASSERT_EQ(2, gadgets.size());
+
+    auto& a = *gadgets[0];
+    EXPECT_EQ(1, a.id.id);
+    EXPECT_EQ(-7, a.count);
+    EXPECT_FLOAT_EQ(2.5f, a.weight);
+    EXPECT_EQ(123, *a.serial);
+    EXPECT_EQ(DateTime::at(2015, 3, 4, 12, 30, 15), a.made_at);
+    EXPECT_EQ(5, a.owner.id().id);
+    EXPECT_EQ("unlabeled", a.label);
+
+    auto& b = *gadgets[1];
+    EXPECT_EQ(2, b.id.id);
+    EXPECT_EQ(0, b.count);
+    EXPECT_FLOAT_EQ(0.25f, b.weight);
+    EXPECT_FALSE(b.serial);
+    EXPECT_FALSE(b.owner.id().is_persisted());
+  }
+
+  TEST_F(ColumnDecoderProjectionTest, rethrows_errors_from_parallel_decoding) {
+    results().rows_[1][2] = std::string{"yesterday"};
+    results().rows_[1][5] = std::string{"6"}; // Decoded after made_at.
+    wayward::Teamwork workers {2};
+    EXPECT_THROW(from<Gadget>(context).all(workers, 1), persistence::TypeError);
+
+    // Records from the failed query must not be handed out half-decoded.
+    results().rows_[1][2] = Nothing;
+    auto gadgets = from<Gadget>(context).all();
+    ASSERT_EQ(2, gadgets.size());
+    EXPECT_EQ(-7, gadgets[0]->count);
+    EXPECT_FLOAT_EQ(2.5f, gadgets[0]->weight);
+    EXPECT_EQ(DateTime::at(2015, 3, 4, 12, 30, 15), gadgets[0]->made_at);
+    EXPECT_EQ(5, gadgets[0]->owner.id().id);
+    EXPECT_FLOAT_EQ(0.25f, gadgets[1]->weight);
+    EXPECT_EQ(6, gadgets[1]->owner.id().id);
+  }
+
+  TEST_F(ColumnDecoderProjectionTest, replans_for_new_result_sets) {
+    auto q = from<Gadget>(context);
+    EXPECT_EQ(2, q.all().size());
+
+    auto other = std::unique_ptr<persistence::test::ResultSetMock>(new persistence::test::ResultSetMock);
+    other->columns_ = {"gadgets_label", "gadgets_id"};
+    other->rows_.push_back({std::string{"Widget"}, std::string{"3"}});
+    q.use_results(std::move(other));
+
+    auto gadgets = q.all();
+    ASSERT_EQ(1, gadgets.size());
+    EXPECT_EQ(3, gadgets[0]->id.id);
+    EXPECT_EQ("Widget", gadgets[0]->label);
+  }
+}
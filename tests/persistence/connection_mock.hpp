@@ -7,6 +7,9 @@
 #include <wayward/support/any.hpp>
 
 #include <regex>
+#include <deque>
+#include <functional>
+#include <set>
 
 #include "result_set_mock.hpp"
 
@@ -14,7 +17,40 @@ namespace persistence {
   namespace test {
     using wayward::ILogger;
 
+    // Shared between all connections made by the same AdapterMock, so tests can inspect what was sent.
+    struct ConnectionJournalMock {
+      std::vector<std::string> executed_sql;
+      std::vector<std::string> executed_on; // host() of the connection that ran each statement.
+      std::vector<std::string> copied_data;
+      std::vector<size_t> batch_sizes; // One entry per execute_batch() call.
+
+      // If non-empty, queries are answered from the front of this queue instead of the shared result set.
+      std::deque<ResultSetMock> queued_results;
+
+      // Called with each statement after it is recorded, to simulate what happens while it runs.
+      std::function<void(const std::string&)> on_execute;
+      // Called when a connection is closed.
+      std::function<void()> on_close;
+
+      // Simulates the server going away. Connections fail ping() and reconnect() while this is false.
+      bool server_alive = true;
+      // Simulates a server restart: ping() fails until reconnect() is called.
+      bool connections_broken = false;
+      // Connection URLs that can't be connected to at all.
+      std::set<std::string> unreachable;
+      size_t connect_attempts = 0;
+      size_t connects = 0;
+      size_t pings = 0;
+      size_t reconnects = 0;
+      // Tracks BEGIN/COMMIT/ROLLBACK so in_transaction() behaves like a real session.
+      bool in_transaction = false;
+    };
+
     struct ConnectionMock : persistence::IConnection {
+      ~ConnectionMock() {
+        if (journal_ && journal_->on_close) journal_->on_close();
+      }
+
       // Info
       std::string database() const override { return database_; }
       std::string user() const override { return user_; }
@@ -29,6 +65,13 @@ namespace persistence {
       std::unique_ptr<IResultSet> execute(std::string sql) override;
       std::unique_ptr<IResultSet> execute(const ast::IQuery& query) override;
       std::unique_ptr<IResultSet> execute(const ast::IQuery& query, const relational_algebra::IResolveSymbolicRelation&) override;
+      std::vector<std::unique_ptr<IResultSet>> execute_batch(const std::vector<std::string>& sql) override;
+      size_t copy_in(const std::string& relation, const std::vector<std::string>& columns, const std::string& data) override;
+
+      // Health
+      bool ping() override;
+      bool reconnect() override;
+      bool in_transaction() override { return journal_ && journal_->in_transaction; }
 
       std::string database_;
       std::string user_;
@@ -40,6 +83,7 @@ namespace persistence {
       size_t to_sql_called   = 0;
       size_t execute_called_with_string = 0;
       size_t execute_called_with_query  = 0;
+      std::shared_ptr<ConnectionJournalMock> journal_;
 
     private:
       std::string to_sql_impl(const ast::IQuery& q, const relational_algebra::IResolveSymbolicRelation&);
@@ -84,6 +128,33 @@ namespace persistence {
       return execute_impl(to_sql_impl(query, rel));
     }
 
+    inline std::vector<std::unique_ptr<IResultSet>> ConnectionMock::execute_batch(const std::vector<std::string>& sql) {
+      if (journal_) journal_->batch_sizes.push_back(sql.size());
+      std::vector<std::unique_ptr<IResultSet>> results;
+      for (auto& s: sql) {
+        results.push_back(execute_impl(s));
+      }
+      return results;
+    }
+
+    inline size_t ConnectionMock::copy_in(const std::string& relation, const std::vector<std::string>& columns, const std::string& data) {
+      if (journal_) journal_->copied_data.push_back(data);
+      return std::count(data.begin(), data.end(), '\n');
+    }
+
+    inline bool ConnectionMock::ping() {
+      if (!journal_) return true;
+      ++journal_->pings;
+      return journal_->server_alive && !journal_->connections_broken;
+    }
+
+    inline bool ConnectionMock::reconnect() {
+      if (!journal_) return true;
+      ++journal_->reconnects;
+      if (journal_->server_alive) journal_->connections_broken = false;
+      return journal_->server_alive;
+    }
+
     inline std::string ConnectionMock::to_sql_impl(const ast::IQuery& q, const relational_algebra::IResolveSymbolicRelation& rel) {
       PostgreSQLQueryRenderer renderer(*this, rel);
       return q.to_sql(renderer);
@@ -95,6 +166,27 @@ namespace persistence {
     }
 
     inline std::unique_ptr<IResultSet> ConnectionMock::execute_impl(std::string sql) {
+      if (journal_) {
+        journal_->executed_sql.push_back(sql);
+        journal_->executed_on.push_back(host_);
+        if (journal_->on_execute) {
+          journal_->on_execute(sql);
+        }
+        if (sql == "BEGIN") {
+          journal_->in_transaction = true;
+        } else if (sql == "COMMIT" || sql == "ROLLBACK") {
+          journal_->in_transaction = false;
+        }
+      }
+      // Transaction control returns no rows, and mustn't eat results queued for real statements.
+      if (sql == "BEGIN" || sql == "COMMIT" || sql.find("ROLLBACK") == 0 || sql.find("SAVEPOINT") == 0 || sql.find("RELEASE SAVEPOINT") == 0) {
+        return std::unique_ptr<IResultSet>(new ResultSetMock);
+      }
+      if (journal_ && !journal_->queued_results.empty()) {
+        auto results = std::unique_ptr<IResultSet>(new ResultSetMock(std::move(journal_->queued_results.front())));
+        journal_->queued_results.pop_front();
+        return results;
+      }
       return std::unique_ptr<IResultSet>(new ResultSetMock(*results_));
     }
   }
@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+
+#include <persistence/connection_pool.hpp>
+#include "adapter_mock.hpp"
+
+#include <thread>
+#include <atomic>
+#include <set>
+
+namespace {
+  using persistence::make_limited_connection_pool;
+  using persistence::make_connection_pool;
+  using persistence::ConnectionPoolOptions;
+  using persistence::AcquiredConnection;
+  using persistence::test::AdapterMock;
+  using namespace std::chrono;
+
+  TEST(ConnectionPool, hands_out_each_connection_once) {
+    AdapterMock adapter;
+    auto pool = make_limited_connection_pool(adapter, "test://test", 3);
+    std::vector<AcquiredConnection> held;
+    for (size_t i = 0; i < 3; ++i) {
+      held.push_back(pool->acquire());
+    }
+    EXPECT_FALSE((bool)pool->try_acquire());
+
+    held.pop_back();
+    auto again = pool->try_acquire();
+    EXPECT_TRUE((bool)again);
+    EXPECT_EQ(4, pool->stats().acquisitions);
+  }
+
+  TEST(ConnectionPool, try_acquire_for_times_out) {
+    AdapterMock adapter;
+    auto pool = make_limited_connection_pool(adapter, "test://test", 1);
+    auto held = pool->acquire();
+    auto started = steady_clock::now();
+    auto conn = pool->try_acquire_for(milliseconds(20));
+    EXPECT_FALSE((bool)conn);
+    EXPECT_GE(steady_clock::now() - started, milliseconds(20));
+    auto stats = pool->stats();
+    EXPECT_EQ(1, stats.waits);
+    EXPECT_EQ(1, stats.timeouts);
+    EXPECT_GE(stats.max_wait_time, milliseconds(20));
+  }
+
+  TEST(ConnectionPool, release_wakes_a_waiter) {
+    AdapterMock adapter;
+    auto pool = make_limited_connection_pool(adapter, "test://test", 1);
+    auto held = std::unique_ptr<AcquiredConnection>(new AcquiredConnection(pool->acquire()));
+    std::thread releaser([&]() {
+      std::this_thread::sleep_for(milliseconds(10));
+      held.reset();
+    });
+    auto conn = pool->try_acquire_for(seconds(5));
+    releaser.join();
+    EXPECT_TRUE((bool)conn);
+    EXPECT_EQ(1, pool->stats().waits);
+    EXPECT_EQ(0, pool->stats().timeouts);
+  }
+
+  TEST(ConnectionPool, survives_contention) {
+    AdapterMock adapter;
+    auto pool = make_limited_connection_pool(adapter, "test://test", 4);
+    std::atomic<int> concurrent {0};
+    std::atomic<int> max_concurrent {0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+      threads.emplace_back([&]() {
+        for (int i = 0; i < 500; ++i) {
+          auto conn = pool->acquire();
+          int n = ++concurrent;
+          int m = max_concurrent.load();
+          while (n > m && !max_concurrent.compare_exchange_weak(m, n)) {}
+          --concurrent;
+        }
+      });
+    }
+    for (auto& t: threads) {
+      t.join();
+    }
+    EXPECT_LE(max_concurrent.load(), 4);
+    EXPECT_EQ(8 * 500, pool->stats().acquisitions);
+  }
+
+  TEST(ConnectionPool, connects_lazily) {
+    AdapterMock adapter;
+    auto pool = make_limited_connection_pool(adapter, "test://test", 5);
+    EXPECT_EQ(0, adapter.journal_->connects);
+    {
+      auto a = pool->acquire();
+    }
+    auto b = pool->acquire(); // Reuses the first connection.
+    EXPECT_EQ(1, adapter.journal_->connects);
+    auto c = pool->acquire();
+    EXPECT_EQ(2, adapter.journal_->connects);
+    EXPECT_EQ(2, pool->stats().open_connections);
+  }
+
+  TEST(ConnectionPool, pings_idle_connections_on_checkout) {
+    AdapterMock adapter;
+    ConnectionPoolOptions options;
+    options.max_connections = 1;
+    options.validate_after = milliseconds(5);
+    auto pool = make_connection_pool(adapter, "test://test", options);
+    { auto conn = pool->acquire(); }
+    { auto conn = pool->acquire(); }
+    EXPECT_EQ(0, adapter.journal_->pings); // Recently used, so not pinged.
+
+    std::this_thread::sleep_for(milliseconds(10));
+    { auto conn = pool->acquire(); }
+    EXPECT_EQ(1, adapter.journal_->pings);
+    EXPECT_EQ(0, adapter.journal_->reconnects);
+  }
+
+  TEST(ConnectionPool, resets_broken_connections) {
+    AdapterMock adapter;
+    ConnectionPoolOptions options;
+    options.max_connections = 1;
+    options.validate_after = milliseconds(1);
+    auto pool = make_connection_pool(adapter, "test://test", options);
+    { auto conn = pool->acquire(); }
+    std::this_thread::sleep_for(milliseconds(5));
+
+    adapter.journal_->connections_broken = true;
+    { auto conn = pool->acquire(); }
+    EXPECT_EQ(1, adapter.journal_->reconnects);
+    EXPECT_EQ(1, adapter.journal_->connects);
+    EXPECT_EQ(1, pool->stats().reconnects);
+  }
+
+  TEST(ConnectionPool, recovers_after_server_comes_back) {
+    AdapterMock adapter;
+    ConnectionPoolOptions options;
+    options.max_connections = 1;
+    options.validate_after = milliseconds(1);
+    auto pool = make_connection_pool(adapter, "test://test", options);
+    { auto conn = pool->acquire(); }
+    std::this_thread::sleep_for(milliseconds(5));
+
+    adapter.journal_->server_alive = false;
+    EXPECT_ANY_THROW(pool->acquire());
+    EXPECT_EQ(0, pool->stats().open_connections);
+
+    // The slot went back to the pool, and gets a fresh connection.
+    adapter.journal_->server_alive = true;
+    auto conn = pool->acquire();
+    EXPECT_EQ(2, adapter.journal_->connects);
+    EXPECT_EQ(1, pool->stats().open_connections);
+  }
+
+  TEST(ConnectionPool, closes_idle_connections) {
+    AdapterMock adapter;
+    ConnectionPoolOptions options;
+    options.max_connections = 3;
+    options.idle_timeout = milliseconds(5);
+    auto pool = make_connection_pool(adapter, "test://test", options);
+    {
+      auto a = pool->acquire();
+      auto b = pool->acquire();
+      auto c = pool->acquire();
+    }
+    EXPECT_EQ(3, pool->stats().open_connections);
+    std::this_thread::sleep_for(milliseconds(10));
+    { auto a = pool->acquire(); }
+    // Releasing triggers a reaping pass; the connection just released is fresh and stays open.
+    EXPECT_EQ(1, pool->stats().open_connections);
+  }
+
+  TEST(ConnectionPool, closes_idle_connections_without_taking_the_free_list) {
+    AdapterMock adapter;
+    ConnectionPoolOptions options;
+    options.max_connections = 2;
+    options.idle_timeout = milliseconds(5);
+    auto pool = make_connection_pool(adapter, "test://test", options);
+    {
+      auto a = pool->acquire();
+      auto b = pool->acquire();
+    }
+    std::this_thread::sleep_for(milliseconds(10));
+
+    size_t closed = 0;
+    bool acquired_while_closing = false;
+    adapter.journal_->on_close = [&]() {
+      ++closed;
+      acquired_while_closing = (bool)pool->try_acquire();
+    };
+    { auto a = pool->acquire(); }
+    adapter.journal_->on_close = nullptr;
+
+    EXPECT_EQ(1, closed);
+    EXPECT_TRUE(acquired_while_closing);
+    EXPECT_EQ(1, pool->stats().open_connections);
+  }
+}
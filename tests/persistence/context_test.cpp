@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include <persistence/context.hpp>
+#include <persistence/primary_key.hpp>
+#include <persistence/persistence_macro.hpp>
+
+namespace {
+  using persistence::PrimaryKey;
+  using persistence::Context;
+  using persistence::RecordPtr;
+
+  struct Counted {
+    static size_t live;
+    PrimaryKey id;
+    std::string payload;
+    Counted() { ++live; }
+    ~Counted() { --live; }
+  };
+  size_t Counted::live = 0;
+
+  struct Other {
+    PrimaryKey id;
+  };
+
+  PERSISTENCE(Counted) {
+    property(&Counted::id, "id");
+    property(&Counted::payload, "payload");
+  }
+
+  PERSISTENCE(Other) {
+    property(&Other::id, "id");
+  }
+
+  TEST(Context, allocates_records_in_slabs) {
+    const size_t n = 3 * Context::Pool<Counted>::RecordsPerSlab + 7;
+    {
+      Context context;
+      std::vector<RecordPtr<Counted>> records;
+      for (size_t i = 0; i < n; ++i) {
+        records.push_back(context.create<Counted>());
+        records.back()->payload = std::to_string(i);
+      }
+      context.create<Other>();
+
+      EXPECT_EQ(n, Counted::live);
+      EXPECT_EQ(n, context.num_allocated<Counted>());
+      EXPECT_EQ(1, context.num_allocated<Other>());
+      EXPECT_EQ(records[0].get() + 1, records[1].get());
+      for (size_t i = 0; i < n; ++i) {
+        EXPECT_EQ(std::to_string(i), records[i]->payload);
+      }
+      records.clear();
+    }
+    EXPECT_EQ(0, Counted::live);
+  }
+
+  TEST(Context, clear_destroys_records) {
+    Context context;
+    context.create<Counted>();
+    EXPECT_EQ(1, Counted::live);
+    context.clear();
+    EXPECT_EQ(0, Counted::live);
+    EXPECT_EQ(0, context.num_allocated<Counted>());
+  }
+}
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+
+#include <persistence/record.hpp>
+#include <persistence/destroy.hpp>
+#include <persistence/data_store.hpp>
+#include <persistence/primary_key.hpp>
+#include <persistence/projection.hpp>
+#include <persistence/persistence_macro.hpp>
+
+#include "connection_mock.hpp"
+#include "adapter_mock.hpp"
+
+namespace {
+  using persistence::PrimaryKey;
+  using persistence::Context;
+  using persistence::column;
+  using wayward::Nothing;
+
+  using namespace persistence::test;
+
+  struct Foo {
+    PrimaryKey id;
+    int integer_value = -1;
+    std::string string_value;
+  };
+
+  PERSISTENCE(Foo) {
+    property(&Foo::id, "id");
+    property(&Foo::integer_value, "integer_value");
+    property(&Foo::string_value, "string_value");
+  }
+
+  struct DestroyTest : ::testing::Test {
+    persistence::AdapterRegistrar<AdapterMock> adapter_registrar_ = "test";
+    Context context;
+
+    persistence::test::ResultSetMock& results() {
+      return *adapter_registrar_.adapter_.result_set_;
+    }
+
+    persistence::test::ConnectionJournalMock& journal() {
+      return *adapter_registrar_.adapter_.journal_;
+    }
+
+    void SetUp() override {
+      persistence::setup("test://test");
+    }
+  };
+
+  TEST_F(DestroyTest, destroy_deletes_by_primary_key) {
+    auto foo = context.create<Foo>();
+    foo->id = 7;
+    results().affected_rows_ = 1;
+    EXPECT_TRUE(persistence::destroy(context, foo));
+    ASSERT_EQ(1, journal().executed_sql.size());
+    EXPECT_EQ("DELETE FROM foos WHERE \"foos\".\"id\" = 7", journal().executed_sql[0]);
+    EXPECT_FALSE(foo->id.is_persisted());
+  }
+
+  TEST_F(DestroyTest, destroy_refuses_new_records) {
+    auto foo = context.create<Foo>();
+    EXPECT_FALSE(persistence::destroy(context, foo));
+    EXPECT_EQ(0, journal().executed_sql.size());
+  }
+
+  TEST_F(DestroyTest, destroy_all_issues_a_single_delete) {
+    results().affected_rows_ = 42;
+    auto n = persistence::from<Foo>(context).where(column(&Foo::integer_value) > 10).destroy_all();
+    EXPECT_EQ(42, n);
+    ASSERT_EQ(1, journal().executed_sql.size());
+    EXPECT_EQ("DELETE FROM foos WHERE \"foos\".\"integer_value\" > 10", journal().executed_sql[0]);
+  }
+
+  TEST_F(DestroyTest, destroy_all_with_limit_deletes_by_primary_key) {
+    persistence::from<Foo>(context).where(column(&Foo::integer_value) > 10).limit(5).destroy_all();
+    ASSERT_EQ(1, journal().executed_sql.size());
+    auto& sql = journal().executed_sql[0];
+    EXPECT_EQ(0, sql.find("DELETE FROM foos WHERE \"foos\".\"id\" IN (SELECT \"foos\".\"id\" FROM foos WHERE"));
+    EXPECT_NE(std::string::npos, sql.find("LIMIT 5)"));
+  }
+
+  TEST_F(DestroyTest, destroy_all_forgets_loaded_records) {
+    results().columns_ = {"foos_id", "foos_integer_value", "foos_string_value"};
+    results().rows_.push_back({std::string{"7"}, std::string{"11"}, std::string{"Hello"}});
+    ASSERT_TRUE((bool)persistence::find<Foo>(context, PrimaryKey{7}));
+
+    persistence::from<Foo>(context).where(column(&Foo::integer_value) > 10).destroy_all();
+    results().rows_.clear();
+    EXPECT_FALSE((bool)persistence::find<Foo>(context, PrimaryKey{7}));
+  }
+}
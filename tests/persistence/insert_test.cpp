@@ -61,3 +61,146 @@ namespace {
     EXPECT_EQ(0, sql.find("INSERT INTO foos ("));
   }
 }
+
+namespace {
+  struct BulkInsertionTest : InsertionTest {
+    std::vector<persistence::RecordPtr<Foo>> records;
+
+    persistence::test::ConnectionJournalMock& journal() {
+      return *adapter_registrar_.adapter_.journal_;
+    }
+
+    void SetUp() override {
+      InsertionTest::SetUp();
+      results().columns_ = {"id"};
+      for (size_t i = 0; i < 3; ++i) {
+        auto record = context.create<Foo>();
+        record->integer_value = (int)i;
+        record->string_value = wayward::format("String {0}", i);
+        records.push_back(record);
+        results().rows_.push_back({wayward::format("{0}", i + 10)});
+      }
+    }
+  };
+
+  TEST_F(BulkInsertionTest, generates_multi_row_insert) {
+    std::vector<persistence::AnyRef> refs;
+    for (auto& r: records) {
+      refs.push_back(*r);
+    }
+    auto query = persistence::detail::make_bulk_insert_query(refs, persistence::get_type<Foo>(), false);
+    EXPECT_TRUE(query.good());
+    auto conn = persistence::data_store().acquire();
+    auto sql = conn.to_sql(query.get());
+    EXPECT_EQ(0, sql.find("INSERT INTO foos ("));
+    EXPECT_NE(std::string::npos, sql.find("'String 0'"));
+    EXPECT_NE(std::string::npos, sql.find("), ("));
+    EXPECT_NE(std::string::npos, sql.find("'String 2', NULL) RETURNING \"id\""));
+  }
+
+  TEST_F(BulkInsertionTest, insert_all_assigns_primary_keys) {
+    auto r = persistence::insert_all(records);
+    EXPECT_TRUE(r.good());
+    ASSERT_EQ(3, journal().executed_sql.size());
+    EXPECT_EQ("BEGIN", journal().executed_sql[0]);
+    EXPECT_EQ("COMMIT", journal().executed_sql[2]);
+    EXPECT_EQ(0, journal().copied_data.size());
+    EXPECT_EQ(10, records[0]->id);
+    EXPECT_EQ(11, records[1]->id);
+    EXPECT_EQ(12, records[2]->id);
+  }
+
+  TEST_F(BulkInsertionTest, insert_all_splits_batches) {
+    // One result per statement: a full batch of two, then the remainder.
+    ResultSetMock first;
+    first.columns_ = {"id"};
+    first.rows_ = {{std::string{"10"}}, {std::string{"11"}}};
+    ResultSetMock second;
+    second.columns_ = {"id"};
+    second.rows_ = {{std::string{"12"}}};
+    journal().queued_results.push_back(std::move(first));
+    journal().queued_results.push_back(std::move(second));
+
+    persistence::BulkInsertOptions options;
+    options.batch_size = 2;
+    auto r = persistence::insert_all(records, options);
+    EXPECT_TRUE(r.good());
+    // Both batches go in one transaction.
+    ASSERT_EQ(4, journal().executed_sql.size());
+    EXPECT_EQ("BEGIN", journal().executed_sql[0]);
+    EXPECT_NE(std::string::npos, journal().executed_sql[1].find("'String 0'"));
+    EXPECT_NE(std::string::npos, journal().executed_sql[1].find("'String 1'"));
+    EXPECT_EQ(std::string::npos, journal().executed_sql[1].find("'String 2'"));
+    EXPECT_EQ(std::string::npos, journal().executed_sql[2].find("'String 1'"));
+    EXPECT_NE(std::string::npos, journal().executed_sql[2].find("'String 2'"));
+    EXPECT_EQ(std::string::npos, journal().executed_sql[2].find("), ("));
+    EXPECT_EQ("COMMIT", journal().executed_sql[3]);
+    EXPECT_EQ(10, records[0]->id);
+    EXPECT_EQ(11, records[1]->id);
+    EXPECT_EQ(12, records[2]->id);
+  }
+
+  TEST_F(BulkInsertionTest, insert_all_uses_copy_for_large_batches) {
+    records[1]->string_value = "Tab\tand\nnewline";
+    persistence::BulkInsertOptions options;
+    options.copy_threshold = 3;
+    auto r = persistence::insert_all(records, options);
+    EXPECT_TRUE(r.good());
+    ASSERT_EQ(3, journal().executed_sql.size());
+    EXPECT_NE(std::string::npos, journal().executed_sql[1].find("nextval"));
+    EXPECT_EQ(1, journal().copied_data.size());
+    auto& data = journal().copied_data[0];
+    EXPECT_EQ(3, std::count(data.begin(), data.end(), '\n'));
+    EXPECT_EQ(0, data.find("10\t"));
+    EXPECT_NE(std::string::npos, data.find("\tTab\\tand\\nnewline\t\\N\n"));
+    EXPECT_EQ(10, records[0]->id);
+    EXPECT_EQ(12, records[2]->id);
+  }
+
+  TEST_F(BulkInsertionTest, insert_all_rolls_back_when_a_batch_fails) {
+    ResultSetMock first;
+    first.columns_ = {"id"};
+    first.rows_ = {{std::string{"10"}}, {std::string{"11"}}};
+    journal().queued_results.push_back(std::move(first));
+    journal().on_execute = [](const std::string& sql) {
+      if (sql.find("'String 2'") != std::string::npos) {
+        throw wayward::Error("duplicate key value violates unique constraint");
+      }
+    };
+
+    persistence::BulkInsertOptions options;
+    options.batch_size = 2;
+    auto r = persistence::insert_all(records, options);
+    journal().on_execute = nullptr;
+    EXPECT_FALSE(r.good());
+    EXPECT_EQ("ROLLBACK", journal().executed_sql.back());
+    EXPECT_FALSE(journal().in_transaction);
+    // The first batch was rolled back with the rest, so its records aren't persisted either.
+    for (auto& record: records) {
+      EXPECT_FALSE(record->id.is_persisted());
+    }
+  }
+
+  TEST_F(BulkInsertionTest, insert_all_uses_a_savepoint_inside_a_transaction) {
+    journal().in_transaction = true;
+    auto r = persistence::insert_all(records);
+    EXPECT_TRUE(r.good());
+    ASSERT_EQ(3, journal().executed_sql.size());
+    EXPECT_EQ("SAVEPOINT persistence_insert_all", journal().executed_sql[0]);
+    EXPECT_EQ("RELEASE SAVEPOINT persistence_insert_all", journal().executed_sql[2]);
+    EXPECT_TRUE(journal().in_transaction);
+  }
+
+  TEST_F(BulkInsertionTest, copy_validates_records_before_reserving_keys) {
+    records[2]->id = 99;
+    persistence::BulkInsertOptions options;
+    options.copy_threshold = 3;
+    auto r = persistence::insert_all(records, options);
+    EXPECT_FALSE(r.good());
+    for (auto& sql: journal().executed_sql) {
+      EXPECT_EQ(std::string::npos, sql.find("nextval"));
+    }
+    EXPECT_EQ(0, journal().copied_data.size());
+    EXPECT_EQ(99, records[2]->id);
+  }
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+
+#include <persistence/projection.hpp>
+#include <persistence/has_many.hpp>
+#include <persistence/belongs_to.hpp>
+#include <persistence/primary_key.hpp>
+#include <persistence/persistence_macro.hpp>
+#include <persistence/data_store.hpp>
+
+#include "connection_mock.hpp"
+#include "adapter_mock.hpp"
+
+namespace {
+  using persistence::PrimaryKey;
+  using persistence::BelongsTo;
+  using persistence::HasMany;
+  using persistence::Context;
+  using persistence::from;
+  using wayward::Maybe;
+  using wayward::Nothing;
+
+  using persistence::AdapterRegistrar;
+  using persistence::test::AdapterMock;
+  using persistence::test::ResultSetMock;
+
+  struct Author;
+  struct Comment;
+
+  struct Post {
+    PrimaryKey id;
+    std::string title;
+    BelongsTo<Author> author;
+    HasMany<Comment> comments;
+  };
+
+  struct Author {
+    PrimaryKey id;
+    std::string name;
+  };
+
+  struct Comment {
+    PrimaryKey id;
+    std::string text;
+    BelongsTo<Post> post;
+  };
+
+  PERSISTENCE(Post) {
+    property(&Post::id, "id");
+    property(&Post::title, "title");
+    belongs_to(&Post::author, "author");
+    has_many(&Post::comments, "comments", "post_id");
+  }
+
+  PERSISTENCE(Author) {
+    property(&Author::id, "id");
+    property(&Author::name, "name");
+  }
+
+  PERSISTENCE(Comment) {
+    property(&Comment::id, "id");
+    property(&Comment::text, "text");
+    belongs_to(&Comment::post, "post");
+  }
+
+  struct PreloadTest : ::testing::Test {
+    AdapterRegistrar<AdapterMock> adapter_registrar_ = "test";
+    Context context;
+
+    persistence::test::ConnectionJournalMock& journal() {
+      return *adapter_registrar_.adapter_.journal_;
+    }
+
+    void SetUp() override {
+      persistence::setup("test://test");
+
+      ResultSetMock posts;
+      posts.columns_ = {"posts_id", "posts_title", "posts_author_id"};
+      posts.rows_.push_back({std::string{"1"}, std::string{"First"}, std::string{"10"}});
+      posts.rows_.push_back({std::string{"2"}, std::string{"Second"}, std::string{"11"}});
+      posts.rows_.push_back({std::string{"3"}, std::string{"Third"}, std::string{"10"}});
+      journal().queued_results.push_back(std::move(posts));
+    }
+  };
+
+  TEST_F(PreloadTest, preloads_belongs_to_with_one_query) {
+    ResultSetMock authors;
+    authors.columns_ = {"authors_id", "authors_name"};
+    authors.rows_.push_back({std::string{"10"}, std::string{"Alice"}});
+    authors.rows_.push_back({std::string{"11"}, std::string{"Bob"}});
+    journal().queued_results.push_back(std::move(authors));
+
+    auto posts = from<Post>(context).preload(&Post::author).all();
+    ASSERT_EQ(2, journal().executed_sql.size());
+    EXPECT_NE(std::string::npos, journal().executed_sql[1].find("\"authors\".\"id\" IN (10, 11)"));
+
+    ASSERT_EQ(3, posts.size());
+    EXPECT_TRUE(posts[0]->author.is_loaded());
+    EXPECT_EQ("Alice", posts[0]->author.get()->name);
+    EXPECT_EQ("Bob", posts[1]->author.get()->name);
+    EXPECT_EQ(posts[0]->author.get(), posts[2]->author.get());
+    EXPECT_EQ(2, journal().executed_sql.size());
+  }
+
+  TEST_F(PreloadTest, preloads_has_many_with_one_query) {
+    ResultSetMock comments;
+    comments.columns_ = {"comments_id", "comments_text", "comments_post_id"};
+    comments.rows_.push_back({std::string{"100"}, std::string{"A"}, std::string{"1"}});
+    comments.rows_.push_back({std::string{"101"}, std::string{"B"}, std::string{"3"}});
+    comments.rows_.push_back({std::string{"102"}, std::string{"C"}, std::string{"1"}});
+    journal().queued_results.push_back(std::move(comments));
+
+    auto posts = from<Post>(context).includes(&Post::comments).all();
+    ASSERT_EQ(2, journal().executed_sql.size());
+    EXPECT_NE(std::string::npos, journal().executed_sql[1].find("\"comments\".\"post_id\" IN (1, 2, 3)"));
+
+    ASSERT_EQ(3, posts.size());
+    EXPECT_TRUE(posts[1]->comments.is_loaded());
+    EXPECT_EQ(2, posts[0]->comments.get().size());
+    EXPECT_EQ(0, posts[1]->comments.get().size());
+    EXPECT_EQ(1, posts[2]->comments.get().size());
+    EXPECT_EQ("C", posts[0]->comments.get()[1]->text);
+  }
+}
+
+namespace {
+  struct IdentityMapTest : PreloadTest {};
+
+  TEST_F(IdentityMapTest, same_row_yields_same_record) {
+    auto first = from<Post>(context).all();
+    ResultSetMock again;
+    again.columns_ = {"posts_id", "posts_title", "posts_author_id"};
+    again.rows_.push_back({std::string{"3"}, std::string{"Changed in DB"}, std::string{"10"}});
+    journal().queued_results.push_back(std::move(again));
+    first[2]->title = "Changed locally";
+
+    auto second = from<Post>(context).all();
+    ASSERT_EQ(1, second.size());
+    EXPECT_EQ(first[2], second[0]);
+    EXPECT_EQ("Changed locally", second[0]->title);
+  }
+
+  TEST_F(IdentityMapTest, find_uses_loaded_records) {
+    auto posts = from<Post>(context).all();
+    ASSERT_EQ(1, journal().executed_sql.size());
+    auto post = persistence::find<Post>(context, 2);
+    EXPECT_EQ(posts[1], post);
+    EXPECT_EQ(1, journal().executed_sql.size());
+  }
+
+  TEST_F(IdentityMapTest, preload_skips_loaded_records) {
+    ResultSetMock author;
+    author.columns_ = {"authors_id", "authors_name"};
+    author.rows_.push_back({std::string{"10"}, std::string{"Alice"}});
+    journal().queued_results.push_front(std::move(author));
+    auto alice = persistence::find<Author>(context, 10);
+    ASSERT_TRUE(alice != nullptr);
+
+    ResultSetMock authors;
+    authors.columns_ = {"authors_id", "authors_name"};
+    authors.rows_.push_back({std::string{"11"}, std::string{"Bob"}});
+    journal().queued_results.push_back(std::move(authors));
+    auto posts = from<Post>(context).preload(&Post::author).all();
+    ASSERT_EQ(3, journal().executed_sql.size());
+    EXPECT_NE(std::string::npos, journal().executed_sql[2].find("IN (11)"));
+    EXPECT_EQ(alice, posts[0]->author.get());
+  }
+}
@@ -128,6 +128,44 @@ namespace {
     EXPECT_NE(0, counter);
   }
 
+  TEST_F(ProjectionReturningSimpleColumns, loads_in_parallel) {
+    wayward::Teamwork workers {3};
+    auto foos = from<Foo>(context).all(workers, 2);
+    ASSERT_EQ(5, foos.size());
+    for (size_t i = 0; i < foos.size(); ++i) {
+      EXPECT_EQ(i + 1, foos[i]->id.id);
+      EXPECT_EQ(*results().rows_[i][1], foos[i]->string_value);
+      EXPECT_EQ((bool)results().rows_[i][2], (bool)foos[i]->nullable_string_value);
+      EXPECT_EQ(int32_t(i * 2), foos[i]->int32_value);
+      EXPECT_FALSE(context.snapshot_for(foos[i].get()).empty());
+    }
+    // Records already in the context are reused, not decoded again.
+    foos[0]->string_value = "Changed";
+    auto again = from<Foo>(context).all(workers, 2);
+    EXPECT_EQ(foos[0].get(), again[0].get());
+    EXPECT_EQ("Changed", again[0]->string_value);
+  }
+
+  TEST_F(ProjectionTest, loads_large_results_in_parallel) {
+    results().columns_ = {"foos_id", "foos_string_value", "foos_nullable_string_value", "foos_int32_value", "foos_double_value"};
+    const size_t num_rows = 10000;
+    for (size_t i = 0; i < num_rows; ++i) {
+      // Every id appears twice, which must give the same record both times.
+      results().rows_.push_back({wayward::format("{0}", i / 2 + 1), wayward::format("String {0}", i / 2), Nothing, wayward::format("{0}", i / 2), std::string{"0.5"}});
+    }
+    wayward::Teamwork workers {4};
+    auto foos = from<Foo>(context).all(workers, 128);
+    ASSERT_EQ(num_rows, foos.size());
+    EXPECT_EQ(num_rows / 2, context.num_allocated<Foo>());
+    for (size_t i = 0; i < num_rows; ++i) {
+      ASSERT_EQ(foos[i - i % 2].get(), foos[i].get());
+      EXPECT_EQ(int64_t(i / 2 + 1), foos[i]->id.id);
+      EXPECT_EQ(wayward::format("String {0}", i / 2), foos[i]->string_value);
+      EXPECT_EQ(int32_t(i / 2), foos[i]->int32_value);
+      EXPECT_EQ(0.5, foos[i]->double_value);
+    }
+  }
+
   using persistence::BelongsTo;
   using persistence::HasMany;
 
@@ -238,4 +276,27 @@ namespace {
     auto match = sql.find("INNER JOIN users AS u1 ON \"u0\".\"supervisor_id\" = \"u1\".\"id\" INNER JOIN users AS u2 ON \"u1\".\"supervisor_id\" = \"u2\".\"id\"");
     EXPECT_NE(std::string::npos, match);
   }
+
+  TEST_F(ProjectionReturningArticlesWithUsers, reuses_rendered_select_for_identical_shapes) {
+    auto first = from<Article>(context, "a").inner_join(&Article::author, "u").where(column("u", &User::name) == "foo");
+    auto sql1 = first.to_sql();
+    auto second = from<Article>(context, "a").inner_join(&Article::author, "u").where(column("u", &User::name) == "bar");
+    auto sql2 = second.to_sql();
+
+    auto where1 = sql1.find(" WHERE ");
+    auto where2 = sql2.find(" WHERE ");
+    ASSERT_NE(std::string::npos, where1);
+    EXPECT_EQ(sql1.substr(0, where1), sql2.substr(0, where2));
+    EXPECT_EQ(" WHERE \"u\".\"name\" = 'bar'", sql2.substr(where2));
+    EXPECT_NE(std::string::npos, sql2.find("\"u\".\"id\" AS \"u_id\""));
+  }
+
+  TEST_F(ProjectionReturningArticlesWithUsers, renders_hand_written_joins_after_shared_shape) {
+    auto plain = from<Article>(context, "b");
+    plain.to_sql();
+    auto joined = from<Article>(context, "b").inner_join("users", "x", persistence::relational_algebra::column("b", "author_id") == persistence::relational_algebra::column("x", "id"));
+    auto sql = joined.to_sql();
+    EXPECT_NE(std::string::npos, sql.find("INNER JOIN users AS x ON \"b\".\"author_id\" = \"x\".\"id\""));
+    EXPECT_NE(std::string::npos, sql.find("\"b\".\"id\" AS \"b_id\""));
+  }
 }
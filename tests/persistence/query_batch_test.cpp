@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include <persistence/query_batch.hpp>
+#include <persistence/record.hpp>
+#include <persistence/primary_key.hpp>
+#include <persistence/persistence_macro.hpp>
+#include <persistence/data_store.hpp>
+
+#include "connection_mock.hpp"
+#include "adapter_mock.hpp"
+
+namespace {
+  using persistence::PrimaryKey;
+  using persistence::Context;
+  using persistence::QueryBatch;
+  using persistence::test::ResultSetMock;
+
+  struct Foo {
+    PrimaryKey id;
+    std::string string_value;
+  };
+
+  PERSISTENCE(Foo) {
+    property(&Foo::id, "id");
+    property(&Foo::string_value, "string_value");
+  }
+
+  struct QueryBatchTest : ::testing::Test {
+    persistence::AdapterRegistrar<persistence::test::AdapterMock> adapter_registrar_ = "test";
+    Context context;
+
+    persistence::test::ConnectionJournalMock& journal() {
+      return *adapter_registrar_.adapter_.journal_;
+    }
+
+    void queue_results() {
+      ResultSetMock count;
+      count.columns_ = {"count"};
+      count.rows_.push_back({std::string{"7"}});
+      journal().queued_results.push_back(count);
+
+      ResultSetMock rows;
+      rows.columns_ = {"foos_id", "foos_string_value"};
+      rows.rows_.push_back({std::string{"1"}, std::string{"Hello"}});
+      rows.rows_.push_back({std::string{"2"}, std::string{"World"}});
+      journal().queued_results.push_back(rows);
+    }
+
+    void SetUp() override {
+      persistence::setup("test://test");
+    }
+  };
+
+  TEST_F(QueryBatchTest, sends_queued_queries_together) {
+    queue_results();
+    QueryBatch batch;
+    auto total = batch.count(persistence::from<Foo>(context));
+    auto page = batch.load(persistence::from<Foo>(context).limit(2));
+    EXPECT_EQ(2, batch.size());
+    EXPECT_TRUE(journal().executed_sql.empty());
+
+    auto records = page->all();
+    EXPECT_EQ(7, *total);
+    ASSERT_EQ(2, records.size());
+    EXPECT_EQ("World", records[1]->string_value);
+
+    ASSERT_EQ(1, journal().batch_sizes.size());
+    EXPECT_EQ(2, journal().batch_sizes[0]);
+    ASSERT_EQ(2, journal().executed_sql.size());
+    EXPECT_NE(std::string::npos, journal().executed_sql[0].find("COUNT"));
+    EXPECT_NE(std::string::npos, journal().executed_sql[1].find("LIMIT 2"));
+  }
+
+  TEST_F(QueryBatchTest, serves_cached_queries_without_sending_them) {
+    persistence::DataStoreOptions options;
+    options.query_cache.enabled = true;
+    persistence::setup("test://test", options);
+
+    queue_results();
+    QueryBatch first;
+    auto total = first.count(persistence::from<Foo>(context));
+    auto page = first.load(persistence::from<Foo>(context).limit(2));
+    first.execute();
+
+    QueryBatch second;
+    auto total_again = second.count(persistence::from<Foo>(context));
+    auto page_again = second.load(persistence::from<Foo>(context).limit(2));
+    EXPECT_EQ(7, *total_again);
+    EXPECT_EQ(2, page_again->all().size());
+    EXPECT_EQ(1, journal().batch_sizes.size());
+  }
+}
@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+
+#include <persistence/query_cache.hpp>
+#include <persistence/projection.hpp>
+#include <persistence/record.hpp>
+#include <persistence/primary_key.hpp>
+#include <persistence/persistence_macro.hpp>
+#include <persistence/data_store.hpp>
+
+#include "connection_mock.hpp"
+#include "adapter_mock.hpp"
+
+namespace {
+  using persistence::PrimaryKey;
+  using persistence::Context;
+  using persistence::QueryCache;
+  using persistence::QueryCacheOptions;
+  using persistence::test::ResultSetMock;
+  using wayward::Nothing;
+
+  ResultSetMock make_results(size_t rows) {
+    ResultSetMock results;
+    results.columns_ = {"a", "b"};
+    for (size_t i = 0; i < rows; ++i) {
+      results.rows_.push_back({std::to_string(i), Nothing});
+    }
+    return results;
+  }
+
+  TEST(QueryCache, returns_copies_of_stored_results) {
+    QueryCache cache { QueryCacheOptions{} };
+    EXPECT_EQ(nullptr, cache.get("SELECT 1"));
+    cache.put("SELECT 1", {"foos"}, make_results(2), cache.generation());
+    auto cached = cache.get("SELECT 1");
+    ASSERT_NE(nullptr, cached);
+    EXPECT_EQ(2, cached->height());
+    EXPECT_EQ("1", *cached->get(1, "a"));
+    EXPECT_TRUE(cached->is_null_at(1, "b"));
+    EXPECT_EQ(cached, cache.get("SELECT 1"));
+  }
+
+  TEST(QueryCache, invalidates_by_relation) {
+    QueryCache cache { QueryCacheOptions{} };
+    cache.put("SELECT 1", {"foos", "bars"}, make_results(1), cache.generation());
+    cache.put("SELECT 2", {"bars"}, make_results(1), cache.generation());
+    cache.put("SELECT 3", {"bazs"}, make_results(1), cache.generation());
+    cache.invalidate("bars");
+    EXPECT_EQ(nullptr, cache.get("SELECT 1"));
+    EXPECT_EQ(nullptr, cache.get("SELECT 2"));
+    EXPECT_NE(nullptr, cache.get("SELECT 3"));
+    EXPECT_EQ(1, cache.size());
+  }
+
+  TEST(QueryCache, drops_results_invalidated_while_in_flight) {
+    QueryCache cache { QueryCacheOptions{} };
+    auto before = cache.generation();
+    auto results = make_results(1); // The query runs...
+    cache.invalidate("foos");       // ...while a write lands.
+    EXPECT_NE(nullptr, cache.put("SELECT 1", {"bars", "foos"}, results, before));
+    EXPECT_EQ(nullptr, cache.get("SELECT 1"));
+
+    // Invalidating other relations doesn't matter.
+    before = cache.generation();
+    cache.invalidate("bazs");
+    cache.put("SELECT 1", {"bars", "foos"}, results, before);
+    EXPECT_NE(nullptr, cache.get("SELECT 1"));
+
+    before = cache.generation();
+    cache.clear();
+    cache.put("SELECT 2", {"bars"}, results, before);
+    EXPECT_EQ(nullptr, cache.get("SELECT 2"));
+  }
+
+  TEST(QueryCache, expires_entries) {
+    QueryCacheOptions options;
+    options.ttl = std::chrono::milliseconds(0);
+    QueryCache cache { options };
+    cache.put("SELECT 1", {"foos"}, make_results(1), cache.generation());
+    EXPECT_EQ(nullptr, cache.get("SELECT 1"));
+    EXPECT_EQ(0, cache.size());
+  }
+
+  TEST(QueryCache, evicts_least_recently_used) {
+    QueryCacheOptions options;
+    options.max_entries = 2;
+    QueryCache cache { options };
+    cache.put("SELECT 1", {"foos"}, make_results(1), cache.generation());
+    cache.put("SELECT 2", {"foos"}, make_results(1), cache.generation());
+    cache.get("SELECT 1");
+    cache.put("SELECT 3", {"foos"}, make_results(1), cache.generation());
+    EXPECT_NE(nullptr, cache.get("SELECT 1"));
+    EXPECT_EQ(nullptr, cache.get("SELECT 2"));
+    EXPECT_NE(nullptr, cache.get("SELECT 3"));
+
+    QueryCacheOptions small;
+    small.max_bytes = 1;
+    QueryCache tiny { small };
+    EXPECT_NE(nullptr, tiny.put("SELECT 1", {"foos"}, make_results(1), tiny.generation()));
+    EXPECT_EQ(0, tiny.size());
+    EXPECT_EQ(0, tiny.memory_usage());
+  }
+
+  TEST(QueryCache, relations_include_subqueries) {
+    namespace ast = persistence::ast;
+    ast::SelectQuery subquery;
+    subquery.relation = "bars";
+    ast::SelectQuery query;
+    query.relation = "foos";
+    query.where = wayward::make_cloning_ptr(new ast::BinaryCondition{
+      wayward::make_cloning_ptr(new ast::ColumnReference{"foos", "id"}),
+      wayward::make_cloning_ptr(new ast::SelectQuery{subquery}),
+      ast::BinaryCondition::In
+    });
+    auto relations = persistence::relations_in(query);
+    ASSERT_TRUE(bool(relations));
+    EXPECT_EQ((std::vector<std::string>{"foos", "bars"}), *relations);
+  }
+
+  struct Foo {
+    PrimaryKey id;
+    std::string string_value;
+  };
+
+  PERSISTENCE(Foo) {
+    property(&Foo::id, "id");
+    property(&Foo::string_value, "string_value");
+  }
+
+  struct QueryCacheWithDataStore : ::testing::Test {
+    persistence::AdapterRegistrar<persistence::test::AdapterMock> adapter_registrar_ = "test";
+    Context context;
+
+    persistence::test::ConnectionJournalMock& journal() {
+      return *adapter_registrar_.adapter_.journal_;
+    }
+
+    void SetUp() override {
+      persistence::DataStoreOptions options;
+      options.query_cache.enabled = true;
+      persistence::setup("test://test", options);
+      auto& results = *adapter_registrar_.adapter_.result_set_;
+      results.columns_ = {"foos_id", "foos_string_value", "id"};
+      results.rows_.push_back({std::string{"1"}, std::string{"Hello"}, std::string{"1"}});
+    }
+
+    void TearDown() override {
+      persistence::setup("test://test");
+    }
+  };
+
+  TEST_F(QueryCacheWithDataStore, repeated_selects_hit_the_cache) {
+    auto a = persistence::from<Foo>(context).all();
+    auto b = persistence::from<Foo>(context).all();
+    EXPECT_EQ(1, journal().executed_sql.size());
+    EXPECT_EQ(1, b.size());
+    EXPECT_EQ(1, persistence::data_store().query_cache()->size());
+  }
+
+  TEST_F(QueryCacheWithDataStore, writes_invalidate_the_cache) {
+    persistence::from<Foo>(context).all();
+    auto foo = context.create<Foo>();
+    foo->string_value = "World";
+    EXPECT_TRUE(persistence::insert(foo).good());
+    EXPECT_EQ(0, persistence::data_store().query_cache()->size());
+    persistence::from<Foo>(context).all();
+    EXPECT_EQ(3, journal().executed_sql.size());
+  }
+
+  TEST_F(QueryCacheWithDataStore, doesnt_cache_selects_that_race_with_writes) {
+    journal().on_execute = [](const std::string&) {
+      persistence::data_store().query_cache()->invalidate("foos");
+    };
+    EXPECT_EQ(1, persistence::from<Foo>(context).all().size());
+    EXPECT_EQ(0, persistence::data_store().query_cache()->size());
+
+    journal().on_execute = nullptr;
+    persistence::from<Foo>(context).all();
+    persistence::from<Foo>(context).all();
+    EXPECT_EQ(2, journal().executed_sql.size());
+  }
+  TEST_F(QueryCacheWithDataStore, doesnt_cache_selects_with_opaque_subqueries) {
+    // We can't tell which relations the fragment reads, so a write to bars couldn't invalidate it.
+    auto q = persistence::from<Foo>(context).where(persistence::sql("foos.id IN (SELECT foo_id FROM bars)"));
+    q.all();
+    EXPECT_EQ(0, persistence::data_store().query_cache()->size());
+    persistence::from<Foo>(context).where(persistence::sql("foos.id IN (SELECT foo_id FROM bars)")).all();
+    EXPECT_EQ(2, journal().executed_sql.size());
+  }
+}
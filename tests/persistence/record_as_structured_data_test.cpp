@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include <persistence/context.hpp>
+#include <persistence/datetime.hpp>
+#include <persistence/primary_key.hpp>
+#include <persistence/persistence_macro.hpp>
+#include <persistence/belongs_to.hpp>
+#include <persistence/record_as_structured_data.hpp>
+#include <wayward/support/json.hpp>
+
+namespace {
+  using persistence::Context;
+  using persistence::PrimaryKey;
+  using persistence::RecordPtr;
+  using wayward::data_franca::IReader;
+  using wayward::data_franca::Spectator;
+  using wayward::data_franca::String;
+
+  struct Person {
+    PrimaryKey id;
+    std::string name;
+    wayward::Maybe<int32_t> age;
+    wayward::DateTime born;
+  };
+
+  PERSISTENCE(Person) {
+    property(&Person::id, "id");
+    property(&Person::name, "name");
+    property(&Person::age, "age");
+    property(&Person::born, "born");
+  }
+
+  struct Pet {
+    PrimaryKey id;
+    std::string name;
+    persistence::BelongsTo<Person> owner;
+  };
+
+  PERSISTENCE(Pet) {
+    property(&Pet::id, "id");
+    property(&Pet::name, "name");
+    belongs_to(&Pet::owner, "owner");
+  }
+
+  std::vector<RecordPtr<Person>> make_people(Context& context) {
+    std::vector<RecordPtr<Person>> people;
+    for (int i = 0; i < 2; ++i) {
+      auto p = context.create<Person>();
+      p->id = PrimaryKey{i + 1};
+      p->name = "Person " + std::to_string(i + 1);
+      p->born = wayward::DateTime::at(1980 + i, 1, 2, 3, 4, 5);
+      if (i == 0) {
+        p->age = 42;
+      }
+      people.push_back(std::move(p));
+    }
+    return people;
+  }
+
+  TEST(RecordAsStructuredData, visits_properties_by_column) {
+    Context context;
+    auto people = make_people(context);
+    std::vector<std::string> keys;
+    wayward::data_franca::visit_children(Spectator{people[0]}.reader_iface(), [&](const String* key, const IReader& value) {
+      keys.push_back(*key);
+    });
+    EXPECT_EQ((std::vector<std::string>{"id", "name", "age", "born"}), keys);
+  }
+
+  TEST(RecordAsStructuredData, serializes_records_as_json) {
+    Context context;
+    auto people = make_people(context);
+    std::string expected = "[{\"id\": 1, \"name\": \"Person 1\", \"age\": 42, \"born\": \"" + people[0]->born.iso8601() + "\"}, "
+      "{\"id\": 2, \"name\": \"Person 2\", \"age\": null, \"born\": \"" + people[1]->born.iso8601() + "\"}]";
+    EXPECT_EQ(expected, wayward::as_json(people));
+
+    // Through the serializer generated for the record type rather than the adapters.
+    std::string out;
+    wayward::write_json(out, people);
+    EXPECT_EQ(expected, out);
+    out.clear();
+    wayward::write_json(out, RecordPtr<Person>{});
+    EXPECT_EQ("null", out);
+  }
+
+  TEST(RecordAsStructuredData, serializes_unset_associations_like_the_adapters) {
+    Context context;
+    auto pet = context.create<Pet>();
+    pet->id = PrimaryKey{1};
+    pet->name = "Rex";
+    std::string out;
+    wayward::write_json(out, pet);
+    EXPECT_EQ(wayward::as_json(pet), out);
+    EXPECT_NE(std::string::npos, out.find("\"owner_id\": {}"));
+  }
+}
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include <persistence/primary_key.hpp>
+#include <persistence/persistence_macro.hpp>
+
+namespace {
+  using persistence::BelongsTo;
+  using persistence::HasMany;
+  using persistence::PrimaryKey;
+  using persistence::get_type;
+
+  struct Author;
+
+  struct Article {
+    PrimaryKey id;
+    std::string title;
+    std::string body;
+    BelongsTo<Author> author;
+  };
+
+  struct Author {
+    PrimaryKey id;
+    std::string name;
+    HasMany<Article> articles;
+  };
+
+  PERSISTENCE(Article) {
+    property(&Article::id, "id");
+    property(&Article::title, "title");
+    property(&Article::body, "body");
+    belongs_to(&Article::author, "author");
+  }
+
+  PERSISTENCE(Author) {
+    property(&Author::id, "id");
+    property(&Author::name, "name");
+    has_many(&Author::articles, "articles", "author_id");
+  }
+
+  TEST(RecordType, finds_properties_by_column_name) {
+    auto t = get_type<Article>();
+    EXPECT_EQ(t->property_at(1), t->find_property_by_column_name("title"));
+    EXPECT_EQ(t->property_at(2), t->find_property_by_column_name("body"));
+    EXPECT_EQ(t->property_at(3), t->find_property_by_column_name("author_id"));
+    EXPECT_EQ(nullptr, t->find_property_by_column_name("author"));
+    EXPECT_EQ(nullptr, t->find_property_by_column_name("missing"));
+  }
+
+  TEST(RecordType, finds_associations_by_name) {
+    EXPECT_EQ(get_type<Article>()->association_at(0), get_type<Article>()->find_association_by_name("author"));
+    EXPECT_EQ(get_type<Author>()->association_at(0), get_type<Author>()->find_association_by_name("articles"));
+    EXPECT_EQ(nullptr, get_type<Author>()->find_association_by_name("author"));
+  }
+
+  TEST(RecordType, finds_properties_by_member_pointer) {
+    auto t = get_type<Article>();
+    EXPECT_EQ(t->property_at(0), t->find_property_by_member_pointer(&Article::id));
+    // Members of the same type are told apart.
+    EXPECT_EQ(t->property_at(1), t->find_property_by_member_pointer(&Article::title));
+    EXPECT_EQ(t->property_at(2), t->find_property_by_member_pointer(&Article::body));
+    EXPECT_EQ("body", *t->find_column_by_member_pointer(&Article::body));
+    EXPECT_EQ("author_id", *t->find_column_by_member_pointer(&Article::author));
+    EXPECT_EQ(nullptr, get_type<Author>()->find_property_by_member_pointer(&Author::articles));
+  }
+
+  TEST(RecordType, finds_singular_associations_by_member_pointer) {
+    EXPECT_EQ(get_type<Article>()->association_at(0), get_type<Article>()->find_singular_association_by_member_pointer(&Article::author));
+  }
+}
@@ -24,6 +24,12 @@ namespace {
     EXPECT_EQ(sql, "SELECT * FROM foos WHERE \"foos\".\"a\" = 2");
   }
 
+  TEST_F(RelationalAlgebraWithConnectionMock, select_star_from_foos_where_a_in_list) {
+    auto query = projection("foos").where(column("foos", "a").in(list({literal(1), literal(2)})));
+    auto sql = connection.to_sql(*query.query);
+    EXPECT_EQ(sql, "SELECT * FROM foos WHERE \"foos\".\"a\" IN (1, 2)");
+  }
+
   TEST_F(RelationalAlgebraWithConnectionMock, select_b_from_foos_where_a_greater_than_2) {
     auto query = projection("foos").where(column("foos", "a") > literal(2)).select({column("foos", "b")});
     auto sql = connection.to_sql(*query.query);
@@ -41,4 +47,10 @@ namespace {
     auto sql = connection.to_sql(*query.query);
     EXPECT_EQ(sql, "SELECT * FROM foos ORDER BY \"foos\".\"a\" DESC");
   }
+
+  TEST_F(RelationalAlgebraWithConnectionMock, select_star_from_foos_where_a_is_null) {
+    auto query = projection("foos").where(column("foos", "a").is_null());
+    auto sql = connection.to_sql(*query.query);
+    EXPECT_EQ(sql, "SELECT * FROM foos WHERE (\"foos\".\"a\") IS NULL");
+  }
 }
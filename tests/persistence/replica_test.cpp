@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+
+#include <persistence/data_store.hpp>
+#include <persistence/connection_provider.hpp>
+#include <persistence/connection_retainer.hpp>
+#include <persistence/projection.hpp>
+#include <persistence/insert.hpp>
+#include <persistence/primary_key.hpp>
+#include <persistence/persistence_macro.hpp>
+
+#include <wayward/support/fiber.hpp>
+
+#include "adapter_mock.hpp"
+
+#include <thread>
+
+namespace {
+  using persistence::PrimaryKey;
+  using persistence::Context;
+  using persistence::DataStoreOptions;
+  using persistence::current_connection_provider;
+  using namespace std::chrono;
+
+  struct Foo {
+    PrimaryKey id;
+    std::string string_value;
+  };
+
+  PERSISTENCE(Foo) {
+    property(&Foo::id, "id");
+    property(&Foo::string_value, "string_value");
+  }
+
+  struct ReplicaRouting : ::testing::Test {
+    persistence::AdapterRegistrar<persistence::test::AdapterMock> adapter_registrar_ = "test";
+
+    persistence::test::ConnectionJournalMock& journal() {
+      return *adapter_registrar_.adapter_.journal_;
+    }
+
+    void setup(const std::string& name, std::vector<std::string> replicas, milliseconds window = seconds(2)) {
+      DataStoreOptions options;
+      options.pool_size = 1;
+      options.replica_urls = std::move(replicas);
+      options.read_your_writes_window = window;
+      persistence::setup(name, "test://primary", options);
+    }
+
+    std::string read_host(const std::string& name) {
+      return current_connection_provider().acquire_read_connection_for_data_store(name).host();
+    }
+
+    void TearDown() override {
+      persistence::setup("test://test");
+    }
+  };
+
+  TEST_F(ReplicaRouting, reads_without_replicas_go_to_the_primary) {
+    setup("no_replicas", {});
+    EXPECT_EQ("test://primary", read_host("no_replicas"));
+  }
+
+  TEST_F(ReplicaRouting, balances_reads_over_replicas) {
+    setup("balanced", {"test://replica1", "test://replica2"});
+    EXPECT_EQ("test://replica1", read_host("balanced"));
+    EXPECT_EQ("test://replica2", read_host("balanced"));
+    EXPECT_EQ("test://replica1", read_host("balanced"));
+
+    // A busy replica is skipped in favour of an idle one.
+    auto held = persistence::data_store("balanced").acquire_replica();
+    EXPECT_EQ("test://replica2", held.host());
+    EXPECT_EQ("test://replica1", read_host("balanced"));
+    EXPECT_EQ("test://replica1", read_host("balanced"));
+  }
+
+  TEST_F(ReplicaRouting, reads_stay_on_primary_after_a_write) {
+    setup("sticky", {"test://replica"}, milliseconds(20));
+    EXPECT_EQ("test://replica", read_host("sticky"));
+    current_connection_provider().acquire_connection_for_data_store("sticky");
+    EXPECT_EQ("test://primary", read_host("sticky"));
+    std::this_thread::sleep_for(milliseconds(30));
+    EXPECT_EQ("test://replica", read_host("sticky"));
+  }
+
+  TEST_F(ReplicaRouting, falls_back_to_primary_when_replicas_are_down) {
+    setup("fallback", {"test://replica"});
+    journal().unreachable.insert("test://replica");
+    EXPECT_EQ("test://primary", read_host("fallback"));
+  }
+
+  TEST_F(ReplicaRouting, skips_a_down_replica_until_it_is_due_a_retry) {
+    DataStoreOptions options;
+    options.pool_size = 1;
+    options.replica_urls = {"test://replica"};
+    options.replica_retry_after = milliseconds(20);
+    persistence::setup("backoff", "test://primary", options);
+
+    journal().unreachable.insert("test://replica");
+    EXPECT_EQ("test://primary", read_host("backoff"));
+    size_t attempts = journal().connect_attempts;
+    EXPECT_EQ("test://primary", read_host("backoff"));
+    EXPECT_EQ(attempts, journal().connect_attempts);
+
+    journal().unreachable.clear();
+    std::this_thread::sleep_for(milliseconds(30));
+    EXPECT_EQ("test://replica", read_host("backoff"));
+  }
+
+  TEST_F(ReplicaRouting, default_providers_track_writes_per_provider) {
+    setup("per_provider", {"test://replica"});
+    persistence::DefaultConnectionProvider writer;
+    persistence::DefaultConnectionProvider reader;
+    writer.acquire_connection_for_data_store("per_provider");
+    EXPECT_EQ("test://primary", writer.acquire_read_connection_for_data_store("per_provider").host());
+    EXPECT_EQ("test://replica", reader.acquire_read_connection_for_data_store("per_provider").host());
+  }
+
+  TEST_F(ReplicaRouting, current_provider_is_fiber_local) {
+    setup("fibers", {"test://replica"});
+    persistence::DefaultConnectionProvider first, second;
+    std::string first_read;
+    auto request = wayward::fiber::create([&]() {
+      persistence::with_connection_provider(first, [&]() {
+        current_connection_provider().acquire_connection_for_data_store("fibers");
+        wayward::fiber::yield(); // Parked, e.g. waiting for a connection.
+        first_read = read_host("fibers");
+      });
+    });
+    wayward::fiber::resume(request);
+    persistence::with_connection_provider(second, [&]() {
+      wayward::fiber::resume(request);
+      EXPECT_EQ(&second, &current_connection_provider());
+      EXPECT_EQ("test://replica", read_host("fibers"));
+    });
+    EXPECT_EQ("test://primary", first_read);
+  }
+
+  TEST_F(ReplicaRouting, retainer_tracks_writes_per_retainer) {
+    setup("retained", {"test://replica"});
+    persistence::ConnectionRetainer writer { current_connection_provider(), {"retained"} };
+    persistence::ConnectionRetainer reader { current_connection_provider(), {"retained"} };
+    EXPECT_EQ("test://replica", writer.acquire_read_connection_for_data_store("retained").host());
+    writer.acquire_connection_for_data_store("retained");
+    EXPECT_EQ("test://primary", writer.acquire_read_connection_for_data_store("retained").host());
+    EXPECT_EQ("test://replica", reader.acquire_read_connection_for_data_store("retained").host());
+  }
+
+  TEST_F(ReplicaRouting, retainer_reads_from_its_own_connection_when_replicas_are_down) {
+    DataStoreOptions options;
+    options.pool_size = 1;
+    options.replica_urls = {"test://replica"};
+    options.acquire_timeout = milliseconds(50);
+    options.read_your_writes_window = milliseconds(0); // So the read goes looking for a replica.
+    persistence::setup("retained_down", "test://primary", options);
+    journal().unreachable.insert("test://replica");
+
+    persistence::ConnectionRetainer retainer { current_connection_provider(), {"retained_down"} };
+    auto write = retainer.acquire_connection_for_data_store("retained_down");
+    // The only primary connection is the one the retainer holds.
+    auto read = retainer.acquire_read_connection_for_data_store("retained_down");
+    EXPECT_EQ("test://primary", read.host());
+  }
+
+  TEST_F(ReplicaRouting, projections_read_from_replicas) {
+    persistence::setup("test://primary", [] {
+      DataStoreOptions options;
+      options.replica_urls = {"test://replica"};
+      return options;
+    }());
+    auto& results = *adapter_registrar_.adapter_.result_set_;
+    results.columns_ = {"foos_id", "foos_string_value", "id"};
+    results.rows_.push_back({std::string{"1"}, std::string{"Hello"}, std::string{"1"}});
+
+    Context context;
+    persistence::from<Foo>(context).all();
+    auto foo = context.create<Foo>();
+    foo->string_value = "World";
+    persistence::insert(foo);
+    persistence::from<Foo>(context).all();
+
+    ASSERT_EQ(3, journal().executed_on.size());
+    EXPECT_EQ("test://replica", journal().executed_on[0]);
+    EXPECT_EQ("test://primary", journal().executed_on[1]);
+    EXPECT_EQ("test://primary", journal().executed_on[2]);
+  }
+}
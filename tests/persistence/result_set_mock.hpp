@@ -18,9 +18,13 @@ namespace persistence {
       std::vector<std::string> columns() const { return columns_; }
       bool is_null_at(size_t idx, const std::string& col) const;
       Maybe<std::string> get(size_t idx, const std::string& col) const;
+      size_t affected_rows() const { return affected_rows_; }
+      Maybe<size_t> column_index(const std::string& col) const;
+      const char* get_raw(size_t row, size_t col, size_t& length) const;
 
       std::vector<std::string> columns_;
       std::vector<std::vector<Maybe<std::string>>> rows_;
+      size_t affected_rows_ = 0;
 
       Maybe<std::string> value_at(size_t idx, const std::string& col) const;
     };
@@ -35,6 +39,20 @@ namespace persistence {
       return row[c];
     }
 
+    inline Maybe<size_t> ResultSetMock::column_index(const std::string& col) const {
+      auto it = std::find(columns_.begin(), columns_.end(), col);
+      if (it == columns_.end()) return Nothing;
+      return size_t(it - columns_.begin());
+    }
+
+    inline const char* ResultSetMock::get_raw(size_t row, size_t col, size_t& length) const {
+      if (row >= height() || col >= rows_[row].size()) return nullptr;
+      auto& m = rows_[row][col];
+      if (!m) return nullptr;
+      length = m->size();
+      return m->c_str();
+    }
+
     inline bool ResultSetMock::is_null_at(size_t idx, const std::string& col) const {
       auto m = value_at(idx, col);
       return !m;
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+
+#include <persistence/record.hpp>
+#include <persistence/datetime.hpp>
+#include <persistence/data_store.hpp>
+#include <persistence/primary_key.hpp>
+#include <persistence/projection.hpp>
+#include <persistence/persistence_macro.hpp>
+
+#include "connection_mock.hpp"
+#include "adapter_mock.hpp"
+
+namespace {
+  using persistence::PrimaryKey;
+  using persistence::Context;
+  using wayward::DateTime;
+  using wayward::Maybe;
+  using wayward::Nothing;
+
+  using namespace persistence::test;
+
+  struct Foo {
+    PrimaryKey id;
+    int integer_value = -1;
+    std::string string_value;
+    Maybe<std::string> nullable_string_value;
+  };
+
+  PERSISTENCE(Foo) {
+    property(&Foo::id, "id");
+    property(&Foo::integer_value, "integer_value");
+    property(&Foo::string_value, "string_value");
+    property(&Foo::nullable_string_value, "nullable_string_value");
+  }
+
+  struct UpdateTest : ::testing::Test {
+    persistence::AdapterRegistrar<AdapterMock> adapter_registrar_ = "test";
+    Context context;
+
+    persistence::test::ResultSetMock& results() {
+      return *adapter_registrar_.adapter_.result_set_;
+    }
+
+    persistence::test::ConnectionJournalMock& journal() {
+      return *adapter_registrar_.adapter_.journal_;
+    }
+
+    void SetUp() override {
+      persistence::setup("test://test");
+      results().columns_ = {"foos_id", "foos_integer_value", "foos_string_value", "foos_nullable_string_value"};
+      results().rows_.push_back({std::string{"1"}, std::string{"123"}, std::string{"Hello"}, Nothing});
+    }
+
+    persistence::RecordPtr<Foo> load() {
+      auto record = persistence::from<Foo>(context).first();
+      journal().executed_sql.clear();
+      return record;
+    }
+  };
+
+  TEST_F(UpdateTest, unchanged_record_is_not_written) {
+    auto foo = load();
+    ASSERT_TRUE(foo != nullptr);
+    auto r = persistence::save(foo);
+    EXPECT_TRUE(r.good());
+    EXPECT_EQ(0, journal().executed_sql.size());
+  }
+
+  TEST_F(UpdateTest, only_changed_columns_are_written) {
+    auto foo = load();
+    ASSERT_TRUE(foo != nullptr);
+    foo->string_value = "World";
+    auto r = persistence::save(foo);
+    EXPECT_TRUE(r.good());
+    ASSERT_EQ(1, journal().executed_sql.size());
+    EXPECT_EQ("UPDATE foos SET \"string_value\" = 'World' WHERE \"foos\".\"id\" = 1", journal().executed_sql[0]);
+
+    // The snapshot is refreshed, so saving again is a no-op.
+    r = persistence::save(foo);
+    EXPECT_TRUE(r.good());
+    EXPECT_EQ(1, journal().executed_sql.size());
+  }
+
+  TEST_F(UpdateTest, record_without_snapshot_writes_all_columns) {
+    Foo foo;
+    foo.id = 1;
+    foo.string_value = "World";
+    auto r = persistence::detail::update(foo, persistence::get_type<Foo>(), nullptr, true);
+    EXPECT_TRUE(r.good());
+    ASSERT_EQ(1, journal().executed_sql.size());
+    auto& sql = journal().executed_sql[0];
+    EXPECT_EQ(0, sql.find("UPDATE foos SET \"integer_value\" = -1, \"string_value\" = 'World', \"nullable_string_value\" = NULL"));
+  }
+
+  TEST_F(UpdateTest, failed_update_reports_the_sql_error) {
+    auto foo = load();
+    ASSERT_TRUE(foo != nullptr);
+    foo->string_value = "World";
+    journal().on_execute = [](const std::string&) { throw wayward::Error("value too long for type character varying(3)"); };
+    auto r = persistence::save(foo);
+    journal().on_execute = nullptr;
+    ASSERT_FALSE(r.good());
+    EXPECT_NE(std::string::npos, std::string{r.error()->what()}.find("value too long"));
+
+    // The snapshot wasn't refreshed, so the change is written on the next save.
+    r = persistence::save(foo);
+    EXPECT_TRUE(r.good());
+    EXPECT_EQ("UPDATE foos SET \"string_value\" = 'World' WHERE \"foos\".\"id\" = 1", journal().executed_sql.back());
+  }
+
+  TEST_F(UpdateTest, maybes_are_compared_by_value) {
+    auto foo = load();
+    ASSERT_TRUE(foo != nullptr);
+    foo->nullable_string_value = std::string{"x"};
+    foo->nullable_string_value = Nothing;
+    foo->integer_value = 123;
+    EXPECT_TRUE(persistence::save(foo).good());
+    EXPECT_EQ(0, journal().executed_sql.size());
+
+    foo->nullable_string_value = std::string{"x"};
+    EXPECT_TRUE(persistence::save(foo).good());
+    ASSERT_EQ(1, journal().executed_sql.size());
+    EXPECT_EQ("UPDATE foos SET \"nullable_string_value\" = 'x' WHERE \"foos\".\"id\" = 1", journal().executed_sql[0]);
+  }
+}
@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+#include <wayward/support/access_log.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+
+#include <dirent.h>
+#include <unistd.h>
+
+namespace {
+  using wayward::AccessLogEntry;
+  using wayward::AccessLogError;
+  using wayward::AccessLogOptions;
+  using wayward::AccessLogWriter;
+  using wayward::DateTime;
+  using wayward::read_access_log_segment;
+
+  struct TemporaryDirectory {
+    std::string path;
+
+    TemporaryDirectory() {
+      char name[] = "/tmp/wayward_access_log_XXXXXX";
+      path = ::mkdtemp(name);
+    }
+
+    ~TemporaryDirectory() {
+      for (auto& file: files()) {
+        ::unlink(file.c_str());
+      }
+      ::rmdir(path.c_str());
+    }
+
+    std::vector<std::string> files() const {
+      std::vector<std::string> result;
+      DIR* dir = ::opendir(path.c_str());
+      while (struct dirent* e = ::readdir(dir)) {
+        std::string name = e->d_name;
+        if (name != "." && name != "..") {
+          result.push_back(path + "/" + name);
+        }
+      }
+      ::closedir(dir);
+      std::sort(result.begin(), result.end());
+      return result;
+    }
+  };
+
+  AccessLogEntry make_entry(std::string path, int status = 200) {
+    AccessLogEntry entry;
+    entry.timestamp = DateTime::at(2015, 3, 4, 12, 30, 15, 250);
+    entry.method = "GET";
+    entry.path = std::move(path);
+    entry.status = status;
+    entry.latency_us = 1234;
+    entry.bytes = 512;
+    return entry;
+  }
+
+  TEST(AccessLog, writes_and_reads_entries) {
+    TemporaryDirectory dir;
+    AccessLogOptions options;
+    options.directory = dir.path;
+    AccessLogWriter writer {options};
+    writer.write(make_entry("/"));
+    writer.write(make_entry("/missing", 404));
+
+    auto entries = read_access_log_segment(writer.current_segment());
+    ASSERT_EQ(2, entries.size());
+    EXPECT_EQ(make_entry("/").timestamp, entries[0].timestamp);
+    EXPECT_EQ("GET", entries[0].method);
+    EXPECT_EQ("/", entries[0].path);
+    EXPECT_EQ(200, entries[0].status);
+    EXPECT_EQ(1234, entries[0].latency_us);
+    EXPECT_EQ(512, entries[0].bytes);
+    EXPECT_EQ("/missing", entries[1].path);
+    EXPECT_EQ(404, entries[1].status);
+  }
+
+  TEST(AccessLog, truncates_segments_when_closed) {
+    TemporaryDirectory dir;
+    AccessLogOptions options;
+    options.directory = dir.path;
+    std::string segment;
+    {
+      AccessLogWriter writer {options};
+      writer.write(make_entry("/"));
+      segment = writer.current_segment();
+    }
+    FILE* f = std::fopen(segment.c_str(), "rb");
+    std::fseek(f, 0, SEEK_END);
+    EXPECT_LT(std::ftell(f), 128);
+    std::fclose(f);
+    EXPECT_EQ(1, read_access_log_segment(segment).size());
+  }
+
+  TEST(AccessLog, rotates_full_segments) {
+    TemporaryDirectory dir;
+    AccessLogOptions options;
+    options.directory = dir.path;
+    options.segment_size = 0; // Rounded up to the smallest size that fits one entry.
+    AccessLogWriter writer {options};
+    std::string long_path(60000, 'x');
+    for (int i = 0; i < 6; ++i) {
+      writer.write(make_entry(long_path));
+    }
+    auto files = dir.files();
+    EXPECT_EQ(3, files.size());
+    size_t total = 0;
+    for (auto& file: files) {
+      total += read_access_log_segment(file).size();
+    }
+    EXPECT_EQ(6, total);
+  }
+
+  TEST(AccessLog, writers_sharing_a_directory_get_their_own_segments) {
+    TemporaryDirectory dir;
+    AccessLogOptions options;
+    options.directory = dir.path;
+    AccessLogWriter a {options};
+    AccessLogWriter b {options};
+    EXPECT_NE(a.current_segment(), b.current_segment());
+    a.write(make_entry("/a"));
+    b.write(make_entry("/b"));
+    EXPECT_EQ(1, read_access_log_segment(a.current_segment()).size());
+    EXPECT_EQ(1, read_access_log_segment(b.current_segment()).size());
+  }
+
+  TEST(AccessLog, reports_segments_that_dont_fit_on_disk) {
+    TemporaryDirectory dir;
+    AccessLogOptions options;
+    options.directory = dir.path;
+    options.segment_size = size_t(1) << 50;
+    EXPECT_THROW(AccessLogWriter{options}, AccessLogError);
+    EXPECT_EQ(0, dir.files().size());
+  }
+
+  TEST(AccessLog, rotates_old_segments) {
+    TemporaryDirectory dir;
+    AccessLogOptions options;
+    options.directory = dir.path;
+    options.rotate_after = std::chrono::seconds(1);
+    AccessLogWriter writer {options};
+    writer.write(make_entry("/a"));
+    auto first = writer.current_segment();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    writer.write(make_entry("/b"));
+    EXPECT_NE(first, writer.current_segment());
+    EXPECT_EQ(2, dir.files().size());
+  }
+
+  TEST(AccessLog, keeps_entries_from_concurrent_writers) {
+    TemporaryDirectory dir;
+    AccessLogOptions options;
+    options.directory = dir.path;
+    AccessLogWriter writer {options};
+    // Built up front: DateTime::at goes through mktime, which isn't safe to call from several threads.
+    std::vector<AccessLogEntry> entries_by_thread;
+    for (int t = 0; t < 4; ++t) {
+      entries_by_thread.push_back(make_entry("/" + std::to_string(t), 200 + t));
+    }
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&, t]() {
+        for (int i = 0; i < 1000; ++i) {
+          writer.write(entries_by_thread[t]);
+        }
+      });
+    }
+    for (auto& thread: threads) {
+      thread.join();
+    }
+    auto entries = read_access_log_segment(writer.current_segment());
+    ASSERT_EQ(4000, entries.size());
+    for (auto& entry: entries) {
+      EXPECT_EQ("/" + std::to_string(entry.status - 200), entry.path);
+    }
+  }
+
+  TEST(AccessLog, rejects_other_files) {
+    TemporaryDirectory dir;
+    std::string path = dir.path + "/not_a_log";
+    FILE* f = std::fopen(path.c_str(), "wb");
+    std::fputs("hello, world", f);
+    std::fclose(f);
+    EXPECT_THROW(read_access_log_segment(path), AccessLogError);
+  }
+
+  TEST(AccessLog, formats_entries_as_text_and_json) {
+    auto entry = make_entry("/say \"hi\"");
+    EXPECT_EQ("[2015-03-04 12:30:15.250000] GET /say \"hi\" 200 1234us 512B", wayward::access_log_entry_as_text(entry));
+    EXPECT_EQ("{\"timestamp\":\"2015-03-04 12:30:15.250000\",\"method\":\"GET\",\"path\":\"\\/say \\\"hi\\\"\",\"status\":200,\"latency_us\":1234,\"bytes\":512}", wayward::access_log_entry_as_json(entry));
+  }
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <wayward/support/async_logger.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+  using wayward::AsyncLogger;
+  using wayward::ILogger;
+  using wayward::Severity;
+
+  struct RecordingLogger : ILogger {
+    std::mutex mutex;
+    std::vector<std::string> messages;
+    std::vector<std::thread::id> threads;
+    Severity level_ = Severity::Debug;
+
+    // When set, log() blocks until released.
+    bool blocked = false;
+    std::condition_variable unblocked;
+
+    void log(Severity severity, std::string tag, std::string message) override {
+      std::unique_lock<std::mutex> lock(mutex);
+      unblocked.wait(lock, [&]() { return !blocked; });
+      messages.push_back(tag + ": " + message);
+      threads.push_back(std::this_thread::get_id());
+    }
+
+    Severity level() const override { return level_; }
+    void set_level(Severity l) override { level_ = l; }
+
+    void release() {
+      std::lock_guard<std::mutex> lock(mutex);
+      blocked = false;
+      unblocked.notify_all();
+    }
+  };
+
+  TEST(AsyncLogger, passes_messages_on_from_another_thread) {
+    auto recorder = std::make_shared<RecordingLogger>();
+    AsyncLogger logger {recorder};
+    logger.log(Severity::Information, "a", "one");
+    logger.log(Severity::Warning, "b", "two");
+    logger.flush();
+
+    ASSERT_EQ(2, recorder->messages.size());
+    EXPECT_EQ("a: one", recorder->messages[0]);
+    EXPECT_EQ("b: two", recorder->messages[1]);
+    EXPECT_NE(std::this_thread::get_id(), recorder->threads[0]);
+  }
+
+  TEST(AsyncLogger, respects_the_level_of_the_downstream_logger) {
+    auto recorder = std::make_shared<RecordingLogger>();
+    AsyncLogger logger {recorder};
+    logger.set_level(Severity::Warning);
+    EXPECT_EQ(Severity::Warning, recorder->level());
+    logger.log(Severity::Debug, "a", "ignored");
+    logger.log(Severity::Error, "a", "kept");
+    logger.flush();
+    ASSERT_EQ(1, recorder->messages.size());
+    EXPECT_EQ("a: kept", recorder->messages[0]);
+  }
+
+  TEST(AsyncLogger, keeps_per_thread_order) {
+    auto recorder = std::make_shared<RecordingLogger>();
+    AsyncLogger logger {recorder, 64};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&, t]() {
+        for (int i = 0; i < 1000; ++i) {
+          logger.log(Severity::Debug, std::to_string(t), std::to_string(i));
+          if (i % 32 == 0) {
+            logger.flush();
+          }
+        }
+      });
+    }
+    for (auto& thread: threads) {
+      thread.join();
+    }
+    logger.flush();
+
+    std::vector<int> last(4, -1);
+    size_t received = 0;
+    for (auto& message: recorder->messages) {
+      if (message.compare(0, 4, "log:") == 0) {
+        continue;
+      }
+      int t = message[0] - '0';
+      int i = std::stoi(message.substr(3));
+      EXPECT_GT(i, last[t]);
+      last[t] = i;
+      ++received;
+    }
+    EXPECT_EQ(4 * 1000 - logger.dropped(), received);
+  }
+
+  TEST(AsyncLogger, drops_and_reports_messages_when_full) {
+    auto recorder = std::make_shared<RecordingLogger>();
+    recorder->blocked = true;
+    AsyncLogger logger {recorder, 4};
+    for (int i = 0; i < 20; ++i) {
+      logger.log(Severity::Debug, "a", std::to_string(i));
+    }
+    // The background thread holds at most one message while blocked.
+    EXPECT_GE(logger.dropped(), 20 - 4 - 1);
+
+    recorder->release();
+    logger.flush();
+    auto dropped = logger.dropped();
+    EXPECT_EQ(20 - dropped, recorder->messages.size() - 1);
+    auto warning = "log: Dropped " + std::to_string(dropped) + " log messages because the log buffer was full.";
+    EXPECT_NE(recorder->messages.end(), std::find(recorder->messages.begin(), recorder->messages.end(), warning));
+  }
+}
@@ -182,4 +182,132 @@ namespace {
       EXPECT_EQ(numbers[i], n);
     }
   }
+  TEST(Object, copies_share_storage_until_modified) {
+    Object a = Object::dictionary();
+    a["x"] = 1;
+    a["list"].push_back(Object{"one"});
+    Object b = a;
+    b["x"] = 2;
+    b["list"].push_back(Object{"two"});
+    Integer n;
+    EXPECT_EQ(true, a["x"] >> n);
+    EXPECT_EQ(1, n);
+    EXPECT_EQ(1, a["list"].length());
+    EXPECT_EQ(true, b["x"] >> n);
+    EXPECT_EQ(2, n);
+    EXPECT_EQ(2, b["list"].length());
+  }
+
+  TEST(Object, references_taken_before_a_copy_dont_alias_it) {
+    Object a = Object::dictionary();
+    Object& x = a["x"];
+    x = 1;
+    Object b = a;
+    x = 2;
+    Integer n;
+    EXPECT_EQ(true, a["x"] >> n);
+    EXPECT_EQ(2, n);
+    EXPECT_EQ(true, b["x"] >> n);
+    EXPECT_EQ(1, n);
+
+    Object list = Object::list({Object{1}});
+    Object& first = list[size_t(0)];
+    Object c;
+    c = list;
+    first = 3;
+    EXPECT_EQ(true, c[size_t(0)] >> n);
+    EXPECT_EQ(1, n);
+  }
+
+  TEST(Object, keeps_dictionary_keys_sorted) {
+    Object o;
+    o["c"] = 3;
+    o["a"] = 1;
+    o["b"] = 2;
+    o.erase("c");
+    std::vector<std::string> keys;
+    Spectator s {o};
+    for (auto it = s.begin(); it != s.end(); ++it) {
+      keys.push_back(*it.key());
+    }
+    EXPECT_EQ((std::vector<std::string>{"a", "b"}), keys);
+    EXPECT_EQ(true, o.has_key("a"));
+    EXPECT_EQ(false, o.has_key("c"));
+  }
+
+  TEST(Object, builds_dictionaries_from_entries) {
+    std::vector<std::pair<String, Object>> entries;
+    entries.emplace_back("b", Object{1});
+    entries.emplace_back("a", Object{2});
+    entries.emplace_back("b", Object{3});
+    const Object o = Object::dictionary(std::move(entries));
+    EXPECT_EQ(2, o.length());
+    Integer n;
+    EXPECT_EQ(true, o["b"] >> n);
+    EXPECT_EQ(3, n);
+  }
+
+  // Collects "key=value" (or just "value" for lists) for each scalar child, via either traversal.
+  std::vector<std::string> visited(const Spectator& s) {
+    std::vector<std::string> result;
+    visit_children(s.reader_iface(), [&](const String* key, const IReader& value) {
+      String str = "null";
+      ScalarSpectator{value} >> str;
+      result.push_back(key ? *key + "=" + str : str);
+    });
+    return result;
+  }
+
+  std::vector<std::string> enumerated(const Spectator& s) {
+    std::vector<std::string> result;
+    for (auto it = s.begin(); it != s.end(); ++it) {
+      String str = "null";
+      *it >> str;
+      auto key = it.key();
+      result.push_back(key ? *key + "=" + str : str);
+    }
+    return result;
+  }
+
+  TEST(Spectator, visits_vectors_and_maps) {
+    std::vector<int> v {1, 2, 3};
+    std::map<std::string, std::string> m {{"a", "x"}, {"b", "y"}};
+    EXPECT_EQ((std::vector<std::string>{"1", "2", "3"}), visited(Spectator{v}));
+    EXPECT_EQ((std::vector<std::string>{"a=x", "b=y"}), visited(Spectator{m}));
+    EXPECT_EQ(enumerated(Spectator{m}), visited(Spectator{m}));
+  }
+
+  TEST(Spectator, visits_maybes) {
+    wayward::Maybe<std::vector<int>> some = std::vector<int>{4, 5};
+    wayward::Maybe<std::vector<int>> none;
+    EXPECT_EQ((std::vector<std::string>{"4", "5"}), visited(Spectator{some}));
+    EXPECT_EQ(std::vector<std::string>{}, visited(Spectator{none}));
+  }
+
+  TEST(Spectator, visits_objects) {
+    Object list = Object::list();
+    list.push_back(1);
+    list.push_back("two");
+    list.push_back(Object{});
+    Object dict = Object::dictionary();
+    dict["b"] = 2;
+    dict["a"] = 1;
+    EXPECT_EQ((std::vector<std::string>{"1", "two", "null"}), visited(Spectator{list}));
+    EXPECT_EQ((std::vector<std::string>{"a=1", "b=2"}), visited(Spectator{dict}));
+    EXPECT_EQ(enumerated(Spectator{dict}), visited(Spectator{dict}));
+  }
+
+  // Implements only the enumerator, to exercise the default IReader::visit_children().
+  struct EnumeratedMapReader : AdapterBase<std::map<String, int>> {
+    Adapter<std::map<String, int>> inner_;
+    EnumeratedMapReader(std::map<String, int>& ref) : AdapterBase<std::map<String, int>>(ref, Options::None), inner_(ref, Options::None) {}
+    DataType type() const final { return DataType::Dictionary; }
+    ReaderEnumeratorPtr enumerator() const final { return inner_.enumerator(); }
+  };
+
+  TEST(Spectator, visits_enumerated_readers) {
+    std::map<String, int> m {{"a", 1}, {"b", 2}};
+    Spectator s {ReaderPtr{new EnumeratedMapReader{m}}};
+    EXPECT_EQ((std::vector<std::string>{"a=1", "b=2"}), visited(s));
+  }
 }
@@ -58,4 +58,24 @@ namespace {
     fiber::terminate(f);
     EXPECT_EQ(123, number);
   }
+
+  TEST(Fiber, keeps_locals_per_fiber) {
+    static const char key = 0;
+    int outer = 1, inner = 2;
+    fiber::set_local(&key, &outer);
+    void* seen_in_fiber = &outer;
+    auto f = fiber::create([&]() {
+      seen_in_fiber = fiber::get_local(&key);
+      fiber::set_local(&key, &inner);
+      fiber::yield();
+      seen_in_fiber = fiber::get_local(&key);
+    });
+    fiber::resume(f);
+    EXPECT_EQ(nullptr, seen_in_fiber);
+    EXPECT_EQ(&outer, fiber::get_local(&key));
+    fiber::resume(f);
+    EXPECT_EQ(&inner, seen_in_fiber);
+    fiber::set_local(&key, nullptr);
+    EXPECT_EQ(nullptr, fiber::get_local(&key));
+  }
 }
@@ -53,5 +53,32 @@ namespace {
     EXPECT_EQ(a, "{b}");
   }
 
+  TEST(format_with_index, interpolates_numbers) {
+    auto a = format("{0} + {1} = {2}", 1, 2.5, 3.5f);
+    EXPECT_EQ(a, "1 + 2.5 = 3.5");
+  }
+
+  struct Hexed { int value; };
+  std::ostream& operator<<(std::ostream& os, const Hexed& h) {
+    return os << std::hex << h.value << " " << format("({0})", 10);
+  }
+
+  TEST(format_with_index, allows_nested_format_and_resets_stream_state) {
+    auto a = format("{0}!", Hexed{255});
+    EXPECT_EQ(a, "ff (10)!");
+    EXPECT_EQ(format("{0}", 255), "255");
+  }
+
+  TEST(format_with_format_string, interpolates_indexed) {
+    static const wayward::FormatString fmt {"{1}, {0}! {2} {0a}"};
+    EXPECT_EQ(format(fmt, "World", "Hello"), "Hello, World! {2} {0a}");
+    EXPECT_EQ(format(fmt, 1, 2, 3), "2, 1! 3 {0a}");
+  }
+
+  TEST(format_with_format_string, interpolates_named) {
+    static const wayward::FormatString fmt {"{{greeting}, {entity}!{}"};
+    EXPECT_EQ(format(fmt, {{"greeting", "Hello"}, {"entity", "World"}}), "{Hello, World!{}");
+  }
+
   // TODO: Support number formatting strings, like {0:09.2f} == "%09.2f"
 }
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <wayward/support/json.hpp>
+
+#include <random>
+
+namespace {
+  using wayward::detail::json_escape_implementations;
+
+  // The escaping rules, one character at a time.
+  std::string reference_escape(const std::string& input) {
+    std::string result;
+    for (char c: input) {
+      switch (c) {
+        case '\\': result += "\\\\"; break;
+        case '"':  result += "\\\""; break;
+        case '/':  result += "\\/";  break;
+        case '\b': result += "\\b";  break;
+        case '\f': result += "\\f";  break;
+        case '\n': result += "\\n";  break;
+        case '\r': result += "\\r";  break;
+        case '\t': result += "\\t";  break;
+        default:   result += c;      break;
+      }
+    }
+    return result;
+  }
+
+  void expect_conforms(const std::string& input) {
+    auto expected = reference_escape(input);
+    for (auto& implementation: json_escape_implementations()) {
+      std::string out = "x";
+      implementation.escape(out, input.data(), input.size());
+      EXPECT_EQ("x" + expected, out) << "implementation: " << implementation.name;
+    }
+    EXPECT_EQ(expected, wayward::escape_json(input));
+  }
+
+  TEST(escape_json, has_a_portable_implementation) {
+    auto implementations = json_escape_implementations();
+    ASSERT_LE(1, implementations.size());
+    EXPECT_STREQ("scalar", implementations[0].name);
+  }
+
+  TEST(escape_json, leaves_clean_strings_alone) {
+    expect_conforms("");
+    expect_conforms("a");
+    expect_conforms("The quick brown fox jumps over the lazy dog, several times over and over.");
+    expect_conforms("\xc3\xa6\xc3\xb8\xc3\xa5 \xe2\x82\xac \xf0\x9f\x98\x80"); // UTF-8 passes through
+  }
+
+  TEST(escape_json, escapes_every_byte_at_every_position) {
+    // Covers each byte value at every offset of a 32-byte and 16-byte block, and in the scalar tail.
+    for (int c = 0; c < 256; ++c) {
+      for (size_t length = 1; length <= 70; ++length) {
+        for (size_t pos = 0; pos < length; pos += (length > 40 ? 7 : 1)) {
+          std::string input(length, 'a');
+          input[pos] = char(c);
+          expect_conforms(input);
+        }
+      }
+    }
+  }
+
+  TEST(escape_json, handles_runs_of_special_characters) {
+    expect_conforms(std::string(100, '"'));
+    expect_conforms(std::string(33, '\\') + "x" + std::string(31, '/'));
+    expect_conforms(std::string(64, '\n'));
+  }
+
+  TEST(escape_json, matches_the_reference_on_random_input) {
+    std::mt19937 rng {42};
+    std::uniform_int_distribution<int> length_dist {0, 300};
+    std::uniform_int_distribution<int> byte_dist {0, 255};
+    std::uniform_int_distribution<int> special_dist {0, 9};
+    const char specials[] = "\"\\/\b\f\n\r\t\x01\x7f";
+    for (int i = 0; i < 2000; ++i) {
+      std::string input(length_dist(rng), ' ');
+      for (auto& c: input) {
+        c = special_dist(rng) == 0 ? specials[special_dist(rng)] : char(byte_dist(rng));
+      }
+      expect_conforms(input);
+    }
+  }
+}
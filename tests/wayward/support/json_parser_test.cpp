@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <wayward/support/json.hpp>
+#include <wayward/support/benchmark.hpp>
+
+#include <iostream>
+
+namespace {
+  using wayward::as_json;
+  using wayward::parse_json;
+  using wayward::JSONParseError;
+  using wayward::data_franca::DataType;
+  using wayward::data_franca::Integer;
+  using wayward::data_franca::Real;
+  using wayward::data_franca::String;
+
+  TEST(parse_json, parses_scalars) {
+    EXPECT_EQ(DataType::Nothing, parse_json("null").type());
+    EXPECT_EQ(true, *parse_json("true").get_boolean());
+    EXPECT_EQ(false, *parse_json(" false ").get_boolean());
+    EXPECT_EQ(123, *parse_json("123").get_integer());
+    EXPECT_EQ(-45, *parse_json("-45").get_integer());
+    EXPECT_EQ(0, *parse_json("0").get_integer());
+    EXPECT_DOUBLE_EQ(1.5, *parse_json("1.5").get_real());
+    EXPECT_DOUBLE_EQ(-2.5e-3, *parse_json("-2.5e-3").get_real());
+    EXPECT_DOUBLE_EQ(1e10, *parse_json("1E+10").get_real());
+    EXPECT_EQ("hello", *parse_json("\"hello\"").get_string());
+  }
+
+  TEST(parse_json, parses_integer_limits) {
+    EXPECT_EQ(INT64_MAX, *parse_json("9223372036854775807").get_integer());
+    EXPECT_EQ(INT64_MIN, *parse_json("-9223372036854775808").get_integer());
+    EXPECT_EQ(DataType::Real, parse_json("9223372036854775808").type());
+    EXPECT_DOUBLE_EQ(1e20, *parse_json("100000000000000000000").get_real());
+  }
+
+  TEST(parse_json, decodes_escapes) {
+    EXPECT_EQ("a\"b\\c/d\b\f\n\r\t", *parse_json("\"a\\\"b\\\\c\\/d\\b\\f\\n\\r\\t\"").get_string());
+    EXPECT_EQ("\xc3\xa6", *parse_json("\"\\u00e6\"").get_string());
+    EXPECT_EQ("\xe2\x82\xac", *parse_json("\"\\u20AC\"").get_string());
+    EXPECT_EQ("\xf0\x9f\x98\x80", *parse_json("\"\\ud83d\\ude00\"").get_string());
+    EXPECT_EQ(std::string("a\0b", 3), *parse_json("\"a\\u0000b\"").get_string());
+  }
+
+  TEST(parse_json, parses_long_strings) {
+    // Exercise the vectorized scan with escapes on either side of block boundaries.
+    std::string expected;
+    std::string input = "\"";
+    for (int i = 0; i < 100; ++i) {
+      expected += std::string(i % 37, 'x') + "\"";
+      input += std::string(i % 37, 'x') + "\\\"";
+    }
+    input += "\"";
+    EXPECT_EQ(expected, *parse_json(input).get_string());
+  }
+
+  TEST(parse_json, parses_nested_structures) {
+    const auto o = parse_json(" { \"a\" : [1, 2.5, \"x\", null, true], \"b\": {\"c\": {}}, \"d\": [] } ");
+    ASSERT_EQ(DataType::Dictionary, o.type());
+    EXPECT_EQ(3, o.length());
+    EXPECT_EQ(5, o["a"].length());
+    EXPECT_EQ(1, *o["a"][size_t(0)].get_integer());
+    EXPECT_EQ("x", *o["a"][2].get_string());
+    EXPECT_EQ(DataType::Dictionary, o["b"]["c"].type());
+    EXPECT_EQ(DataType::List, o["d"].type());
+    EXPECT_EQ("{\"a\": [1, 2.5, \"x\", null, true], \"b\": {\"c\": {}}, \"d\": []}", as_json(o));
+  }
+
+  TEST(parse_json, round_trips_serialized_output) {
+    std::string input = "{\"list\": [1, -2, 3.25, \"s\\/t\\\"r\"], \"nested\": {\"empty\": [], \"t\": true}}";
+    EXPECT_EQ(input, as_json(parse_json(input)));
+  }
+
+  TEST(parse_json, rejects_malformed_input) {
+    const char* inputs[] = {
+      "", " ", "{", "[1, 2", "[1,]", "{\"a\" 1}", "{\"a\": 1,}", "{1: 2}", "tru", "nul", "01", "-",
+      "1.", ".5", "1e", "+1", "\"abc", "\"\\x\"", "\"\\u12\"", "\"\\ud800\"", "\"a\nb\"", "1 2", "[] x",
+    };
+    for (auto input: inputs) {
+      EXPECT_THROW(parse_json(input), JSONParseError) << "input: " << input;
+    }
+  }
+
+  TEST(parse_json, reports_the_error_offset) {
+    try {
+      parse_json("[1, 2, x]");
+      FAIL();
+    }
+    catch (const JSONParseError& e) {
+      EXPECT_EQ(7, e.offset);
+    }
+  }
+
+  TEST(parse_json, limits_nesting_depth) {
+    EXPECT_NO_THROW(parse_json(std::string(100, '[') + std::string(100, ']')));
+    EXPECT_THROW(parse_json(std::string(100000, '[') + std::string(100000, ']')), JSONParseError);
+  }
+
+  TEST(parse_json, benchmark_large_payloads) {
+    std::string payload = "[";
+    for (int i = 0; i < 20000; ++i) {
+      if (i) payload += ", ";
+      // Keys in order, so the payload round-trips through the (sorted) dictionary.
+      payload += wayward::format("{\"active\": {0}, \"bio\": \"Lorem ipsum dolor sit amet, \\\"consectetur\\\" adipiscing elit.\\n\", \"id\": {1}, \"name\": \"User number {1}\", \"score\": {2}, \"tags\": [\"a\", \"b\", \"c\"]}", i % 2 ? "true" : "false", i, i * 0.5 + 0.25);
+    }
+    payload += "]";
+
+    wayward::data_franca::Object result;
+    auto elapsed = wayward::Benchmark::measure([&]() {
+      result = parse_json(payload);
+    });
+    ASSERT_EQ(20000, result.length());
+    EXPECT_EQ("User number 19999", *static_cast<const wayward::data_franca::Object&>(result)[19999]["name"].get_string());
+    EXPECT_TRUE(payload == as_json(result));
+
+    double ms = elapsed.microseconds().repr_.count() / 1000.0;
+    std::cout << "Parsed " << payload.size() / 1024 << " KiB in " << ms << " ms (" << (payload.size() / 1048576.0) / (ms / 1000.0) << " MiB/s)\n";
+  }
+}
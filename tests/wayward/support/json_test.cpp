@@ -1,9 +1,12 @@
 #include <gtest/gtest.h>
 #include <wayward/support/json.hpp>
+#include <wayward/support/data_franca/object.hpp>
 
 namespace {
   using wayward::as_json;
   using wayward::JSONMode;
+  using wayward::write_json;
+  using wayward::data_franca::Object;
 
   TEST(json, convert_integer) {
     auto result = as_json(123);
@@ -32,6 +35,58 @@ namespace {
     EXPECT_EQ(result, "{\"a\": 12, \"b\": 34, \"c\": 56}");
   }
 
+  TEST(json, convert_negative_and_extreme_integers) {
+    std::vector<int64_t> numbers {0, -1, INT64_MAX, INT64_MIN};
+    EXPECT_EQ("[0, -1, 9223372036854775807, -9223372036854775808]", as_json(numbers));
+  }
+
+  TEST(json, escapes_control_characters_and_slashes) {
+    EXPECT_EQ("\"a\\\\b\\/c\\n\\t\\r\\b\\f\"", as_json("a\\b/c\n\t\r\b\f"));
+  }
+
+  TEST(json, convert_nested_objects) {
+    Object o = Object::dictionary();
+    o["name"] = "Hello \"World\"";
+    o["list"].push_back(Object{1});
+    o["list"].push_back(Object{true});
+    o["list"].push_back(Object{});
+    o["empty"] = Object::list();
+    EXPECT_EQ("{\"empty\": [], \"list\": [1, true, null], \"name\": \"Hello \\\"World\\\"\"}", as_json(o));
+  }
+
+  TEST(json, convert_human_readable) {
+    Object o = Object::dictionary();
+    o["a"].push_back(Object{1});
+    o["a"].push_back(Object{2});
+    o["b"] = Object::dictionary();
+    EXPECT_EQ("{\n  \"a\": [\n    1,\n    2\n  ],\n  \"b\": {}\n}", as_json(o, JSONMode::HumanReadable));
+  }
+
+  TEST(json, write_json_appends_to_the_buffer) {
+    std::string out = "prefix ";
+    std::map<std::string, std::string> map {{"k", "v"}};
+    write_json(out, map);
+    EXPECT_EQ("prefix {\"k\": \"v\"}", out);
+  }
+
+  template <typename T>
+  std::string statically_serialized(const T& value) {
+    std::string out;
+    write_json(out, value);
+    return out;
+  }
+
+  TEST(json, static_serializers_match_adapters) {
+    std::vector<wayward::Maybe<int>> maybes {1, wayward::Nothing, -3};
+    std::map<std::string, std::vector<double>> nested {{"a\"b", {0.5, 1e20}}, {"c", {}}};
+    std::vector<std::string> strings {"x/y", "line\n"};
+    EXPECT_EQ("[1, null, -3]", statically_serialized(maybes));
+    EXPECT_EQ(as_json(maybes), statically_serialized(maybes));
+    EXPECT_EQ(as_json(nested), statically_serialized(nested));
+    EXPECT_EQ(as_json(strings), statically_serialized(strings));
+    EXPECT_EQ("true", statically_serialized(true));
+  }
+
   // TEST(json, does_not_render_lists_with_a_trailing_comma)
   // TEST(json, does_not_render_dictionaries_with_a_trailing_comma)
 }
@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+#include <wayward/support/logger.hpp>
+
+#include <vector>
+
+namespace {
+  using wayward::ILogger;
+  using wayward::Severity;
+
+  struct RecordingLogger : ILogger {
+    std::vector<std::string> messages;
+    Severity level_ = Severity::Information;
+
+    void log(Severity severity, std::string tag, std::string message) override {
+      messages.push_back(tag + ": " + message);
+    }
+    Severity level() const override { return level_; }
+    void set_level(Severity l) override { level_ = l; }
+  };
+
+  TEST(WAYWARD_LOG, skips_building_disabled_messages) {
+    auto logger = std::make_shared<RecordingLogger>();
+    int built = 0;
+    auto build = [&]() { ++built; return std::string("message"); };
+
+    WAYWARD_LOG(logger, Severity::Debug, "t", build());
+    EXPECT_EQ(0, built);
+    EXPECT_EQ(0, logger->messages.size());
+
+    WAYWARD_LOG(logger, Severity::Warning, "t", build());
+    EXPECT_EQ(1, built);
+    ASSERT_EQ(1, logger->messages.size());
+    EXPECT_EQ("t: message", logger->messages[0]);
+  }
+
+  TEST(WAYWARD_LOG, evaluates_the_logger_once) {
+    auto logger = std::make_shared<RecordingLogger>();
+    int evaluated = 0;
+    auto get = [&]() { ++evaluated; return logger; };
+    WAYWARD_LOG(get(), Severity::Error, "t", "m");
+    EXPECT_EQ(1, evaluated);
+    EXPECT_EQ(1, logger->messages.size());
+  }
+}
@@ -0,0 +1,37 @@
+#include <wayward/support/access_log.hpp>
+#include <wayward/support/command_line_options.hpp>
+#include <wayward/support/logger.hpp>
+
+#include <iostream>
+
+namespace w_dev {
+  using namespace wayward;
+
+  int access_log(int argc, char const* const* argv) {
+    bool json = false;
+
+    CommandLineOptions cmd;
+    cmd.description("Print one JSON object per entry instead of text.");
+    cmd.option("--json", "-j", [&]() {
+      json = true;
+    });
+    cmd.usage();
+    auto segments = cmd.parse(argc, argv);
+    if (segments.size() == 0) {
+      cmd.display_usage_and_exit();
+    }
+
+    for (auto& segment: segments) {
+      try {
+        for (auto& entry: read_access_log_segment(segment)) {
+          std::cout << (json ? access_log_entry_as_json(entry) : access_log_entry_as_text(entry)) << '\n';
+        }
+      }
+      catch (const AccessLogError& error) {
+        ConsoleStreamLogger::get()->log(Severity::Error, "access-log", error.what());
+        return 1;
+      }
+    }
+    return 0;
+  }
+}
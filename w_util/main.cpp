@@ -8,6 +8,7 @@ namespace w_dev {
   int server(int argc, char const* const* argv);
   int init(int argc, char const* const* argv);
   int generate(int argc, char const* const* argv);
+  int access_log(int argc, char const* const* argv);
 
   void usage(const char* program_name) {
     std::cerr << wayward::format("Usage:\n\t{0} [command]\n\n", program_name);
@@ -15,6 +16,7 @@ namespace w_dev {
     std::cerr << "\tserver [app]      Start a development server for binary 'app'. (Shorthand: s)\n";
     std::cerr << "\tnew [dir]         Create a new Wayward app in 'dir'.\n";
     std::cerr << "\tgenerate [thing]  Generate something in the current app dir. (Shorthand: g)\n";
+    std::cerr << "\taccess-log [files]  Print the entries of binary access log segments.\n";
     std::exit(1);
   }
 }
@@ -36,6 +38,9 @@ int main(int argc, char const *argv[])
   if (cmd == "help" || cmd == "--help" || cmd == "-h") {
     w_dev::usage(argv[0]);
   } else
+  if (cmd == "access-log") {
+    return w_dev::access_log(argc - 1, argv + 1);
+  } else
   if (cmd == "generate" || cmd == "g") {
     // TODO!
     // return w_dev::generate(argc - 1, argv + 1);
@@ -3,6 +3,8 @@
 #include <wayward/support/command_line_options.hpp>
 #include <wayward/support/event_loop.hpp>
 #include <wayward/support/plugin.hpp>
+#include <wayward/support/async_logger.hpp>
+#include <wayward/support/access_log.hpp>
 
 #include <cxxabi.h>
 #include <unistd.h>
@@ -52,6 +54,7 @@ namespace wayward {
     int port = 3000;
     std::string environment = "development";
     Maybe<int> socket_from_parent_process;
+    std::unique_ptr<AccessLogWriter> access_log;
 
     Handler handler_for_path(std::string path, std::function<Response(Request&)> callback) {
       Handler handler;
@@ -156,7 +159,7 @@ namespace wayward {
       if (h) {
         try {
           if (app->config.log_requests) {
-            log::debug("w", wayward::format("Parameters: {0}", as_json(req.params, JSONMode::Compact)));
+            W_LOG(Debug, "w", wayward::format("Parameters: {0}", as_json(req.params, JSONMode::Compact)));
           }
           return h->handler(req);
         }
@@ -176,7 +179,8 @@ namespace wayward {
 
       if (app->config.log_requests) {
         std::cout << "\n";
-        log::debug("w", wayward::format("Starting {0} {1}...", req.method, req.uri.path));
+        static const FormatString starting {"Starting {0} {1}..."};
+        W_LOG(Debug, "w", wayward::format(starting, req.method, req.uri.path));
       }
 
       Maybe<Response> response = Nothing;
@@ -196,7 +200,24 @@ namespace wayward {
         auto time_elapsed = t1 - t0;
         double us = time_elapsed.microseconds().repr_.count();
         double ms = us / 1000.0;
-        log::info("w", wayward::format("Finished {0} {1} with {2} in {3} ms", req.method, req.uri.path, (int)response->code, ms));
+        static const FormatString finished {"Finished {0} {1} with {2} in {3} ms"};
+        W_LOG(Information, "w", wayward::format(finished, req.method, req.uri.path, (int)response->code, ms));
+      }
+
+      if (access_log) {
+        AccessLogEntry entry;
+        entry.timestamp = t0;
+        entry.method = req.method;
+        entry.path = req.uri.path;
+        entry.status = (int)response->code;
+        entry.latency_us = (t1 - t0).microseconds().repr_.count();
+        entry.bytes = response->body.size();
+        try {
+          access_log->write(entry);
+        }
+        catch (const AccessLogError& error) {
+          W_LOG(Error, "w", error.what());
+        }
       }
 
       return std::move(*response);
@@ -252,6 +273,20 @@ namespace wayward {
       }
     });
 
+    cmd.description("Write a binary access log to segment files in this directory.");
+    cmd.option("--access-log-dir", [&](const std::string& directory) {
+      config.access_log_directory = directory;
+    });
+
+    cmd.description("Write log messages from a background thread (values: on, off).");
+    cmd.option("--async-log", [&](std::string option) {
+      if (option == "on") {
+        config.async_logging = true;
+      } else if (option == "off") {
+        config.async_logging = false;
+      }
+    });
+
     cmd.usage("--help", "-h");
     cmd.parse(argc, argv);
 
@@ -276,6 +311,16 @@ namespace wayward {
   }
 
   int App::run() {
+    if (config.async_logging) {
+      set_logger(make_logger<AsyncLogger>(logger()));
+    }
+
+    if (!config.access_log_directory.empty()) {
+      AccessLogOptions options;
+      options.directory = config.access_log_directory;
+      priv->access_log = std::unique_ptr<AccessLogWriter>(new AccessLogWriter(std::move(options)));
+    }
+
     std::unique_ptr<HTTPServer> server;
     std::function<Response(Request)> handler = std::bind(&App::request, this, std::placeholders::_1);
     if (priv->socket_from_parent_process) {
@@ -11,7 +11,7 @@ namespace wayward {
     }
   }
 
-  std::shared_ptr<ILogger> logger() {
+  const std::shared_ptr<ILogger>& logger() {
     if (g_current_logger == nullptr) {
       g_current_logger = create_default_logger();
     }
@@ -13,7 +13,7 @@ namespace wayward {
   Response render_json(T&& object) {
     Response response;
     response.headers["Content-Type"] = "application/json; charset=utf-8";
-    response.body = as_json(std::forward<T>(object));
+    write_json(response.body, std::forward<T>(object));
     return std::move(response);
   }
 
@@ -8,6 +8,7 @@
 #include <persistence/create.hpp>
 #include <persistence/destroy.hpp>
 #include <persistence/projection.hpp>
+#include <persistence/connection_provider.hpp>
 
 namespace wayward {
   struct Routes {
@@ -20,6 +21,15 @@ namespace wayward {
 
     persistence::Context persistence_context;
 
+    // Reads that follow a write in the same request stay on the primary, whatever the other requests do.
+    persistence::DefaultConnectionProvider connection_provider;
+
+    Response handle(Request& req, std::function<Response(Request&)> handler) {
+      Response response;
+      persistence::with_connection_provider(connection_provider, [&]() { response = handler(req); });
+      return response;
+    }
+
     template <typename Type>
     persistence::Projection<Type> from() {
       return persistence::from<Type>(persistence_context);
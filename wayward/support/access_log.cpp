@@ -0,0 +1,250 @@
+#include <wayward/support/access_log.hpp>
+#include <wayward/support/json.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace wayward {
+  namespace {
+    /*
+      Segment layout (native byte order):
+
+      Header:  "WACCESS1" | u32 version | u32 header size
+      Entries: u32 size | u16 status | u16 method length | i64 timestamp (ns since epoch)
+               | u64 latency (us) | u64 bytes | u16 path length | u16 reserved | method | path
+               | padding to a multiple of 8
+
+      The size of an entry is stored last, so a size of zero marks the end of what has been written.
+    */
+    const char Magic[8] = {'W', 'A', 'C', 'C', 'E', 'S', 'S', '1'};
+    const uint32_t Version = 1;
+    const size_t HeaderSize = 16;
+    const size_t EntryFixedSize = 36;
+    const size_t MaxStringSize = 0xffff;
+
+    size_t padded(size_t n) {
+      return (n + 7) & ~size_t(7);
+    }
+
+    template <typename T>
+    void put(char* p, size_t offset, T value) {
+      std::memcpy(p + offset, &value, sizeof(T));
+    }
+
+    template <typename T>
+    T get(const char* p, size_t offset) {
+      T value;
+      std::memcpy(&value, p + offset, sizeof(T));
+      return value;
+    }
+
+    std::string system_error(const std::string& what, const std::string& path, int error = errno) {
+      return wayward::format("{0} '{1}': {2}", what, path, std::strerror(error));
+    }
+
+    // Actually allocates the blocks, so a full disk is reported here instead of as SIGBUS on a write through the mapping.
+    int preallocate(int fd, size_t size) {
+    #if defined(__APPLE__)
+      fstore_t store = {F_ALLOCATEALL, F_PEOFPOSMODE, 0, (off_t)size, 0};
+      if (::fcntl(fd, F_PREALLOCATE, &store) == -1) {
+        return errno;
+      }
+      return ::ftruncate(fd, size) == 0 ? 0 : errno;
+    #else
+      return ::posix_fallocate(fd, 0, size);
+    #endif
+    }
+
+    struct Segment {
+      std::string path;
+      int fd = -1;
+      char* data = nullptr;
+      size_t capacity = 0;
+      size_t used = 0; // Guarded by AccessLogWriter::Impl::mutex.
+      std::chrono::steady_clock::time_point opened;
+
+      // Takes ownership of fd, a newly created file.
+      Segment(std::string p, int file, size_t size) : path(std::move(p)), fd(file), capacity(size), opened(std::chrono::steady_clock::now()) {
+        int error = preallocate(fd, capacity);
+        if (error != 0) {
+          auto message = system_error("Could not allocate access log segment", path, error);
+          ::close(fd);
+          ::unlink(path.c_str());
+          throw AccessLogError{message};
+        }
+        void* mapping = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+          auto message = system_error("Could not map access log segment", path);
+          ::close(fd);
+          throw AccessLogError{message};
+        }
+        data = static_cast<char*>(mapping);
+        std::memcpy(data, Magic, sizeof(Magic));
+        put<uint32_t>(data, 8, Version);
+        put<uint32_t>(data, 12, HeaderSize);
+        used = HeaderSize;
+      }
+
+      // Runs when the last writer using the segment is done with it.
+      ~Segment() {
+        ::munmap(data, capacity);
+        // Don't leave the unused tail of the segment on disk.
+        if (::ftruncate(fd, used) != 0) {}
+        ::close(fd);
+      }
+    };
+  }
+
+  struct AccessLogWriter::Impl {
+    AccessLogOptions options;
+    mutable std::mutex mutex;
+    std::shared_ptr<Segment> current;
+    uint64_t sequence = 0;
+
+    void rotate() {
+      auto time = DateTime::now().strftime("%Y%m%d-%H%M%S");
+      while (true) {
+        // The pid keeps processes sharing a directory apart, and another writer in this process moves us along to the next sequence number.
+        auto name = wayward::format("{0}/{1}-{2}-{3}-{4}.wlog", options.directory, options.prefix, time, ::getpid(), sequence++);
+        int fd = ::open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd < 0 && errno == EEXIST) {
+          continue;
+        }
+        if (fd < 0) {
+          throw AccessLogError{system_error("Could not create access log segment", name)};
+        }
+        current = std::make_shared<Segment>(std::move(name), fd, options.segment_size);
+        return;
+      }
+    }
+
+    bool needs_rotation(size_t entry_size) const {
+      if (current->used + entry_size > current->capacity) {
+        return true;
+      }
+      return options.rotate_after.count() != 0 && std::chrono::steady_clock::now() - current->opened >= options.rotate_after;
+    }
+  };
+
+  AccessLogWriter::AccessLogWriter(AccessLogOptions options) : impl(new Impl) {
+    // Every segment must have room for at least one entry with maximum-length strings.
+    options.segment_size = std::max(options.segment_size, HeaderSize + padded(EntryFixedSize + 2 * MaxStringSize));
+    impl->options = std::move(options);
+    impl->rotate();
+  }
+
+  AccessLogWriter::~AccessLogWriter() {}
+
+  void AccessLogWriter::write(const AccessLogEntry& entry) {
+    size_t method_length = std::min(entry.method.size(), MaxStringSize);
+    size_t path_length = std::min(entry.path.size(), MaxStringSize);
+    size_t size = padded(EntryFixedSize + method_length + path_length);
+
+    std::shared_ptr<Segment> segment;
+    size_t offset;
+    {
+      std::lock_guard<std::mutex> lock(impl->mutex);
+      if (impl->needs_rotation(size)) {
+        impl->rotate();
+      }
+      segment = impl->current;
+      offset = segment->used;
+      segment->used += size;
+    }
+
+    char* p = segment->data + offset;
+    auto timestamp = entry.timestamp;
+    put<uint16_t>(p, 4, entry.status);
+    put<uint16_t>(p, 6, method_length);
+    put<int64_t>(p, 8, timestamp.r().time_since_epoch().count());
+    put<uint64_t>(p, 16, entry.latency_us);
+    put<uint64_t>(p, 24, entry.bytes);
+    put<uint16_t>(p, 32, path_length);
+    put<uint16_t>(p, 34, 0);
+    std::memcpy(p + EntryFixedSize, entry.method.data(), method_length);
+    std::memcpy(p + EntryFixedSize + method_length, entry.path.data(), path_length);
+    __atomic_store_n(reinterpret_cast<uint32_t*>(p), uint32_t(size), __ATOMIC_RELEASE);
+  }
+
+  std::string AccessLogWriter::current_segment() const {
+    std::lock_guard<std::mutex> lock(impl->mutex);
+    return impl->current->path;
+  }
+
+  std::vector<AccessLogEntry> read_access_log_segment(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw AccessLogError{system_error("Could not open access log segment", path)};
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      auto message = system_error("Could not stat access log segment", path);
+      ::close(fd);
+      throw AccessLogError{message};
+    }
+    size_t file_size = st.st_size;
+    void* mapping = file_size ? ::mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (mapping == MAP_FAILED || file_size < HeaderSize || std::memcmp(mapping, Magic, sizeof(Magic)) != 0) {
+      if (mapping != MAP_FAILED) {
+        ::munmap(mapping, file_size);
+      }
+      throw AccessLogError{wayward::format("'{0}' is not an access log segment.", path)};
+    }
+    const char* data = static_cast<const char*>(mapping);
+    uint32_t version = get<uint32_t>(data, 8);
+    if (version != Version) {
+      ::munmap(mapping, file_size);
+      throw AccessLogError{wayward::format("Access log segment '{0}' has unsupported version {1}.", path, version)};
+    }
+
+    std::vector<AccessLogEntry> entries;
+    size_t offset = get<uint32_t>(data, 12);
+    while (offset + EntryFixedSize <= file_size) {
+      const char* p = data + offset;
+      uint32_t size = __atomic_load_n(reinterpret_cast<const uint32_t*>(p), __ATOMIC_ACQUIRE);
+      size_t method_length = get<uint16_t>(p, 6);
+      size_t path_length = get<uint16_t>(p, 32);
+      if (size == 0 || size < EntryFixedSize + method_length + path_length || offset + size > file_size) {
+        break;
+      }
+      AccessLogEntry entry;
+      entry.status = get<uint16_t>(p, 4);
+      entry.timestamp = DateTime{DateTime::Repr{std::chrono::nanoseconds{get<int64_t>(p, 8)}}};
+      entry.latency_us = get<uint64_t>(p, 16);
+      entry.bytes = get<uint64_t>(p, 24);
+      entry.method.assign(p + EntryFixedSize, method_length);
+      entry.path.assign(p + EntryFixedSize + method_length, path_length);
+      entries.push_back(std::move(entry));
+      offset += size;
+    }
+    ::munmap(mapping, file_size);
+    return entries;
+  }
+
+  namespace {
+    std::string timestamp_with_microseconds(DateTime t) {
+      auto us = (t.r().time_since_epoch().count() / 1000) % 1000000;
+      char fraction[8];
+      std::snprintf(fraction, sizeof(fraction), ".%06d", int(us));
+      return t.strftime("%Y-%m-%d %H:%M:%S") + fraction;
+    }
+  }
+
+  std::string access_log_entry_as_text(const AccessLogEntry& entry) {
+    return wayward::format("[{0}] {1} {2} {3} {4}us {5}B", timestamp_with_microseconds(entry.timestamp), entry.method, entry.path, entry.status, entry.latency_us, entry.bytes);
+  }
+
+  std::string access_log_entry_as_json(const AccessLogEntry& entry) {
+    return wayward::format("{\"timestamp\":\"{0}\",\"method\":\"{1}\",\"path\":\"{2}\",\"status\":{3},\"latency_us\":{4},\"bytes\":{5}}",
+      timestamp_with_microseconds(entry.timestamp), escape_json(entry.method), escape_json(entry.path), entry.status, entry.latency_us, entry.bytes);
+  }
+}
@@ -0,0 +1,66 @@
+#pragma once
+#ifndef WAYWARD_SUPPORT_ACCESS_LOG_HPP_INCLUDED
+#define WAYWARD_SUPPORT_ACCESS_LOG_HPP_INCLUDED
+
+#include <wayward/support/datetime.hpp>
+#include <wayward/support/error.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace wayward {
+  struct AccessLogError : Error {
+    AccessLogError(const std::string& msg) : Error(msg) {}
+  };
+
+  struct AccessLogEntry {
+    DateTime timestamp;
+    std::string method;
+    std::string path;
+    int status = 0;
+    uint64_t latency_us = 0;
+    uint64_t bytes = 0;
+  };
+
+  struct AccessLogOptions {
+    std::string directory = ".";
+    std::string prefix = "access";
+    // A new segment is started when the current one is full, or older than rotate_after (if non-zero).
+    size_t segment_size = 64 * 1024 * 1024;
+    std::chrono::seconds rotate_after = std::chrono::hours(1);
+  };
+
+  /*
+    Appends access log entries to memory-mapped segment files ("<prefix>-<time>-<pid>-<n>.wlog")
+    in a compact binary format. Read them back with read_access_log_segment(), or `w_dev access-log`.
+
+    Writers from any number of threads only hold a lock long enough to reserve space;
+    the entry is then copied into the mapping without it.
+  */
+  struct AccessLogWriter {
+    explicit AccessLogWriter(AccessLogOptions options);
+    ~AccessLogWriter();
+
+    void write(const AccessLogEntry& entry);
+
+    // Path of the segment currently being written.
+    std::string current_segment() const;
+
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+  };
+
+  /*
+    Reads the entries of a segment in the order they were written. A segment that is still
+    being written ends at the first entry that isn't complete yet.
+  */
+  std::vector<AccessLogEntry> read_access_log_segment(const std::string& path);
+
+  std::string access_log_entry_as_text(const AccessLogEntry& entry);
+  std::string access_log_entry_as_json(const AccessLogEntry& entry);
+}
+
+#endif // WAYWARD_SUPPORT_ACCESS_LOG_HPP_INCLUDED
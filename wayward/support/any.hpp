@@ -70,6 +70,7 @@ namespace wayward {
     AnyRef& operator=(const AnyRef&) = default;
 
     const TypeInfo& type_info() const { return *type_info_; }
+    void* memory() const { return ref_; }
 
     template <class T> bool is_a() const;
     template <class T> Maybe<typename meta::RemoveConstRef<T>::Type &> get();
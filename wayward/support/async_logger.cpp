@@ -0,0 +1,276 @@
+#include <wayward/support/async_logger.hpp>
+#include <wayward/support/thread_local.hpp>
+#include <wayward/support/format.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace wayward {
+  namespace {
+    struct Record {
+      Severity severity;
+      DateTime timestamp;
+      std::string tag;
+      std::string message;
+    };
+
+    // Single producer (the thread that owns it), single consumer (the logger's background thread).
+    struct Ring {
+      explicit Ring(size_t capacity) : slots(capacity), mask(capacity - 1) {}
+
+      std::vector<Record> slots;
+      const uint64_t mask;
+      std::atomic<bool> closed {false}; // Set when the logger goes away.
+
+      char pad0_[64];
+      std::atomic<uint64_t> head {0};    // Written by the producer.
+      std::atomic<uint64_t> dropped {0}; // Written by the producer.
+      char pad1_[64];
+      std::atomic<uint64_t> tail {0};    // Written by the consumer.
+
+      bool push(Record&& record) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) > mask) {
+          dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+          return false;
+        }
+        slots[h & mask] = std::move(record);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+      }
+
+      bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed);
+      }
+
+      template <typename F>
+      size_t drain(F&& f) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        uint64_t h = head.load(std::memory_order_acquire);
+        for (uint64_t i = t; i != h; ++i) {
+          f(std::move(slots[i & mask]));
+        }
+        tail.store(h, std::memory_order_release);
+        return h - t;
+      }
+    };
+
+    struct ThreadRings {
+      // Logger id => this thread's ring for that logger.
+      std::vector<std::pair<uint64_t, std::shared_ptr<Ring>>> rings;
+    };
+
+    ThreadRings& thread_rings() {
+      static ThreadLocal<ThreadRings> rings;
+      return *rings;
+    }
+
+    std::atomic<uint64_t> g_next_logger_id {1};
+  }
+
+  struct AsyncLogger::Impl {
+    std::shared_ptr<ILogger> downstream;
+    FormattedLogger* formatted = nullptr; // Non-null if downstream can take our timestamps.
+    size_t buffer_size = 0;
+    uint64_t id = 0;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable drained;
+    std::vector<std::shared_ptr<Ring>> rings;
+    std::atomic<uint64_t> rings_version {0};
+    std::atomic<bool> sleeping {false};
+    bool stopping = false;
+    bool flush_requested = false;
+    std::atomic<uint64_t> passes_started {0};
+    std::atomic<uint64_t> passes_completed {0};
+    uint64_t dropped_by_retired_rings = 0;
+    std::thread thread;
+
+    // Only touched by the background thread:
+    uint64_t reported_dropped = 0;
+
+    Ring& ring_for_this_thread() {
+      auto& local = thread_rings().rings;
+      for (auto& pair: local) {
+        if (pair.first == id) {
+          return *pair.second;
+        }
+      }
+
+      local.erase(std::remove_if(local.begin(), local.end(), [](const std::pair<uint64_t, std::shared_ptr<Ring>>& pair) {
+        return pair.second->closed.load(std::memory_order_relaxed);
+      }), local.end());
+
+      auto ring = std::make_shared<Ring>(buffer_size);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        rings.push_back(ring);
+        ++rings_version;
+      }
+      local.emplace_back(id, ring);
+      return *ring;
+    }
+
+    void wake_up() {
+      {
+        // Taking the lock makes sure the background thread is either awake or waiting.
+        std::lock_guard<std::mutex> lock(mutex);
+      }
+      wake.notify_one();
+    }
+
+    void pass_on(Record&& record) {
+      // There is nobody to report a failure to, and the background thread must keep going.
+      try {
+        if (formatted) {
+          formatted->log_at(record.timestamp, record.severity, std::move(record.tag), std::move(record.message));
+        } else {
+          downstream->log(record.severity, std::move(record.tag), std::move(record.message));
+        }
+      }
+      catch (...) {}
+    }
+
+    uint64_t total_dropped(const std::vector<std::shared_ptr<Ring>>& snapshot, uint64_t retired) const {
+      uint64_t total = retired;
+      for (auto& ring: snapshot) {
+        total += ring->dropped.load(std::memory_order_relaxed);
+      }
+      return total;
+    }
+
+    void report_dropped(const std::vector<std::shared_ptr<Ring>>& snapshot, uint64_t retired) {
+      uint64_t total = total_dropped(snapshot, retired);
+      if (total > reported_dropped) {
+        pass_on(Record{Severity::Warning, DateTime::now(), "log", wayward::format("Dropped {0} log messages because the log buffer was full.", total - reported_dropped)});
+        reported_dropped = total;
+      }
+    }
+
+    bool all_empty(const std::vector<std::shared_ptr<Ring>>& snapshot) const {
+      return std::all_of(snapshot.begin(), snapshot.end(), [](const std::shared_ptr<Ring>& ring) { return ring->empty(); });
+    }
+
+    void run() {
+      std::vector<std::shared_ptr<Ring>> snapshot;
+      uint64_t version = ~uint64_t(0);
+      uint64_t retired = 0;
+
+      while (true) {
+        // A pass drains every ring, then reports drops. flush() waits for a whole pass.
+        passes_started.fetch_add(1);
+        if (rings_version.load(std::memory_order_acquire) != version) {
+          std::lock_guard<std::mutex> lock(mutex);
+          snapshot = rings;
+          version = rings_version.load(std::memory_order_relaxed);
+          retired = dropped_by_retired_rings;
+        }
+
+        size_t n = 0;
+        for (auto& ring: snapshot) {
+          n += ring->drain([&](Record&& record) { pass_on(std::move(record)); });
+        }
+        report_dropped(snapshot, retired);
+        passes_completed.fetch_add(1);
+        drained.notify_all();
+        if (n != 0) {
+          continue;
+        }
+
+        // Nothing to do. Forget rings whose threads have exited, and wait for more.
+        snapshot.clear();
+        version = ~uint64_t(0);
+        std::unique_lock<std::mutex> lock(mutex);
+        auto retire = std::partition(rings.begin(), rings.end(), [](const std::shared_ptr<Ring>& ring) {
+          return ring.use_count() > 1 || !ring->empty();
+        });
+        if (retire != rings.end()) {
+          for (auto it = retire; it != rings.end(); ++it) {
+            dropped_by_retired_rings += (*it)->dropped.load(std::memory_order_relaxed);
+          }
+          rings.erase(retire, rings.end());
+          ++rings_version;
+        }
+        if (stopping && all_empty(rings)) {
+          break;
+        }
+
+        sleeping.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wake.wait_for(lock, std::chrono::milliseconds(100), [&]() {
+          return stopping || flush_requested || !all_empty(rings);
+        });
+        flush_requested = false;
+        sleeping.store(false, std::memory_order_relaxed);
+      }
+    }
+  };
+
+  AsyncLogger::AsyncLogger(std::shared_ptr<ILogger> downstream, size_t buffer_size) : impl(new Impl) {
+    impl->formatted = dynamic_cast<FormattedLogger*>(downstream.get());
+    impl->downstream = std::move(downstream);
+    size_t capacity = 1;
+    while (capacity < buffer_size) {
+      capacity <<= 1;
+    }
+    impl->buffer_size = capacity;
+    impl->id = g_next_logger_id++;
+    Impl* p = impl.get();
+    impl->thread = std::thread([p]() { p->run(); });
+  }
+
+  AsyncLogger::~AsyncLogger() {
+    {
+      std::lock_guard<std::mutex> lock(impl->mutex);
+      impl->stopping = true;
+    }
+    impl->wake.notify_one();
+    impl->thread.join();
+    for (auto& ring: impl->rings) {
+      ring->closed.store(true, std::memory_order_relaxed);
+    }
+  }
+
+  void AsyncLogger::log(Severity severity, std::string tag, std::string message) {
+    if (severity < level()) {
+      return;
+    }
+    Ring& ring = impl->ring_for_this_thread();
+    if (ring.push(Record{severity, DateTime::now(), std::move(tag), std::move(message)})) {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (impl->sleeping.load(std::memory_order_relaxed)) {
+        impl->wake_up();
+      }
+    }
+  }
+
+  Severity AsyncLogger::level() const {
+    return impl->downstream->level();
+  }
+
+  void AsyncLogger::set_level(Severity severity) {
+    impl->downstream->set_level(severity);
+  }
+
+  void AsyncLogger::flush() {
+    std::unique_lock<std::mutex> lock(impl->mutex);
+    // The first pass to start after this point sees everything logged so far.
+    uint64_t pass = impl->passes_started.load() + 1;
+    impl->flush_requested = true;
+    impl->wake.notify_one();
+    while (impl->passes_completed.load() < pass) {
+      impl->drained.wait_for(lock, std::chrono::milliseconds(1));
+    }
+  }
+
+  uint64_t AsyncLogger::dropped() const {
+    std::lock_guard<std::mutex> lock(impl->mutex);
+    return impl->total_dropped(impl->rings, impl->dropped_by_retired_rings);
+  }
+}
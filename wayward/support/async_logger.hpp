@@ -0,0 +1,39 @@
+#pragma once
+#ifndef WAYWARD_SUPPORT_ASYNC_LOGGER_HPP_INCLUDED
+#define WAYWARD_SUPPORT_ASYNC_LOGGER_HPP_INCLUDED
+
+#include <wayward/support/logger.hpp>
+
+#include <cstdint>
+#include <memory>
+
+namespace wayward {
+  /*
+    Hands log messages to another logger on a background thread, so that formatting and I/O
+    stay off the threads doing the logging.
+
+    Each logging thread gets its own lock-free ring buffer of `buffer_size` messages. When a
+    thread logs faster than the background thread can keep up and its buffer fills, further
+    messages from it are dropped and counted, and a warning about it is logged once there is room.
+  */
+  struct AsyncLogger : ILogger {
+    explicit AsyncLogger(std::shared_ptr<ILogger> downstream, size_t buffer_size = 4096);
+    virtual ~AsyncLogger();
+
+    // ILogger interface
+    void log(Severity severity, std::string tag, std::string message) final;
+    Severity level() const final;
+    void set_level(Severity severity) final;
+
+    // Blocks until everything logged before the call has been passed on.
+    void flush();
+
+    // The number of messages dropped because a buffer was full.
+    uint64_t dropped() const;
+
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+  };
+}
+
+#endif // WAYWARD_SUPPORT_ASYNC_LOGGER_HPP_INCLUDED
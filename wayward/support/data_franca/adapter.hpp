@@ -76,8 +76,37 @@ namespace wayward {
         // It's OK to const_cast here, because we immediately upcast to IReader, which is a const-only interface.
         return std::static_pointer_cast<const IReader>(std::make_shared<Adapter<T>>(const_cast<T&>(object), options));
       }
+      template <typename F>
+      static void visit(const T& object, Bitflags<Options> options, F& function) {
+        const Adapter<T> adapter {const_cast<T&>(object), options};
+        function(static_cast<const IReader&>(adapter));
+      }
     };
 
+    // Prefers GetAdapter<T>::visit() when it exists, falling back to make_reader().
+    template <typename T, typename F>
+    auto visit_reader_dispatch(const T& object, Bitflags<Options> options, F& function, int)
+    -> decltype(GetAdapter<T>::visit(object, options, function)) {
+      GetAdapter<T>::visit(object, options, function);
+    }
+
+    template <typename T, typename F>
+    void visit_reader_dispatch(const T& object, Bitflags<Options> options, F& function, long) {
+      static const NullReader null_reader;
+      auto reader = make_reader(object, options);
+      function(reader ? *reader : static_cast<const IReader&>(null_reader));
+    }
+
+    /*
+      Calls function(const IReader&) with a reader for object. When the adapter type is
+      known statically, the adapter lives on the stack instead of being allocated like
+      with make_reader().
+    */
+    template <typename T, typename F>
+    void visit_reader(const T& object, Bitflags<Options> options, F&& function) {
+      visit_reader_dispatch(object, options, function, 0);
+    }
+
     template <typename T>
     struct OwningAdapter : Adapter<T> {
       T owned_;
@@ -19,11 +19,13 @@ namespace wayward {
       Maybe<Integer> get_integer() const final { return ref_ ? adapter_.get_integer() : Nothing; }
       Maybe<Real>    get_real()    const final { return ref_ ? adapter_.get_real() : Nothing; }
       Maybe<String>  get_string()  const final { return ref_ ? adapter_.get_string() : Nothing; }
+      const String*  peek_string() const final { return ref_ ? adapter_.peek_string() : nullptr; }
       bool has_key(const String& key) const final { return ref_ ? adapter_.has_key(key) : false; }
       ReaderPtr get(const String& key) const final { return ref_ ? adapter_.get(key) : nullptr; }
       size_t   length()       const final { return ref_ ? adapter_.length() : 0; }
       ReaderPtr at(size_t idx) const final { return ref_ ? adapter_.at(idx) : nullptr; }
       ReaderEnumeratorPtr enumerator() const final { return ref_ ? adapter_.enumerator() : nullptr; }
+      void visit_children(IReaderVisitor& visitor) const final { if (ref_) adapter_.visit_children(visitor); }
 
       // IWriter interface:
       bool set_nothing() final { ref_ = Nothing; return true; }
@@ -81,6 +83,7 @@ namespace wayward {
 
       DataType type() const final { return DataType::String; }
       Maybe<String> get_string() const final { return this->ref_; }
+      const String* peek_string() const final { return &this->ref_; }
       bool set_string(String str) final { this->ref_ = std::move(str); return true; }
     };
 
@@ -127,6 +130,14 @@ namespace wayward {
         return ReaderEnumeratorPtr(new Enumerator{this->ref_.begin(), this->ref_.end(), this->options_});
       }
 
+      void visit_children(IReaderVisitor& visitor) const final {
+        for (auto& element: this->ref_) {
+          visit_reader(element, this->options_, [&](const IReader& reader) {
+            visitor.visit(nullptr, reader);
+          });
+        }
+      }
+
       AdapterPtr reference_at_index(size_t idx) final {
         if (idx < this->ref_.size()) {
           return make_adapter(this->ref_.at(idx), this->options_);
@@ -178,6 +189,10 @@ namespace wayward {
           return Nothing;
         }
 
+        const String* peek_current_key() const final {
+          return it_ != end_ ? &it_->first : nullptr;
+        }
+
         bool at_end() const final { return it_ == end_; }
 
         void move_next() final {
@@ -191,6 +206,14 @@ namespace wayward {
         return ReaderEnumeratorPtr{new Enumerator{this->ref_.begin(), this->ref_.end(), this->options_}};
       }
 
+      void visit_children(IReaderVisitor& visitor) const final {
+        for (auto& pair: this->ref_) {
+          visit_reader(pair.second, this->options_, [&](const IReader& reader) {
+            visitor.visit(&pair.first, reader);
+          });
+        }
+      }
+
       AdapterPtr reference_at_key(const String& key) final {
         auto it = this->ref_.find(key);
         if (it == this->ref_.end()) {
@@ -1,31 +1,92 @@
 #include "wayward/support/data_franca/object.hpp"
 
+#include <algorithm>
+
 namespace wayward {
   namespace data_franca {
     const Object Object::g_null_object;
 
+    namespace {
+      template <typename Entry>
+      bool key_less(const Entry& entry, const String& key) {
+        return entry.first < key;
+      }
+    }
+
+    // The enumerators hold on to the storage, so it stays valid even if the object is modified meanwhile.
     struct Object::ListEnumerator : Cloneable<Object::ListEnumerator, IReaderEnumerator> {
-      using Iterator = Object::List::const_iterator;
-      Iterator it_;
-      Iterator end_;
-      ListEnumerator(Iterator it, Iterator end) : it_(it), end_(end) {}
-      ReaderPtr current_value() const final { return make_reader(**it_); }
+      SharedList list_;
+      size_t i_ = 0;
+      ListEnumerator(SharedList list) : list_(std::move(list)) {}
+      ReaderPtr current_value() const final { return make_reader((*list_)[i_]); }
       Maybe<String> current_key() const final { return Nothing; }
-      bool at_end() const final { return it_ == end_; }
-      void move_next() final { ++it_; }
+      bool at_end() const final { return i_ >= list_->size(); }
+      void move_next() final { ++i_; }
     };
 
     struct Object::DictEnumerator : Cloneable<Object::DictEnumerator, IReaderEnumerator> {
-      using Iterator = Object::Dictionary::const_iterator;
-      Iterator it_;
-      Iterator end_;
-      DictEnumerator(Iterator it, Iterator end) : it_(it), end_(end) {}
-      ReaderPtr current_value() const final { return make_reader(*it_->second); }
-      Maybe<String> current_key() const final { return it_->first; }
-      bool at_end() const final { return it_ == end_; }
-      void move_next() final { ++it_; }
+      SharedDictionary dict_;
+      size_t i_ = 0;
+      DictEnumerator(SharedDictionary dict) : dict_(std::move(dict)) {}
+      ReaderPtr current_value() const final { return make_reader((*dict_)[i_].second); }
+      Maybe<String> current_key() const final { return (*dict_)[i_].first; }
+      const String* peek_current_key() const final { return &(*dict_)[i_].first; }
+      bool at_end() const final { return i_ >= dict_->size(); }
+      void move_next() final { ++i_; }
     };
 
+    Object::Object(const Object& other) : data_(other.data_) {
+      if (other.unshareable_) {
+        detach();
+      }
+    }
+
+    Object& Object::operator=(const Object& other) {
+      // Copy first: `other` may live inside our own storage.
+      Object copy { other };
+      return *this = std::move(copy);
+    }
+
+    Object Object::dictionary() {
+      Object o;
+      o.data_ = std::make_shared<Dictionary>();
+      return o;
+    }
+
+    Object Object::list() {
+      Object o;
+      o.data_ = std::make_shared<List>();
+      return o;
+    }
+
+    Object Object::dictionary(std::vector<std::pair<String, Object>> entries) {
+      // Stable, so that among equal keys the last one given is also the last one after sorting.
+      std::stable_sort(entries.begin(), entries.end(), [](const std::pair<String, Object>& a, const std::pair<String, Object>& b) {
+        return a.first < b.first;
+      });
+      auto out = entries.begin();
+      for (auto it = entries.begin(); it != entries.end(); ++it) {
+        auto next = it + 1;
+        if (next != entries.end() && next->first == it->first) {
+          continue;
+        }
+        if (out != it) {
+          *out = std::move(*it);
+        }
+        ++out;
+      }
+      entries.erase(out, entries.end());
+      Object o;
+      o.data_ = std::make_shared<Dictionary>(std::move(entries));
+      return o;
+    }
+
+    Object Object::list(std::vector<Object> elements) {
+      Object o;
+      o.data_ = std::make_shared<List>(std::move(elements));
+      return o;
+    }
+
     DataType Object::type() const {
       // XXX: Slightly fragile, but never change the order of the Either.
       switch (data_.which()) {
@@ -40,113 +101,160 @@ namespace wayward {
       }
     }
 
+    const String* Object::peek_string() const {
+      const String* ptr = nullptr;
+      data_.template when<String>([&](const String& str) {
+        ptr = &str;
+      });
+      return ptr;
+    }
+
+    const Object::List* Object::as_list() const {
+      const List* ptr = nullptr;
+      data_.template when<SharedList>([&](const SharedList& list) {
+        ptr = list.get();
+      });
+      return ptr;
+    }
+
+    const Object::Dictionary* Object::as_dictionary() const {
+      const Dictionary* ptr = nullptr;
+      data_.template when<SharedDictionary>([&](const SharedDictionary& dict) {
+        ptr = dict.get();
+      });
+      return ptr;
+    }
+
+    Object::List& Object::mutable_list() {
+      if (type() != DataType::List) {
+        data_ = std::make_shared<List>();
+      }
+      List* ptr = nullptr;
+      data_.template when<SharedList>([&](SharedList& list) {
+        if (list.use_count() != 1) {
+          list = std::make_shared<List>(*list);
+        }
+        ptr = list.get();
+      });
+      return *ptr;
+    }
+
+    Object::Dictionary& Object::mutable_dictionary() {
+      if (type() != DataType::Dictionary) {
+        data_ = std::make_shared<Dictionary>();
+      }
+      Dictionary* ptr = nullptr;
+      data_.template when<SharedDictionary>([&](SharedDictionary& dict) {
+        if (dict.use_count() != 1) {
+          dict = std::make_shared<Dictionary>(*dict);
+        }
+        ptr = dict.get();
+      });
+      return *ptr;
+    }
+
+    void Object::detach() {
+      data_.template when<SharedList>([&](SharedList& list) {
+        list = std::make_shared<List>(*list);
+      });
+      data_.template when<SharedDictionary>([&](SharedDictionary& dict) {
+        dict = std::make_shared<Dictionary>(*dict);
+      });
+    }
+
     ReaderEnumeratorPtr Object::enumerator() const {
       ReaderEnumeratorPtr ptr;
-      data_.template when<List>([&](const List& list) {
-        ptr = ReaderEnumeratorPtr{new ListEnumerator{list.begin(), list.end()}};
+      data_.template when<SharedList>([&](const SharedList& list) {
+        ptr = ReaderEnumeratorPtr{new ListEnumerator{list}};
       });
-      data_.template when<Dictionary>([&](const Dictionary& dict) {
-        ptr = ReaderEnumeratorPtr{new DictEnumerator{dict.begin(), dict.end()}};
+      data_.template when<SharedDictionary>([&](const SharedDictionary& dict) {
+        ptr = ReaderEnumeratorPtr{new DictEnumerator{dict}};
       });
       return std::move(ptr);
     }
 
+    void Object::reserve(size_t n) {
+      mutable_list().reserve(n);
+    }
+
     Object& Object::reference_at_index(size_t idx) {
       if (type() != DataType::List) {
         throw ObjectIndexOutOfBounds{"Object is not a list."};
       }
-      Object* ptr = nullptr;
-      data_.template when<List>([&](List& list) {
-        if (idx < list.size()) {
-          ptr = list[idx].get();
-        }
-      });
-      if (ptr == nullptr) {
+      auto& list = mutable_list();
+      if (idx >= list.size()) {
         throw ObjectIndexOutOfBounds{"Index out of bounds."};
       }
-      return *ptr;
+      unshareable_ = true;
+      return list[idx];
     }
 
     const Object& Object::at(size_t idx) const {
-      if (type() != DataType::List) {
+      auto list = as_list();
+      if (list == nullptr) {
         throw ObjectIndexOutOfBounds{"Object is not a list."};
       }
-      const Object* ptr = nullptr;
-      data_.template when<List>([&](const List& list) {
-        if (idx < list.size()) {
-          ptr = list[idx].get();
-        }
-      });
-      if (ptr == nullptr) {
+      if (idx >= list->size()) {
         throw ObjectIndexOutOfBounds{"Index out of bounds."};
       }
-      return *ptr;
+      return (*list)[idx];
     }
 
     Object& Object::reference_at_key(const String& key) {
-      if (type() != DataType::Dictionary) {
-        data_ = Dictionary{};
+      auto& dict = mutable_dictionary();
+      auto it = std::lower_bound(dict.begin(), dict.end(), key, key_less<Dictionary::value_type>);
+      if (it == dict.end() || it->first != key) {
+        it = dict.emplace(it, key, Object{});
       }
-      Object* ptr = nullptr;
-      data_.template when<Dictionary>([&](Dictionary& dict) {
-        auto it = dict.find(key);
-        if (it == dict.end()) {
-          it = dict.insert(std::make_pair(key, CloningPtr<Object>{new Object})).first;
-        }
-        ptr = it->second.get();
-      });
-      assert(ptr != nullptr);
-      return *ptr;
+      unshareable_ = true;
+      return it->second;
     }
 
     bool Object::push_back(Object other) {
-      if (type() != DataType::List) {
-        data_ = List{};
-      }
-      data_.template when<List>([&](List& list) {
-        list.emplace_back(new Object(std::move(other)));
-      });
+      mutable_list().push_back(std::move(other));
       return true;
     }
 
     size_t Object::length() const {
-      size_t len = 0;
-      data_.template when<List>([&](const List& list) {
-        len = list.size();
-      });
-      data_.template when<Dictionary>([&](const Dictionary& dict) {
-        len = dict.size();
-      });
-      return len;
+      if (auto list = as_list()) {
+        return list->size();
+      }
+      if (auto dict = as_dictionary()) {
+        return dict->size();
+      }
+      return 0;
     }
 
     bool Object::erase(const String& key) {
-      bool b = false;
-      data_.template when<Dictionary>([&](Dictionary& dict) {
-        dict.erase(key);
-        b = true;
-      });
-      return b;
+      if (type() != DataType::Dictionary) {
+        return false;
+      }
+      auto& dict = mutable_dictionary();
+      auto it = std::lower_bound(dict.begin(), dict.end(), key, key_less<Dictionary::value_type>);
+      if (it != dict.end() && it->first == key) {
+        dict.erase(it);
+      }
+      return true;
     }
 
     const Object& Object::get(const String& key) const {
-      const Object* ptr = &g_null_object;
-      data_.template when<Dictionary>([&](const Dictionary& dict) {
-        auto it = dict.find(key);
-        if (it != dict.end()) {
-          ptr = it->second.get();
+      auto dict = as_dictionary();
+      if (dict != nullptr) {
+        auto it = std::lower_bound(dict->begin(), dict->end(), key, key_less<Dictionary::value_type>);
+        if (it != dict->end() && it->first == key) {
+          return it->second;
         }
-      });
-      return *ptr;
+      }
+      return g_null_object;
     }
 
     bool Object::has_key(const String& key) const {
-      bool has = false;
-      data_.template when<Dictionary>([&](const Dictionary& dict) {
-        auto it = dict.find(key);
-        has = it != dict.end();
-      });
-      return has;
+      auto dict = as_dictionary();
+      if (dict == nullptr) {
+        return false;
+      }
+      auto it = std::lower_bound(dict->begin(), dict->end(), key, key_less<Dictionary::value_type>);
+      return it != dict->end() && it->first == key;
     }
   }
 }
@@ -11,12 +11,28 @@
 
 #include <wayward/support/cloning_ptr.hpp>
 
+#include <memory>
+#include <utility>
+#include <vector>
+
 namespace wayward {
   namespace data_franca {
     /*
       An "object" is a piece of structured data that can be modified.
 
       Think JSON builder.
+
+      Lists and dictionaries store their elements inline in a single vector (dictionaries
+      sorted by key), and are shared between copies of an Object until one of them is
+      modified.
+
+      Like with std::vector, references to elements are invalidated when elements are
+      added to or removed from the same list or dictionary. That includes inserting a
+      new key: `Object& a = o["a"]; o["b"] = 1;` leaves `a` dangling.
+
+      Handing out a mutable reference to an element (operator[], reference_at_*) marks
+      the list or dictionary as unshareable, so later copies of the Object get their own
+      storage, and writes through the reference never show up in a copy.
     */
     struct Object final
     : ReaderInterface<Object, const Object&>
@@ -27,17 +43,20 @@ namespace wayward {
       Object(Real r)    : data_(r) {}
       Object(String s)  : data_(std::move(s)) {}
 
-      Object(const Object&) = default;
+      Object(const Object&);
       Object(Object&&) = default;
       Object& operator=(Object&&) = default;
-      Object& operator=(const Object&) = default;
+      Object& operator=(const Object&);
 
 
       // Convenience:
       Object(int n) : data_((Integer)n) {}
       Object(const char* str) : data_(std::string{str}) {}
-      static Object dictionary() { Object o; o.data_ = Dictionary{}; return std::move(o); }
-      static Object list() { Object o; o.data_ = List{}; return std::move(o); }
+      static Object dictionary();
+      static Object list();
+      // Builds a dictionary in one go. If a key occurs more than once, the last value wins.
+      static Object dictionary(std::vector<std::pair<String, Object>> entries);
+      static Object list(std::vector<Object> elements);
 
       Object* clone() const { return new Object(*this); }
 
@@ -58,6 +77,7 @@ namespace wayward {
       Maybe<Integer> get_integer() const { return data_.get<Integer>(); }
       Maybe<Real>    get_real() const    { return data_.get<Real>(); }
       Maybe<String>  get_string() const  { return data_.get<String>(); }
+      const String*  peek_string() const;
       bool           has_key(const String& key) const;
       const Object&  get(const String& key) const;
       size_t         length() const;
@@ -80,8 +100,10 @@ namespace wayward {
       bool erase(const String& key);
 
     private:
-      using List = std::vector<CloningPtr<Object>>;
-      using Dictionary = std::map<std::string, CloningPtr<Object>>;
+      using List = std::vector<Object>;
+      using Dictionary = std::vector<std::pair<String, Object>>; // Sorted by key.
+      using SharedList = std::shared_ptr<List>;
+      using SharedDictionary = std::shared_ptr<Dictionary>;
 
       Either<
         NothingType,
@@ -89,9 +111,19 @@ namespace wayward {
         Integer,
         Real,
         String,
-        List,
-        Dictionary
+        SharedList,
+        SharedDictionary
       > data_;
+      // Set once a mutable reference into the list/dictionary has been handed out.
+      bool unshareable_ = false;
+
+      const List* as_list() const;
+      const Dictionary* as_dictionary() const;
+      // These turn the object into a list/dictionary if it isn't one, and make sure it isn't shared.
+      List& mutable_list();
+      Dictionary& mutable_dictionary();
+      // Gives this object its own copy of its list/dictionary.
+      void detach();
 
       static const Object g_null_object;
 
@@ -113,11 +145,25 @@ namespace wayward {
       Maybe<Integer> get_integer() const final { return ref_.get_integer(); }
       Maybe<Real>    get_real()    const final { return ref_.get_real(); }
       Maybe<String>  get_string()  const final { return ref_.get_string(); }
+      const String*  peek_string() const final { return ref_.peek_string(); }
       bool has_key(const String& key) const final { return ref_.has_key(key); }
       ReaderPtr get(const String& key) const final { return make_reader(ref_.get(key), options_); }
       size_t   length()       const final { return ref_.length(); }
       ReaderPtr at(size_t idx) const final { return make_reader(ref_.at(idx), options_); }
       ReaderEnumeratorPtr enumerator() const final { return ref_.enumerator(); }
+      void visit_children(IReaderVisitor& visitor) const final {
+        if (auto list = ref_.as_list()) {
+          for (auto& element: *list) {
+            const Adapter<Object> adapter {const_cast<Object&>(element), options_};
+            visitor.visit(nullptr, adapter);
+          }
+        } else if (auto dict = ref_.as_dictionary()) {
+          for (auto& pair: *dict) {
+            const Adapter<Object> adapter {const_cast<Object&>(pair.second), options_};
+            visitor.visit(&pair.first, adapter);
+          }
+        }
+      }
 
       // IWriter interface:
       bool set_nothing() final { return ref_.set_nothing(); }
@@ -128,11 +174,8 @@ namespace wayward {
       AdapterPtr reference_at_index(size_t idx) final { return make_adapter(ref_.reference_at_index(idx), options_); }
       AdapterPtr push_back() final {
         ref_.push_back(Object{});
-        AdapterPtr ptr;
-        ref_.data_.template when<Object::List>([&](Object::List& list) {
-          ptr = make_adapter(*list.back(), options_);
-        });
-        return std::move(ptr);
+        ref_.unshareable_ = true;
+        return make_adapter(ref_.mutable_list().back(), options_);
       }
       AdapterPtr reference_at_key(const String& key) final { return make_adapter(ref_.reference_at_key(key), options_); }
       bool erase(const String& key) final { return ref_.erase(key); }
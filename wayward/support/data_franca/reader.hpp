@@ -14,6 +14,7 @@ namespace wayward {
   namespace data_franca {
     struct IReaderEnumerator;
     using ReaderEnumeratorPtr = CloningPtr<IReaderEnumerator>;
+    struct IReaderVisitor;
 
     /*
       A Reader traverses data and inspects it as it passes over it.
@@ -29,6 +30,10 @@ namespace wayward {
       virtual Maybe<Real>    get_real()    const = 0;
       virtual Maybe<String>  get_string()  const = 0;
 
+      // Returns the string value without copying it, if the reader has one stored somewhere.
+      // The pointer is valid as long as the reader. nullptr does not mean the value isn't a string.
+      virtual const String* peek_string() const { return nullptr; }
+
       virtual bool has_key(const String& key) const = 0;
       virtual ReaderPtr get(const String& key) const = 0;
 
@@ -36,12 +41,27 @@ namespace wayward {
       virtual ReaderPtr at(size_t idx) const = 0;
 
       virtual ReaderEnumeratorPtr enumerator() const = 0;
+
+      /*
+        Calls the visitor once for each element of a list or dictionary. Unlike enumerator(),
+        readers that know their element types statically override this to pass adapters that
+        live on the stack, so no allocations are made per element.
+      */
+      virtual void visit_children(IReaderVisitor& visitor) const;
+    };
+
+    struct IReaderVisitor {
+      virtual ~IReaderVisitor() {}
+      // The key is nullptr for list elements. Neither the key nor the value outlive the call.
+      virtual void visit(const String* key, const IReader& value) = 0;
     };
 
     struct IReaderEnumerator {
       virtual ~IReaderEnumerator() {}
       virtual ReaderPtr current_value() const = 0;
       virtual Maybe<String> current_key() const = 0;
+      // Like IReader::peek_string(), for the current key.
+      virtual const String* peek_current_key() const { return nullptr; }
       virtual bool at_end() const = 0;
       virtual void move_next() = 0;
       virtual IReaderEnumerator* clone() const = 0;
@@ -62,6 +82,39 @@ namespace wayward {
       ReaderEnumeratorPtr enumerator() const { return nullptr; }
     };
 
+    inline void IReader::visit_children(IReaderVisitor& visitor) const {
+      static const NullReader null_reader;
+      bool with_keys = type() == DataType::Dictionary;
+      auto e = enumerator();
+      for (; e && !e->at_end(); e->move_next()) {
+        Maybe<String> key_copy;
+        const String* key = nullptr;
+        if (with_keys) {
+          key = e->peek_current_key();
+          if (key == nullptr) {
+            key_copy = e->current_key();
+            key = key_copy ? &*key_copy : nullptr;
+          }
+        }
+        auto value = e->current_value();
+        visitor.visit(key, value ? *value : null_reader);
+      }
+    }
+
+    template <typename F>
+    struct FunctionReaderVisitor : IReaderVisitor {
+      F& function;
+      FunctionReaderVisitor(F& function) : function(function) {}
+      void visit(const String* key, const IReader& value) final { function(key, value); }
+    };
+
+    // Calls function(const String* key, const IReader& value) for each child of reader.
+    template <typename F>
+    void visit_children(const IReader& reader, F&& function) {
+      FunctionReaderVisitor<typename std::remove_reference<F>::type> visitor {function};
+      reader.visit_children(visitor);
+    }
+
     struct ReaderEnumeratorAtEnd : Cloneable<ReaderEnumeratorAtEnd, IReaderEnumerator> {
       ReaderPtr current_value() const final { return nullptr; }
       Maybe<String> current_key() const final { return Nothing; }
@@ -104,6 +104,13 @@ namespace wayward {
         handle->handle_event(fd, ev);
       }
     };
+
+    void handle_posted_cb(evutil_socket_t, short, void* userdata) {
+      std::shared_ptr<std::function<void()>> callback { static_cast<std::function<void()>*>(userdata) };
+      fiber::start([=]() {
+        (*callback)();
+      });
+    }
   }
 
   std::unique_ptr<IEventHandle> EventLoop::add_file_descriptor(int fd, FDEvents events, FDEventCallback callback) {
@@ -116,6 +123,16 @@ namespace wayward {
     return std::move(handle);
   }
 
+  void EventLoop::post(std::function<void()> callback) {
+    // event_base_once locks the base and wakes up the loop, since evthread_use_pthreads() was called.
+    auto userdata = new std::function<void()>(std::move(callback));
+    struct timeval now = {0, 0};
+    if (event_base_once(p_->base, -1, EV_TIMEOUT, handle_posted_cb, userdata, &now) != 0) {
+      delete userdata;
+      throw FiberError("Could not post a callback to the event loop.");
+    }
+  }
+
   std::unique_ptr<IEventHandle> EventLoop::call_in(DateTimeInterval interval, std::function<void()> callback, bool repeat) {
     auto handle = std::unique_ptr<TimeoutEventHandle_libevent>(new TimeoutEventHandle_libevent);
     short events = EV_TIMEOUT;
@@ -35,6 +35,9 @@ namespace wayward {
 
     virtual std::unique_ptr<IEventHandle>
     call_in(DateTimeInterval interval, std::function<void()> callback, bool repeat = false) = 0;
+
+    // Runs callback on the loop's own thread as soon as possible. Unlike the rest, this may be called from any thread.
+    virtual void post(std::function<void()> callback) = 0;
   };
 
   IEventLoop* current_event_loop();
@@ -53,6 +56,8 @@ namespace wayward {
     std::unique_ptr<IEventHandle>
     call_in(DateTimeInterval interval, std::function<void()> callback, bool repeat = false) final;
 
+    void post(std::function<void()> callback) final;
+
     explicit EventLoop(void* native_handle); // Only for internal use!
   private:
     struct Private;
@@ -2,6 +2,7 @@
 #include <wayward/support/thread_local.hpp>
 
 #include <exception>
+#include <map>
 #include <assert.h>
 #include <setjmp.h>
 #include <sys/mman.h>
@@ -36,6 +37,7 @@ namespace wayward {
     bool started = false;
     bool being_deleted = false;
     FiberSignal sig = FiberSignal::Resume;
+    std::map<const void*, void*> locals;
   };
 
   namespace {
@@ -269,5 +271,24 @@ namespace wayward {
       }
       resume_fiber_with_signal(std::move((*g_current_fiber)->invoker), FiberSignal::Resume);
     }
+
+    bool can_yield() {
+      return *g_current_fiber != nullptr && (*g_current_fiber)->invoker != nullptr;
+    }
+
+    void* get_local(const void* key) {
+      auto& locals = current()->locals;
+      auto it = locals.find(key);
+      return it != locals.end() ? it->second : nullptr;
+    }
+
+    void set_local(const void* key, void* value) {
+      auto& locals = current()->locals;
+      if (value) {
+        locals[key] = value;
+      } else {
+        locals.erase(key);
+      }
+    }
   }
 }
@@ -59,6 +59,19 @@ namespace wayward {
       Throws an exception if the current fiber is orphaned.
     */
     void yield();
+
+    /*
+      True if the current fiber has an invoker to yield to.
+    */
+    bool can_yield();
+
+    /*
+      Fiber-local storage. Every fiber, including the main fiber of each thread,
+      has its own value for each key, which is nullptr until set. Use the address
+      of a static object as the key.
+    */
+    void* get_local(const void* key);
+    void set_local(const void* key, void* value);
   }
 }
 
@@ -1,33 +1,194 @@
 #include <wayward/support/format.hpp>
-#include <map>
+#include <wayward/support/thread_local.hpp>
 #include <string>
 #include <ostream>
+#include <streambuf>
 
 namespace wayward {
-  void stream_interpolate_indexed(std::ostream& os, const std::string& fmt, const Formattable* formatters, unsigned int num_formatters) {
-    static const std::regex find_placeholders {"\\{(\\d+)\\}"};
-    wayward::regex_replace_stream(os, fmt, find_placeholders, [&](std::ostream& os, const MatchResults& match) {
-      std::stringstream ss(std::string{match[1].first, match[1].second});
-      unsigned int idx = num_formatters;
-      ss >> idx;
-      if (idx >= num_formatters) {
-        std::copy(match[0].first, match[0].second, std::ostreambuf_iterator<char>(os));
+  namespace detail {
+    namespace {
+      struct AppendToString : std::streambuf {
+        std::string* out = nullptr;
+
+        int_type overflow(int_type c) final {
+          if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            out->push_back(traits_type::to_char_type(c));
+          }
+          return traits_type::not_eof(c);
+        }
+
+        std::streamsize xsputn(const char* s, std::streamsize n) final {
+          out->append(s, n);
+          return n;
+        }
+      };
+    }
+
+    struct FormatSink::Stream {
+      AppendToString buffer;
+      std::ostream os {&buffer};
+      bool in_use = false;
+    };
+
+    namespace {
+      // Constructing an ostream is expensive (locales), so each thread keeps one around.
+      // Function-local so that format() works during static initialization.
+      FormatSink::Stream* thread_stream() {
+        static ThreadLocal<FormatSink::Stream> streams;
+        return streams.get();
+      }
+    }
+
+    FormatSink::~FormatSink() {
+      if (owns_stream_) {
+        delete stream_;
+      } else if (stream_) {
+        stream_->in_use = false;
+      }
+    }
+
+    std::ostream& FormatSink::stream() {
+      if (stream_ == nullptr) {
+        Stream* stream = thread_stream();
+        if (stream->in_use) {
+          // An operator<< called format() while formatting; don't disturb the outer call.
+          stream_ = new Stream;
+          owns_stream_ = true;
+        } else {
+          stream_ = stream;
+        }
+        stream_->in_use = true;
+        stream_->buffer.out = &out;
+        auto& os = stream_->os;
+        os.clear();
+        os.flags(std::ios_base::dec | std::ios_base::skipws);
+        os.precision(6);
+        os.width(0);
+        os.fill(' ');
+      }
+      return stream_->os;
+    }
+  }
+
+  namespace {
+    bool is_word_char(char c) {
+      return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    }
+
+    /*
+      Splits fmt into literal text and placeholders of the form {[A-Za-z0-9_]+},
+      calling literal(begin, length) and placeholder(begin, length) in order.
+    */
+    template <class Literal, class Placeholder>
+    void scan_format(const std::string& fmt, Literal literal, Placeholder placeholder) {
+      const size_t n = fmt.size();
+      size_t start = 0;
+      size_t i = 0;
+      while (i < n) {
+        if (fmt[i] == '{') {
+          size_t j = i + 1;
+          while (j < n && is_word_char(fmt[j])) {
+            ++j;
+          }
+          if (j > i + 1 && j < n && fmt[j] == '}') {
+            if (i > start) {
+              literal(start, i - start);
+            }
+            placeholder(i, j + 1 - i);
+            i = start = j + 1;
+            continue;
+          }
+        }
+        ++i;
+      }
+      if (start < n) {
+        literal(start, n - start);
+      }
+    }
+
+    int placeholder_index(const std::string& fmt, size_t begin, size_t length) {
+      // Anything longer than 9 digits is out of range anyway.
+      if (length - 2 > 9) {
+        return -1;
+      }
+      int idx = 0;
+      for (size_t i = begin + 1; i < begin + length - 1; ++i) {
+        if (fmt[i] < '0' || fmt[i] > '9') {
+          return -1;
+        }
+        idx = idx * 10 + (fmt[i] - '0');
+      }
+      return idx;
+    }
+
+    void write_indexed(detail::FormatSink& sink, const std::string& fmt, size_t begin, size_t length, int idx, const Formattable* formatters, size_t num_formatters) {
+      if (idx >= 0 && size_t(idx) < num_formatters) {
+        formatters[idx].write(sink);
       } else {
-        formatters[idx].formatter->write(os, std::string{match[1].first, match[1].second});
+        sink.out.append(fmt, begin, length);
+      }
+    }
+
+    void write_named(detail::FormatSink& sink, const std::string& fmt, size_t begin, size_t length, FormattableParameters params) {
+      const char* name = fmt.data() + begin + 1;
+      const size_t name_length = length - 2;
+      for (auto& param: params) {
+        if (std::strncmp(param.name, name, name_length) == 0 && param.name[name_length] == '\0') {
+          param.value.write(sink);
+          return;
+        }
       }
+      sink.out.append(fmt, begin, length);
+    }
+  }
+
+  FormatString::FormatString(std::string fmt) : fmt_(std::move(fmt)) {
+    scan_format(fmt_, [&](size_t begin, size_t length) {
+      segments_.push_back(Segment{begin, length, false, -1});
+    }, [&](size_t begin, size_t length) {
+      segments_.push_back(Segment{begin, length, true, placeholder_index(fmt_, begin, length)});
     });
   }
 
-  void stream_interpolate_named(std::ostream& os, const std::string& fmt, const FormattableParameters& params) {
-    static const std::regex find_placeholders {"\\{([\\w\\d]+)\\}"};
-    wayward::regex_replace_stream(os, fmt, find_placeholders, [&](std::ostream& os, const MatchResults& match) {
-      std::string key {match[1].first, match[1].second};
-      auto it = params.find(key);
-      if (it != params.end()) {
-        it->second.formatter->write(os, key);
+  void format_indexed(detail::FormatSink& sink, const std::string& fmt, const Formattable* formatters, size_t num_formatters) {
+    sink.out.reserve(fmt.size() + 16 * num_formatters);
+    scan_format(fmt, [&](size_t begin, size_t length) {
+      sink.out.append(fmt, begin, length);
+    }, [&](size_t begin, size_t length) {
+      write_indexed(sink, fmt, begin, length, placeholder_index(fmt, begin, length), formatters, num_formatters);
+    });
+  }
+
+  void format_indexed(detail::FormatSink& sink, const FormatString& fmt, const Formattable* formatters, size_t num_formatters) {
+    auto& str = fmt.str();
+    sink.out.reserve(str.size() + 16 * num_formatters);
+    for (auto& segment: fmt.segments()) {
+      if (segment.is_placeholder) {
+        write_indexed(sink, str, segment.begin, segment.length, segment.index, formatters, num_formatters);
       } else {
-        std::copy(match[0].first, match[0].second, std::ostreambuf_iterator<char>(os));
+        sink.out.append(str, segment.begin, segment.length);
       }
+    }
+  }
+
+  void format_named(detail::FormatSink& sink, const std::string& fmt, FormattableParameters params) {
+    sink.out.reserve(fmt.size() + 16 * params.size());
+    scan_format(fmt, [&](size_t begin, size_t length) {
+      sink.out.append(fmt, begin, length);
+    }, [&](size_t begin, size_t length) {
+      write_named(sink, fmt, begin, length, params);
     });
   }
+
+  void format_named(detail::FormatSink& sink, const FormatString& fmt, FormattableParameters params) {
+    auto& str = fmt.str();
+    sink.out.reserve(str.size() + 16 * params.size());
+    for (auto& segment: fmt.segments()) {
+      if (segment.is_placeholder) {
+        write_named(sink, str, segment.begin, segment.length, params);
+      } else {
+        sink.out.append(str, segment.begin, segment.length);
+      }
+    }
+  }
 }
@@ -7,45 +7,99 @@
 #include <regex>
 #include <array>
 #include <map>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <initializer_list>
 
 namespace wayward {
-  struct IFormatter {
-    virtual ~IFormatter() {}
-    virtual void write(std::ostream& os, const std::string& fmt) const = 0;
-    virtual IFormatter* duplicate() const = 0;
-  };
-
+  /*
+    Customization point for how format() writes a value. The default uses operator<<.
+  */
   template <typename T>
-  struct Formatter : IFormatter {
-    const T& object;
-    Formatter(const T& object) : object(object) {}
-    virtual void write(std::ostream& os, const std::string& fmt) const {
+  struct Formatter {
+    static void write(std::ostream& os, const T& object) {
       os << object;
     }
-    virtual IFormatter* duplicate() const {
-      return new Formatter<T>(object);
-    }
   };
 
+  namespace detail {
+    /*
+      Where format() writes its output. Strings are appended directly; everything else
+      is streamed through an ostream that is reused between calls on the same thread.
+    */
+    struct FormatSink {
+      explicit FormatSink(std::string& out) : out(out) {}
+      ~FormatSink();
+      std::string& out;
+      std::ostream& stream();
+
+      struct Stream;
+    private:
+      Stream* stream_ = nullptr;
+      bool owns_stream_ = false;
+    };
+  }
+
+  /*
+    A reference to a value to be interpolated. It does not own or copy the value,
+    so it must not outlive it -- which is never a problem for arguments to format().
+  */
   struct Formattable {
     Formattable() {}
-    Formattable(Formattable&& other) = default;
     template <typename T>
-    Formattable(const T& object) {
-      formatter = std::unique_ptr<IFormatter>(new Formatter<T>{object});
+    Formattable(const T& object) : object_(&object), write_(&write_object<T>) {}
+    Formattable(const std::string& str) : chars_(str.data()), length_(str.size()) {}
+    Formattable(const char* str) : chars_(str ? str : ""), length_(std::strlen(chars_)) {}
+
+    void write(detail::FormatSink& sink) const {
+      if (write_) {
+        write_(sink.stream(), object_);
+      } else {
+        sink.out.append(chars_, length_);
+      }
     }
-    // This needs to be copy-constructible because std::initializer_list only allows const-access,
-    // so we can't move out values. :(
-    Formattable(const Formattable& other) : formatter(other.formatter->duplicate()) {}
-    Formattable& operator=(Formattable&& other) = default;
-    Formattable& operator=(const Formattable& other) {
-      formatter = std::unique_ptr<IFormatter>(other.formatter->duplicate());
-      return *this;
+  private:
+    template <typename T>
+    static void write_object(std::ostream& os, const void* object) {
+      Formatter<T>::write(os, *static_cast<const T*>(object));
     }
-    std::unique_ptr<IFormatter> formatter;
+
+    const void* object_ = nullptr;
+    void(*write_)(std::ostream&, const void*) = nullptr;
+    const char* chars_ = "";
+    size_t length_ = 0;
   };
 
-  using FormattableParameters = std::map<std::string, Formattable>;
+  struct FormattableParameter {
+    const char* name;
+    Formattable value;
+  };
+
+  using FormattableParameters = std::initializer_list<FormattableParameter>;
+
+  /*
+    A format string that is parsed once, for call sites that format often:
+
+    static const FormatString fmt {"Finished {0} in {1} ms"};
+    wayward::format(fmt, path, ms);
+  */
+  struct FormatString {
+    explicit FormatString(std::string fmt);
+
+    const std::string& str() const { return fmt_; }
+
+    struct Segment {
+      size_t begin;
+      size_t length;
+      bool is_placeholder; // Including the braces.
+      int index;           // -1 if the placeholder isn't a valid index.
+    };
+    const std::vector<Segment>& segments() const { return segments_; }
+  private:
+    std::string fmt_;
+    std::vector<Segment> segments_;
+  };
 
   using MatchResults = std::match_results<std::string::const_iterator>;
   /*
@@ -70,8 +124,10 @@ namespace wayward {
     std::copy(p, end, inserter);
   }
 
-  void stream_interpolate_indexed(std::ostream& os, const std::string& fmt, const Formattable* formatters, unsigned int num_formatters);
-  void stream_interpolate_named(std::ostream& os, const std::string& fmt, const FormattableParameters& params);
+  void format_indexed(detail::FormatSink& sink, const std::string& fmt, const Formattable* formatters, size_t num_formatters);
+  void format_indexed(detail::FormatSink& sink, const FormatString& fmt, const Formattable* formatters, size_t num_formatters);
+  void format_named(detail::FormatSink& sink, const std::string& fmt, FormattableParameters params);
+  void format_named(detail::FormatSink& sink, const FormatString& fmt, FormattableParameters params);
 
   /*
     Interpolate string with indexed placeholders:
@@ -81,10 +137,20 @@ namespace wayward {
   */
   template <typename... Rest>
   std::string format(const std::string& fmt, Formattable first, Rest&&... rest) {
-    std::array<Formattable, sizeof...(Rest) + 1> formatters {{{std::move(first)}, {rest}...}};
-    std::stringstream ss;
-    stream_interpolate_indexed(ss, fmt, formatters.data(), sizeof...(Rest) + 1);
-    return ss.str();
+    const Formattable formatters[] = {first, Formattable(rest)...};
+    std::string out;
+    detail::FormatSink sink {out};
+    format_indexed(sink, fmt, formatters, sizeof...(Rest) + 1);
+    return out;
+  }
+
+  template <typename... Rest>
+  std::string format(const FormatString& fmt, Formattable first, Rest&&... rest) {
+    const Formattable formatters[] = {first, Formattable(rest)...};
+    std::string out;
+    detail::FormatSink sink {out};
+    format_indexed(sink, fmt, formatters, sizeof...(Rest) + 1);
+    return out;
   }
 
   /*
@@ -93,10 +159,18 @@ namespace wayward {
     wayward::format("{greeting}, {entity}!", {{"greeting", "Hello"}, {"entity", "World"}});
     // => "Hello, World!"
   */
-  inline std::string format(const std::string& fmt, const FormattableParameters& params) {
-    std::stringstream ss;
-    stream_interpolate_named(ss, fmt, params);
-    return ss.str();
+  inline std::string format(const std::string& fmt, FormattableParameters params) {
+    std::string out;
+    detail::FormatSink sink {out};
+    format_named(sink, fmt, params);
+    return out;
+  }
+
+  inline std::string format(const FormatString& fmt, FormattableParameters params) {
+    std::string out;
+    detail::FormatSink sink {out};
+    format_named(sink, fmt, params);
+    return out;
   }
 
   /*
@@ -105,6 +179,10 @@ namespace wayward {
   inline std::string format(const std::string& fmt) {
     return fmt;
   }
+
+  inline std::string format(const FormatString& fmt) {
+    return fmt.str();
+  }
 }
 
 #endif /* end of include guard: SYMBOL */
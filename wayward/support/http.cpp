@@ -3,8 +3,10 @@
 #include <wayward/support/fiber.hpp>
 #include <wayward/support/event_loop_private.hpp>
 #include <wayward/support/string.hpp>
+#include <wayward/support/json.hpp>
 
 #include <cassert>
+#include <strings.h>
 #include <event2/event.h>
 #include <event2/buffer.h>
 #include <event2/keyvalq_struct.h>
@@ -51,6 +53,15 @@ namespace wayward {
       }
     }
 
+    bool has_json_body(const Request& r) {
+      for (auto& header: r.headers) {
+        if (header.first.size() == 12 && ::strncasecmp(header.first.c_str(), "Content-Type", 12) == 0) {
+          return header.second.compare(0, 16, "application/json") == 0;
+        }
+      }
+      return false;
+    }
+
     Request make_request_from_evhttp_request(evhtp_request_t* req) {
       Request r;
 
@@ -109,6 +120,20 @@ namespace wayward {
 
       r.params = data_franca::Object::dictionary();
 
+      bool json_body = r.body.size() && has_json_body(r);
+      if (json_body) {
+        // Malformed bodies are left for the handler to deal with in Request::body.
+        try {
+          auto json = parse_json(r.body);
+          if (json.type() == data_franca::DataType::Dictionary) {
+            r.params = std::move(json);
+          } else {
+            r.params["_json"] = std::move(json);
+          }
+        }
+        catch (const JSONParseError&) {}
+      }
+
       if (uri->query) {
         for (auto param = uri->query->tqh_first; param; param = param->next.tqe_next) {
           std::string k { param->key, param->klen };
@@ -119,7 +144,7 @@ namespace wayward {
         }
       }
 
-      if (r.method == "POST" && r.body.size()) {
+      if (r.method == "POST" && r.body.size() && !json_body) {
         printf("POST BODY: %s\n", r.body.c_str());
         auto kv_pairs = split(r.body, "&");
         for (auto& p: kv_pairs) {
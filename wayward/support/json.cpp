@@ -1,160 +1,274 @@
 #include <wayward/support/json.hpp>
-#include <sstream>
+
+#include <cstdio>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define WAYWARD_JSON_ESCAPE_X86 1
+#endif
 
 namespace wayward {
   namespace {
     using namespace data_franca;
 
-    void escape_json_stream(std::ostream& os, const std::string& input) {
-      for (auto it = input.cbegin(); it != input.cend(); it++) {
-        switch (*it) {
-            case '\\': os << "\\\\"; break;
-            case '"':  os << "\\\""; break;
-            case '/':  os << "\\/";  break;
-            case '\b': os << "\\b";  break;
-            case '\f': os << "\\f";  break;
-            case '\n': os << "\\n";  break;
-            case '\r': os << "\\r";  break;
-            case '\t': os << "\\t";  break;
-            default:   os << *it;  break;
-        }
+    // The character that follows the backslash when escaping c, or 0 if c is copied as-is.
+    inline char escape_char(unsigned char c) {
+      switch (c) {
+        case '\\': return '\\';
+        case '"':  return '"';
+        case '/':  return '/';
+        case '\b': return 'b';
+        case '\f': return 'f';
+        case '\n': return 'n';
+        case '\r': return 'r';
+        case '\t': return 't';
+        default:   return 0;
+      }
+    }
+
+    // Escapes input[i] if needed, first appending the clean run [run, i) that precedes it.
+    inline void escape_at(std::string& out, const char* input, size_t i, size_t& run) {
+      char e = escape_char(input[i]);
+      if (e) {
+        out.append(input + run, i - run);
+        out += '\\';
+        out += e;
+        run = i + 1;
       }
     }
 
-    void indentation(std::ostream& os, int indent = 0) {
-      for (int i = 0; i < indent; ++i) {
-        os << "  ";
+    void escape_tail(std::string& out, const char* input, size_t begin, size_t length, size_t run) {
+      for (size_t i = begin; i < length; ++i) {
+        escape_at(out, input, i, run);
       }
+      out.append(input + run, length - run);
+    }
+
+    void escape_json_scalar(std::string& out, const char* input, size_t length) {
+      escape_tail(out, input, 0, length, 0);
     }
 
-    void node_to_json_stream(std::ostream& os, const Spectator& node, JSONMode mode, int indent = 0) {
-      switch (node.type()) {
-        case DataType::Nothing: {
-          os << "null";
-          break;
+#if defined(WAYWARD_JSON_ESCAPE_X86)
+    /*
+      The vector kernels flag every byte that might need escaping ('"', '/', '\\' and anything
+      below 0x20), bulk-copy blocks with no flagged bytes, and let escape_at() decide on the rest.
+    */
+    inline void escape_flagged(std::string& out, const char* input, size_t offset, uint32_t mask, size_t& run) {
+      while (mask != 0) {
+        escape_at(out, input, offset + __builtin_ctz(mask), run);
+        mask &= mask - 1;
+      }
+    }
+
+    inline uint32_t flag_sse2(const char* p) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      __m128i quote = _mm_cmpeq_epi8(v, _mm_set1_epi8('"'));
+      __m128i slash = _mm_cmpeq_epi8(v, _mm_set1_epi8('/'));
+      __m128i backslash = _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'));
+      __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1f)), v);
+      return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(quote, slash), _mm_or_si128(backslash, control)));
+    }
+
+    void escape_json_sse2(std::string& out, const char* input, size_t length) {
+      size_t run = 0;
+      size_t i = 0;
+      for (; i + 16 <= length; i += 16) {
+        escape_flagged(out, input, i, flag_sse2(input + i), run);
+      }
+      escape_tail(out, input, i, length, run);
+    }
+
+    __attribute__((target("avx2")))
+    void escape_json_avx2(std::string& out, const char* input, size_t length) {
+      size_t run = 0;
+      size_t i = 0;
+      for (; i + 32 <= length; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+        __m256i quote = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'));
+        __m256i slash = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/'));
+        __m256i backslash = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'));
+        __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(0x1f)), v);
+        uint32_t mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(quote, slash), _mm256_or_si256(backslash, control)));
+        escape_flagged(out, input, i, mask, run);
+      }
+      if (i + 16 <= length) {
+        escape_flagged(out, input, i, flag_sse2(input + i), run);
+        i += 16;
+      }
+      escape_tail(out, input, i, length, run);
+    }
+#endif
+
+    struct JSONWriter {
+      std::string& out;
+      JSONMode mode;
+
+      void newline(int indent) {
+        out += '\n';
+        out.append(2 * indent, ' ');
+      }
+
+      void write_string(const String& str) {
+        detail::write_json_string(out, str);
+      }
+
+      void write_string_value(const IReader& node) {
+        if (const String* str = node.peek_string()) {
+          write_string(*str);
+          return;
         }
-        case DataType::Boolean: {
-          bool b;
-          if (node >> b) {
-            os << (b ? "true" : "false");
-          } else {
-            os << "undefined";
-            throw JSONSerializationError("Boolean node didn't return a bool");
-          }
-          break;
+        auto str = node.get_string();
+        if (!str) {
+          throw JSONSerializationError("String node didn't return a string.");
         }
-        case DataType::Integer: {
-          Integer n;
-          if (node >> n) {
-            os << n;
-          } else {
-            os << "undefined";
-            throw JSONSerializationError("Integer node didn't return an integer.");
+        write_string(*str);
+      }
+
+      struct ChildWriter : IReaderVisitor {
+        JSONWriter& writer;
+        bool with_keys;
+        int indent;
+        bool first = true;
+        ChildWriter(JSONWriter& writer, bool with_keys, int indent) : writer(writer), with_keys(with_keys), indent(indent) {}
+
+        void visit(const String* key, const IReader& value) final {
+          if (!first) {
+            writer.out += writer.mode == JSONMode::Compact ? ", " : ",";
           }
-          break;
-        }
-        case DataType::Real: {
-          Real n;
-          if (node >> n) {
-            os << n;
-          } else {
-            os << "undefined";
-            throw JSONSerializationError("Float node didn't return a double.");
+          first = false;
+          if (writer.mode == JSONMode::HumanReadable) {
+            writer.newline(indent + 1);
           }
-          break;
-        }
-        case DataType::String: {
-          String str;
-          if (node >> str) {
-            os << "\"";
-            escape_json_stream(os, str);
-            os << "\"";
-          } else {
-            os << "undefined";
-            throw JSONSerializationError("String node didn't return a string.");
+          if (with_keys) {
+            static const String no_key;
+            writer.write_string(key ? *key : no_key);
+            writer.out += ": ";
           }
-          break;
+          writer.write(value, indent + 1);
         }
-        case DataType::List: {
-          size_t len = node.length();
-          os << '[';
-          if (mode == JSONMode::Compact) {
-            auto end = node.end();
-            for (auto it = node.begin(); it != end;) {
-              node_to_json_stream(os, *it, mode);
-              ++it;
-              if (it != end) {
-                os << ", ";
-              }
-            }
-          } else {
-            if (len != 0) {
-              os << '\n';
-              indentation(os, indent);
-              auto end = node.end();
-              for (auto it = node.begin(); it != end;) {
-                indentation(os, 1);
-                node_to_json_stream(os, *it, mode, indent+1);
-                ++it;
-                if (it != end) {
-                  os << ',';
-                }
-                os << '\n';
-                indentation(os, indent);
-              }
+      };
+
+      void write_children(const IReader& node, bool with_keys, int indent) {
+        ChildWriter children {*this, with_keys, indent};
+        node.visit_children(children);
+        if (!children.first && mode == JSONMode::HumanReadable) {
+          newline(indent);
+        }
+      }
+
+      void write(const IReader& node, int indent = 0) {
+        switch (node.type()) {
+          case DataType::Nothing: {
+            out += "null";
+            break;
+          }
+          case DataType::Boolean: {
+            auto b = node.get_boolean();
+            if (!b) {
+              throw JSONSerializationError("Boolean node didn't return a bool");
             }
+            out += *b ? "true" : "false";
+            break;
           }
-          os << ']';
-          break;
-        }
-        case DataType::Dictionary: {
-          os << '{';
-          if (mode == JSONMode::Compact) {
-            auto end = node.end();
-            for (auto it = node.begin(); it != end;) {
-              os << "\"";
-              escape_json_stream(os, *it.key());
-              os << "\": ";
-              node_to_json_stream(os, *it, mode);
-              ++it;
-              if (it != end) {
-                os << ", ";
-              }
+          case DataType::Integer: {
+            auto n = node.get_integer();
+            if (!n) {
+              throw JSONSerializationError("Integer node didn't return an integer.");
             }
-          } else {
-            if (node.length() != 0) {
-              indentation(os, indent);
-              auto end = node.end();
-              for (auto it = node.begin(); it != end;) {
-                indentation(os, 1);
-                escape_json_stream(os, *it.key());
-                os << "\": ";
-                node_to_json_stream(os, *it, mode, indent+1);
-                ++it;
-                if (it != end) {
-                  os << ", ";
-                }
-                os << '\n';
-                indentation(os, indent);
-              }
+            detail::write_json_integer(out, *n);
+            break;
+          }
+          case DataType::Real: {
+            auto r = node.get_real();
+            if (!r) {
+              throw JSONSerializationError("Float node didn't return a double.");
             }
+            detail::write_json_real(out, *r);
+            break;
+          }
+          case DataType::String: {
+            write_string_value(node);
+            break;
+          }
+          case DataType::List: {
+            out += '[';
+            write_children(node, false, indent);
+            out += ']';
+            break;
+          }
+          case DataType::Dictionary: {
+            out += '{';
+            write_children(node, true, indent);
+            out += '}';
+            break;
           }
-          os << '}';
-          break;
         }
       }
+    };
+  }
+
+  namespace detail {
+    void write_json_integer(std::string& out, int64_t n) {
+      char buffer[24];
+      char* end = buffer + sizeof(buffer);
+      char* p = end;
+      uint64_t u = n < 0 ? -uint64_t(n) : uint64_t(n);
+      do {
+        *--p = '0' + (u % 10);
+        u /= 10;
+      } while (u != 0);
+      if (n < 0) {
+        *--p = '-';
+      }
+      out.append(p, end);
+    }
+
+    void write_json_real(std::string& out, double r) {
+      // Same output as the default formatting of std::ostream.
+      char buffer[32];
+      int n = std::snprintf(buffer, sizeof(buffer), "%g", r);
+      out.append(buffer, n);
+    }
+
+    void write_json_string(std::string& out, const std::string& str) {
+      out += '"';
+      escape_json(out, str.data(), str.size());
+      out += '"';
+    }
+
+    std::vector<JSONEscapeImplementation> json_escape_implementations() {
+      std::vector<JSONEscapeImplementation> implementations {{"scalar", escape_json_scalar}};
+#if defined(WAYWARD_JSON_ESCAPE_X86)
+      if (__builtin_cpu_supports("sse2")) {
+        implementations.push_back({"sse2", escape_json_sse2});
+      }
+      if (__builtin_cpu_supports("avx2")) {
+        implementations.push_back({"avx2", escape_json_avx2});
+      }
+#endif
+      return implementations;
     }
   }
 
+  void escape_json(std::string& out, const char* input, size_t length) {
+    static const detail::JSONEscapeFunction escape = detail::json_escape_implementations().back().escape;
+    escape(out, input, length);
+  }
+
   std::string escape_json(const std::string& input) {
-    std::stringstream ss;
-    escape_json_stream(ss, input);
-    return ss.str();
+    std::string result;
+    escape_json(result, input.data(), input.size());
+    return result;
+  }
+
+  void write_json(std::string& out, const data_franca::Spectator& node, JSONMode mode) {
+    JSONWriter writer {out, mode};
+    writer.write(node.reader_iface());
   }
 
   std::string as_json(const data_franca::Spectator& node, JSONMode mode) {
-    std::stringstream ss;
-    node_to_json_stream(ss, node, mode);
-    return ss.str();
+    std::string result;
+    write_json(result, node, mode);
+    return result;
   }
 }
@@ -4,20 +4,145 @@
 
 #include <wayward/support/data_franca/spectator.hpp>
 #include <wayward/support/data_franca/adapters.hpp>
+#include <wayward/support/data_franca/object.hpp>
 #include <wayward/support/error.hpp>
 
+#include <map>
+#include <vector>
+
 namespace wayward {
   struct JSONSerializationError : Error {
     JSONSerializationError(const char* what) : Error(what) {}
   };
 
+  struct JSONParseError : Error {
+    JSONParseError(const std::string& what, size_t offset) : Error(what), offset(offset) {}
+    size_t offset;
+  };
+
   enum class JSONMode {
     Compact,
     HumanReadable,
   };
 
   std::string escape_json(const std::string& input);
+  // Uses the fastest of the implementations below that the CPU supports.
+  void escape_json(std::string& out, const char* input, size_t length);
+
+  /*
+    Appends the JSON representation of data to out, without going through intermediate strings.
+    String values are read in place when the underlying reader supports it (see IReader::peek_string).
+  */
+  void write_json(std::string& out, const data_franca::Spectator& data, JSONMode mode = JSONMode::Compact);
   std::string as_json(const data_franca::Spectator& data, JSONMode mode = JSONMode::Compact);
+
+  namespace detail {
+    void write_json_integer(std::string& out, int64_t n);
+    void write_json_real(std::string& out, double r);
+    void write_json_string(std::string& out, const std::string& str);
+  }
+
+  /*
+    Writes compact JSON for values whose type is known at compile time, without going through
+    data_franca readers. Specialize it for types that can be serialized more directly than through
+    their adapter; the output must be the same. The default uses the adapter.
+  */
+  template <typename T, typename Enable = void>
+  struct JSONSerializer {
+    static void write(std::string& out, const T& value) {
+      write_json(out, data_franca::Spectator{value}, JSONMode::Compact);
+    }
+  };
+
+  template <typename T>
+  void write_json(std::string& out, const T& value, JSONMode mode = JSONMode::Compact) {
+    if (mode == JSONMode::Compact) {
+      JSONSerializer<T>::write(out, value);
+    } else {
+      write_json(out, data_franca::Spectator{value}, mode);
+    }
+  }
+
+  template <typename T>
+  struct JSONSerializer<T, typename std::enable_if<data_franca::IsSignedIntegerValue<T>::Value>::type> {
+    static void write(std::string& out, T n) { detail::write_json_integer(out, n); }
+  };
+
+  template <typename T>
+  struct JSONSerializer<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    static void write(std::string& out, T r) { detail::write_json_real(out, r); }
+  };
+
+  template <>
+  struct JSONSerializer<bool> {
+    static void write(std::string& out, bool b) { out += b ? "true" : "false"; }
+  };
+
+  template <>
+  struct JSONSerializer<std::string> {
+    static void write(std::string& out, const std::string& str) { detail::write_json_string(out, str); }
+  };
+
+  template <typename T>
+  struct JSONSerializer<Maybe<T>> {
+    static void write(std::string& out, const Maybe<T>& value) {
+      if (value) {
+        JSONSerializer<T>::write(out, *value);
+      } else {
+        out += "null";
+      }
+    }
+  };
+
+  template <typename T>
+  struct JSONSerializer<std::vector<T>> {
+    static void write(std::string& out, const std::vector<T>& list) {
+      out += '[';
+      for (size_t i = 0; i < list.size(); ++i) {
+        if (i != 0) {
+          out += ", ";
+        }
+        JSONSerializer<T>::write(out, list[i]);
+      }
+      out += ']';
+    }
+  };
+
+  template <typename T>
+  struct JSONSerializer<std::map<std::string, T>> {
+    static void write(std::string& out, const std::map<std::string, T>& dict) {
+      out += '{';
+      bool first = true;
+      for (auto& pair: dict) {
+        if (!first) {
+          out += ", ";
+        }
+        first = false;
+        detail::write_json_string(out, pair.first);
+        out += ": ";
+        JSONSerializer<T>::write(out, pair.second);
+      }
+      out += '}';
+    }
+  };
+
+  /*
+    Parses a complete JSON document. Integers that fit in 64 bits become Integers, other numbers Reals.
+    Throws JSONParseError on malformed input.
+  */
+  data_franca::Object parse_json(const std::string& input);
+  data_franca::Object parse_json(const char* input, size_t length);
+
+  namespace detail {
+    using JSONEscapeFunction = void(*)(std::string& out, const char* input, size_t length);
+    struct JSONEscapeImplementation {
+      const char* name;
+      JSONEscapeFunction escape;
+    };
+
+    // The escape_json implementations usable on this CPU, slowest (the portable scalar one) first.
+    std::vector<JSONEscapeImplementation> json_escape_implementations();
+  }
 }
 
 #endif // WAYWARD_SUPPORT_JSON_HPP_INCLUDED
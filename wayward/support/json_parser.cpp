@@ -0,0 +1,315 @@
+#include <wayward/support/json.hpp>
+#include <wayward/support/data_franca/object.hpp>
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#endif
+
+namespace wayward {
+  namespace {
+    using data_franca::Object;
+    using data_franca::String;
+
+    // Deeper documents are rejected instead of risking the stack.
+    const int MaxDepth = 512;
+
+    struct JSONParser {
+      const char* begin;
+      const char* p;
+      const char* end;
+      std::string scratch;
+
+      [[noreturn]] void fail(const char* what) {
+        size_t offset = p - begin;
+        throw JSONParseError{wayward::format("Invalid JSON at offset {0}: {1}", offset, what), offset};
+      }
+
+      void skip_whitespace() {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+          ++p;
+        }
+      }
+
+      void expect_literal(const char* literal, size_t length) {
+        if (size_t(end - p) < length || std::memcmp(p, literal, length) != 0) {
+          fail("unexpected token");
+        }
+        p += length;
+      }
+
+      // Advances to the first '"', '\\' or control character.
+      void skip_plain_characters() {
+#if defined(__x86_64__)
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x1f);
+        while (end - p >= 16) {
+          __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+          __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                         _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+          int mask = _mm_movemask_epi8(special);
+          if (mask != 0) {
+            p += __builtin_ctz(mask);
+            return;
+          }
+          p += 16;
+        }
+#endif
+        while (p < end && *p != '"' && *p != '\\' && (unsigned char)*p >= 0x20) {
+          ++p;
+        }
+      }
+
+      unsigned parse_hex4() {
+        if (end - p < 4) {
+          fail("truncated \\u escape");
+        }
+        unsigned code = 0;
+        for (int i = 0; i < 4; ++i, ++p) {
+          char c = *p;
+          code <<= 4;
+          if (c >= '0' && c <= '9')      code |= c - '0';
+          else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+          else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+          else fail("invalid \\u escape");
+        }
+        return code;
+      }
+
+      void append_utf8(std::string& out, unsigned code) {
+        if (code < 0x80) {
+          out += char(code);
+        } else if (code < 0x800) {
+          out += char(0xc0 | (code >> 6));
+          out += char(0x80 | (code & 0x3f));
+        } else if (code < 0x10000) {
+          out += char(0xe0 | (code >> 12));
+          out += char(0x80 | ((code >> 6) & 0x3f));
+          out += char(0x80 | (code & 0x3f));
+        } else {
+          out += char(0xf0 | (code >> 18));
+          out += char(0x80 | ((code >> 12) & 0x3f));
+          out += char(0x80 | ((code >> 6) & 0x3f));
+          out += char(0x80 | (code & 0x3f));
+        }
+      }
+
+      void parse_escape(std::string& out) {
+        ++p; // backslash
+        if (p == end) {
+          fail("unterminated string");
+        }
+        char c = *p++;
+        switch (c) {
+          case '"':  out += '"'; break;
+          case '\\': out += '\\'; break;
+          case '/':  out += '/'; break;
+          case 'b':  out += '\b'; break;
+          case 'f':  out += '\f'; break;
+          case 'n':  out += '\n'; break;
+          case 'r':  out += '\r'; break;
+          case 't':  out += '\t'; break;
+          case 'u': {
+            unsigned code = parse_hex4();
+            if (code >= 0xd800 && code < 0xdc00) {
+              if (end - p < 2 || p[0] != '\\' || p[1] != 'u') {
+                fail("unpaired surrogate");
+              }
+              p += 2;
+              unsigned low = parse_hex4();
+              if (low < 0xdc00 || low >= 0xe000) {
+                fail("unpaired surrogate");
+              }
+              code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+            } else if (code >= 0xdc00 && code < 0xe000) {
+              fail("unpaired surrogate");
+            }
+            append_utf8(out, code);
+            break;
+          }
+          default: {
+            --p;
+            fail("invalid escape sequence");
+          }
+        }
+      }
+
+      void parse_string(std::string& out) {
+        ++p; // opening quote
+        out.clear();
+        while (true) {
+          const char* run = p;
+          skip_plain_characters();
+          out.append(run, p);
+          if (p == end) {
+            fail("unterminated string");
+          }
+          if (*p == '"') {
+            ++p;
+            return;
+          }
+          if (*p == '\\') {
+            parse_escape(out);
+          } else {
+            fail("control character in string");
+          }
+        }
+      }
+
+      Object parse_number() {
+        const char* start = p;
+        bool is_integer = true;
+        if (p < end && *p == '-') {
+          ++p;
+        }
+        if (p < end && *p == '0') {
+          ++p;
+        } else if (p < end && *p >= '1' && *p <= '9') {
+          while (p < end && *p >= '0' && *p <= '9') ++p;
+        } else {
+          fail("invalid number");
+        }
+        if (p < end && *p == '.') {
+          is_integer = false;
+          ++p;
+          if (p == end || *p < '0' || *p > '9') {
+            fail("invalid number");
+          }
+          while (p < end && *p >= '0' && *p <= '9') ++p;
+        }
+        if (p < end && (*p == 'e' || *p == 'E')) {
+          is_integer = false;
+          ++p;
+          if (p < end && (*p == '+' || *p == '-')) ++p;
+          if (p == end || *p < '0' || *p > '9') {
+            fail("invalid number");
+          }
+          while (p < end && *p >= '0' && *p <= '9') ++p;
+        }
+
+        if (is_integer) {
+          // Accumulate negatively so INT64_MIN fits; fall back to a Real on overflow.
+          const char* d = start;
+          bool negative = *d == '-';
+          if (negative) ++d;
+          int64_t n = 0;
+          bool overflow = false;
+          for (; d < p; ++d) {
+            int digit = *d - '0';
+            if (n < (INT64_MIN + digit) / 10) {
+              overflow = true;
+              break;
+            }
+            n = n * 10 - digit;
+          }
+          if (!overflow && (negative || n != INT64_MIN)) {
+            return Object{data_franca::Integer(negative ? n : -n)};
+          }
+        }
+
+        // strtod needs a terminated string, and the input isn't necessarily.
+        scratch.assign(start, p);
+        return Object{data_franca::Real(std::strtod(scratch.c_str(), nullptr))};
+      }
+
+      Object parse_value(int depth) {
+        skip_whitespace();
+        if (p == end) {
+          fail("unexpected end of input");
+        }
+        switch (*p) {
+          case '{': return parse_dictionary(depth + 1);
+          case '[': return parse_list(depth + 1);
+          case '"': {
+            std::string str;
+            parse_string(str);
+            return Object{std::move(str)};
+          }
+          case 't': expect_literal("true", 4); return Object{true};
+          case 'f': expect_literal("false", 5); return Object{false};
+          case 'n': expect_literal("null", 4); return Object{};
+          default:  return parse_number();
+        }
+      }
+
+      Object parse_list(int depth) {
+        if (depth > MaxDepth) {
+          fail("nesting too deep");
+        }
+        ++p; // [
+        std::vector<Object> elements;
+        skip_whitespace();
+        if (p < end && *p == ']') {
+          ++p;
+          return Object::list();
+        }
+        while (true) {
+          elements.push_back(parse_value(depth));
+          skip_whitespace();
+          if (p < end && *p == ',') {
+            ++p;
+          } else if (p < end && *p == ']') {
+            ++p;
+            return Object::list(std::move(elements));
+          } else {
+            fail("expected ',' or ']'");
+          }
+        }
+      }
+
+      Object parse_dictionary(int depth) {
+        if (depth > MaxDepth) {
+          fail("nesting too deep");
+        }
+        ++p; // {
+        std::vector<std::pair<String, Object>> entries;
+        skip_whitespace();
+        if (p < end && *p == '}') {
+          ++p;
+          return Object::dictionary();
+        }
+        std::string key;
+        while (true) {
+          skip_whitespace();
+          if (p == end || *p != '"') {
+            fail("expected a string key");
+          }
+          parse_string(key);
+          skip_whitespace();
+          if (p == end || *p != ':') {
+            fail("expected ':'");
+          }
+          ++p;
+          Object value = parse_value(depth);
+          entries.emplace_back(key, std::move(value));
+          skip_whitespace();
+          if (p < end && *p == ',') {
+            ++p;
+          } else if (p < end && *p == '}') {
+            ++p;
+            return Object::dictionary(std::move(entries));
+          } else {
+            fail("expected ',' or '}'");
+          }
+        }
+      }
+    };
+  }
+
+  data_franca::Object parse_json(const char* input, size_t length) {
+    JSONParser parser {input, input, input + length};
+    auto result = parser.parse_value(0);
+    parser.skip_whitespace();
+    if (parser.p != parser.end) {
+      parser.fail("trailing characters");
+    }
+    return result;
+  }
+
+  data_franca::Object parse_json(const std::string& input) {
+    return parse_json(input.data(), input.size());
+  }
+}
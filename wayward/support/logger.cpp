@@ -29,8 +29,13 @@ namespace wayward {
   FormattedLogger::FormattedLogger() : formatter_(default_formatter) {}
 
   void FormattedLogger::log(Severity severity, std::string tag, std::string message) {
+    if (severity >= level()) {
+      log_at(DateTime::now(), severity, std::move(tag), std::move(message));
+    }
+  }
+
+  void FormattedLogger::log_at(DateTime t, Severity severity, std::string tag, std::string message) {
     if (severity >= level_) {
-      auto t = DateTime::now();
       auto format = formatter_(severity, t, tag, message);
       write_message(severity, wayward::format(format, {
         {"start_color", ""},
@@ -73,7 +78,7 @@ namespace wayward {
     return std::static_pointer_cast<ILogger>(g_console_logger);
   }
 
-  void ConsoleStreamLogger::log(Severity severity, std::string tag, std::string message) {
+  void ConsoleStreamLogger::log_at(DateTime t, Severity severity, std::string tag, std::string message) {
     if (severity >= level()) {
       const char* start_color = "";
       const char* end_color = "";
@@ -99,7 +104,6 @@ namespace wayward {
         end_color = TerminalResetColor;
       }
 
-      auto t = DateTime::now();
       auto format = formatter_(severity, t, tag, message);
 
       write_message(severity, wayward::format(format, {
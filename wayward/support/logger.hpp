@@ -25,6 +25,9 @@ namespace wayward {
     virtual void log(Severity severity, std::string tag, std::string message) = 0;
     virtual Severity level() const = 0;
     virtual void set_level(Severity severity) = 0;
+
+    // Whether messages of this severity would be written. See WAYWARD_LOG.
+    bool enabled(Severity severity) const { return severity >= level(); }
   };
 
   template <typename T, typename... Args>
@@ -44,6 +47,8 @@ namespace wayward {
     void set_level(Severity l) final { level_ = l; }
 
     // FormattedLogger interface
+    // Like log(), but for a message that was logged at an earlier point in time.
+    virtual void log_at(DateTime timestamp, Severity severity, std::string tag, std::string message);
     virtual void write_message(Severity severity, std::string formatted_message) = 0;
     void set_formatter(FormatFunction func) { formatter_ = std::move(func); }
   protected:
@@ -67,7 +72,7 @@ namespace wayward {
     bool colorize() const { return colorize_; }
     void set_colorize(bool b) { colorize_ = b; }
 
-    void log(Severity severity, std::string tag, std::string message) override;
+    void log_at(DateTime timestamp, Severity severity, std::string tag, std::string message) override;
 
     void write_message(Severity severity, std::string formatted_message) final {
       std::unique_lock<std::mutex> L(mutex_);
@@ -88,4 +93,18 @@ namespace wayward {
   };
 }
 
+/*
+  Logs through LOGGER (a pointer to an ILogger), but only evaluates TAG and MESSAGE
+  if the logger is enabled for SEVERITY, so disabled messages cost a level check:
+
+  WAYWARD_LOG(conn.logger(), wayward::Severity::Debug, "p", wayward::format("Load {0}", name));
+*/
+#define WAYWARD_LOG(LOGGER, SEVERITY, TAG, MESSAGE) \
+  do { \
+    auto&& wayward_log_logger_ = (LOGGER); \
+    if (wayward_log_logger_->enabled(SEVERITY)) { \
+      wayward_log_logger_->log(SEVERITY, TAG, MESSAGE); \
+    } \
+  } while (0)
+
 #endif // WAYWARD_SUPPORT_LOGGER_INCLUDED_HPP
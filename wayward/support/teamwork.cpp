@@ -40,7 +40,11 @@ namespace wayward {
   }
 
   Teamwork::~Teamwork() {
-    p_->exiting = true;
+    {
+      // Under the lock, so that a worker can't miss the wakeup between checking and waiting.
+      std::unique_lock<std::mutex> L(p_->mutex_);
+      p_->exiting = true;
+    }
     // Wake up *all* workers by posting N signals.
     p_->work_cond_.notify_all();
     // Wait for all workers to exit.
@@ -49,6 +53,10 @@ namespace wayward {
     }
   }
 
+  size_t Teamwork::number_of_workers() const {
+    return p_->workers_.size();
+  }
+
   void Teamwork::work(Teamwork::Function f) {
     std::unique_lock<std::mutex> L(p_->mutex_);
     p_->queue_.push(std::move(f));
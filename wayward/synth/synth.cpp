@@ -297,7 +297,7 @@ namespace wayward {
       }
       Context ctx { std::move(values) };
 
-      wayward::log::debug("synth", wayward::format("Rendering template: {0}", path));
+      W_LOG(Debug, "synth", wayward::format("Rendering template: {0}", path));
 
       return templ.render_to_string(ctx);
     }
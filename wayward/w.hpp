@@ -72,11 +72,13 @@ namespace wayward {
     make_handler_for_route_method(RouteMethodPointer<R> handler) {
       return [=](Request& req) -> Response {
         R routes;
-        routes.before(req);
-        auto response = routes.around(req, [&](Request& r) { return (routes.*handler)(r); });
-        // TODO: Make the response available to "after" filters.
-        routes.after(req);
-        return std::move(response);
+        return routes.handle(req, [&](Request& request) -> Response {
+          routes.before(request);
+          auto response = routes.around(request, [&](Request& r) { return (routes.*handler)(r); });
+          // TODO: Make the response available to "after" filters.
+          routes.after(request);
+          return std::move(response);
+        });
       };
     }
   };
@@ -88,7 +90,9 @@ namespace wayward {
 
     struct {
       bool log_requests = true;
+      bool async_logging = true;
       bool parallel = false;
+      std::string access_log_directory; // Binary access log segments are written here when non-empty.
     } config;
 
     std::string root() const;
@@ -102,7 +106,7 @@ namespace wayward {
     std::unique_ptr<Private> priv;
   };
 
-  std::shared_ptr<ILogger> logger();
+  const std::shared_ptr<ILogger>& logger();
   void set_logger(std::shared_ptr<ILogger>);
 
   namespace log {
@@ -117,4 +121,11 @@ namespace wayward {
   }
 }
 
+/*
+  Like log::debug() and friends, but the message is only built if the app logger would write it:
+
+  W_LOG(Debug, "w", wayward::format("Parameters: {0}", as_json(req.params)));
+*/
+#define W_LOG(SEVERITY, TAG, MESSAGE) WAYWARD_LOG(::wayward::logger(), ::wayward::Severity::SEVERITY, TAG, MESSAGE)
+
 #endif /* end of include guard: SYMBOL */